@@ -0,0 +1,359 @@
+#include "AdaptiveMesher.hpp"
+
+#define PI           3.14159265359
+#define FOUR_PI      12.5663706144
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+#include "HarmonicsBatch.hpp"
+#include "SphereSampling.hpp"
+#include "ThreadPool.hpp"
+
+// Edges are keyed by their (ordered) end points
+static uint64_t EdgeKey(uint32_t a, uint32_t b)
+{
+	return (a < b) ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+}
+
+AdaptiveMesher::AdaptiveMesher(int l, int m, double tolerance) :
+	l(l), m(m), tolerance(tolerance)
+{
+}
+
+bool AdaptiveMesher::Generate(ThreadPool* pool, const std::atomic<bool>* cancelled)
+{
+	directions.clear();
+	radii.clear();
+	indices.clear();
+
+	for (const double* vertex : icosahedronVertices)
+	{
+		double length = std::sqrt(vertex[0] * vertex[0] + vertex[1] * vertex[1] + vertex[2] * vertex[2]);
+		for (int i = 0; i < 3; i++)
+			directions.push_back((float)(vertex[i] / length));
+	}
+
+	radii.resize(12);
+	{
+		float x[12], y[12], z[12];
+		for (int i = 0; i < 12; i++)
+		{
+			x[i] = directions[3 * i + 0];
+			y[i] = directions[3 * i + 1];
+			z[i] = directions[3 * i + 2];
+		}
+
+		EvaluateRealHarmonics(l, m, x, y, z, 12, radii.data(), nullptr);
+	}
+
+	for (const uint32_t* face : icosahedronFaces)
+		indices.insert(indices.end(), face, face + 3);
+
+	// The icosahedron's edges span 63 degrees. They have to get down to about half a wavelength before
+	// the error test can be trusted, otherwise a whole lobe could hide between two samples
+	double edgeAngle = 1.1071487177940904;
+	unsigned int uniformLevels = 0;
+	while (edgeAngle > PI / (l + 1) && uniformLevels < maxLevel)
+	{
+		edgeAngle /= 2.0;
+		uniformLevels++;
+	}
+
+	// What became of every edge that was tested so far: the index of its midpoint vertex or, for edges
+	// that stay, UINT32_MAX. Edges that passed the test once don't have to be tested again
+	std::unordered_map<uint64_t, uint32_t> splits;
+	const uint32_t forcedSplit = UINT32_MAX - 1;
+
+	// Triangles whose edges and centroid all passed the test
+	std::vector<unsigned char> settled(indices.size() / 3, 0), refinedSettled;
+
+	std::vector<uint64_t> edges, forcedEdges;
+	std::vector<size_t> testedTriangles;
+	std::vector<float> x, y, z, values;
+	std::vector<uint32_t> refined;
+
+	auto addPoint = [&](double px, double py, double pz)
+	{
+		double length = std::sqrt(px * px + py * py + pz * pz);
+		x.push_back((float)(px / length));
+		y.push_back((float)(py / length));
+		z.push_back((float)(pz / length));
+	};
+
+	auto addMidpoint = [&](uint64_t edge)
+	{
+		uint32_t a = (uint32_t)(edge >> 32), b = (uint32_t)edge;
+		addPoint((double)directions[3 * a + 0] + directions[3 * b + 0],
+			(double)directions[3 * a + 1] + directions[3 * b + 1],
+			(double)directions[3 * a + 2] + directions[3 * b + 2]);
+	};
+
+	// Distance between the surface at point i and the average of the given vertices on the surface
+	auto error = [&](size_t i, const uint32_t* vertices, int count)
+	{
+		double sum = 0.0;
+		const float* point[3] = { &x[i], &y[i], &z[i] };
+		for (int k = 0; k < 3; k++)
+		{
+			double average = 0.0;
+			for (int v = 0; v < count; v++)
+				average += std::abs(radii[vertices[v]]) * directions[3 * vertices[v] + k];
+
+			double d = std::abs(values[i]) * *point[k] - average / count;
+			sum += d * d;
+		}
+
+		return std::sqrt(sum);
+	};
+
+	// Where an edge crosses a node the surface runs through the origin, while the edge runs between two lobes.
+	// The midpoint alone can't see that (it may well land on the other lobe), so the distance from the origin
+	// to the edge counts as error too
+	auto nodeError = [&](const uint32_t* ends)
+	{
+		if ((radii[ends[0]] >= 0.0f) == (radii[ends[1]] >= 0.0f))
+			return 0.0;
+
+		double p[3], d[3], pd = 0.0, dd = 0.0;
+		for (int k = 0; k < 3; k++)
+		{
+			p[k] = std::abs(radii[ends[0]]) * directions[3 * ends[0] + k];
+			d[k] = std::abs(radii[ends[1]]) * directions[3 * ends[1] + k] - p[k];
+			pd += p[k] * d[k];
+			dd += d[k] * d[k];
+		}
+
+		double t = (dd > 0.0) ? std::min(std::max(-pd / dd, 0.0), 1.0) : 0.0;
+		double sum = 0.0;
+		for (int k = 0; k < 3; k++)
+			sum += (p[k] + t * d[k]) * (p[k] + t * d[k]);
+
+		return std::sqrt(sum);
+	};
+
+	auto addVertex = [&](uint64_t edge, size_t i)
+	{
+		splits[edge] = (uint32_t)radii.size();
+		radii.push_back(values[i]);
+		directions.push_back(x[i]);
+		directions.push_back(y[i]);
+		directions.push_back(z[i]);
+	};
+
+	for (unsigned int level = 0; level < maxLevel; level++)
+	{
+		if (cancelled != nullptr && *cancelled)
+			return false;
+
+		// The midpoints of edges that weren't tested before, and the centroids of the triangles that aren't settled
+		edges.clear();
+		testedTriangles.clear();
+		x.clear();
+		y.clear();
+		z.clear();
+
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			for (int k = 0; k < 3; k++)
+			{
+				uint64_t key = EdgeKey(indices[i + k], indices[i + (k + 1) % 3]);
+				if (splits.emplace(key, UINT32_MAX).second)
+				{
+					edges.push_back(key);
+					addMidpoint(key);
+				}
+			}
+		}
+
+		for (size_t triangle = 0; triangle < settled.size(); triangle++)
+		{
+			if (settled[triangle])
+				continue;
+
+			const uint32_t* v = &indices[3 * triangle];
+			double point[3];
+			for (int k = 0; k < 3; k++)
+				point[k] = (double)directions[3 * v[0] + k] + directions[3 * v[1] + k] + directions[3 * v[2] + k];
+
+			testedTriangles.push_back(triangle);
+			addPoint(point[0], point[1], point[2]);
+		}
+
+		if (x.empty())
+			break;
+
+		Evaluate(pool, x, y, z, values);
+
+		bool uniform = (level < uniformLevels);
+		size_t splitCount = 0;
+		for (size_t i = 0; i < edges.size(); i++)
+		{
+			uint32_t ends[2] = { (uint32_t)(edges[i] >> 32), (uint32_t)edges[i] };
+			if (uniform || error(i, ends, 2) > tolerance || nodeError(ends) > tolerance)
+			{
+				addVertex(edges[i], i);
+				splitCount++;
+			}
+		}
+
+		// Something can hide inside a triangle even if its edges look fine, then the whole triangle gets split
+		forcedEdges.clear();
+		for (size_t i = 0; i < testedTriangles.size(); i++)
+		{
+			const uint32_t* v = &indices[3 * testedTriangles[i]];
+			if (error(edges.size() + i, v, 3) <= tolerance)
+			{
+				settled[testedTriangles[i]] = 1;
+				continue;
+			}
+
+			for (int k = 0; k < 3; k++)
+			{
+				// Marked so every edge is only listed once, addVertex() replaces the mark with the midpoint
+				uint32_t& split = splits[EdgeKey(v[k], v[(k + 1) % 3])];
+				if (split == UINT32_MAX)
+				{
+					split = forcedSplit;
+					forcedEdges.push_back(EdgeKey(v[k], v[(k + 1) % 3]));
+				}
+			}
+		}
+
+		if (!forcedEdges.empty())
+		{
+			x.clear();
+			y.clear();
+			z.clear();
+			for (uint64_t edge : forcedEdges)
+				addMidpoint(edge);
+
+			Evaluate(pool, x, y, z, values);
+			for (size_t i = 0; i < forcedEdges.size(); i++)
+				addVertex(forcedEdges[i], i);
+
+			splitCount += forcedEdges.size();
+		}
+
+		if (splitCount == 0)
+			break;
+
+		// Split the triangles according to their split edges
+		refined.clear();
+		refined.reserve(4 * indices.size());
+		refinedSettled.clear();
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			uint32_t v[3] = { indices[i], indices[i + 1], indices[i + 2] };
+			uint32_t mid[3];			// mid[k] lies on the edge v[k], v[k + 1]
+			int splitEdges = 0;
+			for (int k = 0; k < 3; k++)
+			{
+				mid[k] = splits[EdgeKey(v[k], v[(k + 1) % 3])];
+				splitEdges += (mid[k] != UINT32_MAX);
+			}
+
+			// Only triangles that stay the way they are can be settled
+			refinedSettled.insert(refinedSettled.end(), (splitEdges == 0) ? 1 : splitEdges + 1, (splitEdges == 0) ? settled[i / 3] : 0);
+
+			if (splitEdges == 0)
+			{
+				refined.insert(refined.end(), v, v + 3);
+			}
+			else if (splitEdges == 3)
+			{
+				uint32_t triangles[12] = {
+					v[0], mid[0], mid[2],
+					mid[0], v[1], mid[1],
+					mid[2], mid[1], v[2],
+					mid[0], mid[1], mid[2]
+				};
+				refined.insert(refined.end(), triangles, triangles + 12);
+			}
+			else
+			{
+				// Rotate so the edge v[0], v[1] is split (and, with two split edges, v[1], v[2] as well)
+				int rotation = 0;
+				if (splitEdges == 1)
+					rotation = (mid[0] != UINT32_MAX) ? 0 : (mid[1] != UINT32_MAX) ? 1 : 2;
+				else
+					rotation = (mid[2] == UINT32_MAX) ? 0 : (mid[0] == UINT32_MAX) ? 1 : 2;
+
+				uint32_t a = v[rotation], b = v[(rotation + 1) % 3], c = v[(rotation + 2) % 3];
+				uint32_t ab = mid[rotation], bc = mid[(rotation + 1) % 3];
+
+				if (splitEdges == 1)
+				{
+					uint32_t triangles[6] = { a, ab, c, ab, b, c };
+					refined.insert(refined.end(), triangles, triangles + 6);
+				}
+				else
+				{
+					// The corner at b gets cut off, the rest is a quad that's split along its shorter diagonal
+					auto distance = [&](uint32_t p, uint32_t q)
+					{
+						double sum = 0.0;
+						for (int k = 0; k < 3; k++)
+						{
+							double d = std::abs(radii[p]) * directions[3 * p + k] - std::abs(radii[q]) * directions[3 * q + k];
+							sum += d * d;
+						}
+
+						return sum;
+					};
+
+					if (distance(a, bc) < distance(ab, c))
+					{
+						uint32_t triangles[9] = { ab, b, bc, a, ab, bc, a, bc, c };
+						refined.insert(refined.end(), triangles, triangles + 9);
+					}
+					else
+					{
+						uint32_t triangles[9] = { ab, b, bc, a, ab, c, ab, bc, c };
+						refined.insert(refined.end(), triangles, triangles + 9);
+					}
+				}
+			}
+		}
+
+		indices.swap(refined);
+		settled.swap(refinedSettled);
+	}
+
+	return (cancelled == nullptr || !*cancelled);
+}
+
+double AdaptiveMesher::GetTolerance(int l, unsigned int resolution)
+{
+	// The grid's error is dominated by the nodes, where the surface has a kink that a cell of angle pi / resolution
+	// cuts off. That error grows with the slope there, about l times the size of the largest lobe. Without nodes
+	// (l = 0) what's left is the chord error of the grid's cells on a sphere, whose diagonals are a few times
+	// longer than the cell's angle. This errs on the strict side, measured errors of the grid are about twice as large
+	double maxRadius = std::sqrt((2.0 * l + 1.0) / FOUR_PI);
+	double angle = PI / resolution;
+	return maxRadius * (l * angle / 8.0 + angle * angle / 2.0);
+}
+
+void AdaptiveMesher::Evaluate(ThreadPool* pool, const std::vector<float>& x, const std::vector<float>& y, const std::vector<float>& z, std::vector<float>& values) const
+{
+	values.resize(x.size());
+
+	// Chunks big enough to be worth handing to another thread
+	const size_t chunkSize = 4096;
+	size_t chunkCount = (x.size() + chunkSize - 1) / chunkSize;
+	auto evaluateChunk = [&](size_t chunk)
+	{
+		size_t first = chunk * chunkSize;
+		size_t count = std::min(chunkSize, x.size() - first);
+		EvaluateRealHarmonics(l, m, &x[first], &y[first], &z[first], count, &values[first], nullptr);
+	};
+
+	if (pool != nullptr && chunkCount > 1)
+		pool->ParallelFor(chunkCount, evaluateChunk);
+	else
+	{
+		for (size_t chunk = 0; chunk < chunkCount; chunk++)
+			evaluateChunk(chunk);
+	}
+}
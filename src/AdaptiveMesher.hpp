@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+// Builds an orbital surface that only has small triangles where it needs them.
+//
+// It starts out as an icosahedron and refines level by level: every edge whose midpoint is further than the
+// tolerance from the straight line between its end points (on the actual surface |Y| * direction) gets split.
+// Triangles are then split according to how many of their edges were split (2, 3 or 4 new triangles), and
+// as edges are shared by both their triangles there are never any cracks. The nodes, where the surface
+// pinches to zero, and strongly curved lobes end up finely tessellated while flat parts stay coarse.
+// The first few levels are always refined uniformly, until the edges are short enough not to skip over
+// whole lobes.
+//
+// The result is in the sampled layout: a unit direction and a signed radius per vertex, plus a triangle list.
+class AdaptiveMesher
+{
+public:
+	AdaptiveMesher(int l, int m, double tolerance);
+
+	// Returns false if it was cancelled
+	bool Generate(ThreadPool* pool = nullptr, const std::atomic<bool>* cancelled = nullptr);
+
+	// A tolerance that looks about as good as the regular grid at the given resolution
+	static double GetTolerance(int l, unsigned int resolution);
+
+	// Edges of the last level span about 0.015 degrees
+	static const unsigned int maxLevel = 12;
+
+public:
+	std::vector<float> directions;			// x, y, z per vertex
+	std::vector<float> radii;
+	std::vector<uint32_t> indices;
+
+private:
+	// Radii at many directions at once, spread over the pool
+	void Evaluate(ThreadPool* pool, const std::vector<float>& x, const std::vector<float>& y, const std::vector<float>& z, std::vector<float>& values) const;
+
+private:
+	int l, m;
+	double tolerance;
+};
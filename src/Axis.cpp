@@ -4,58 +4,17 @@
 #define PI           3.14159265359
 
 #include <cmath>
+#include <cstddef>
 
+#include <glad/glad.h>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
-#include "Shader.hpp"
-#include "Camera.hpp"
-
-Shader* Axis::defaultShader = nullptr;
-
-Axis::Axis(const glm::vec3& direction, float length) :
-	color({0.6f, 0.6f, 0.6f})
+AxisMesh::AxisMesh(float length) :
+	instanceVbo(0), instanceCount(0)
 {
-	if (defaultShader == nullptr)
-	{
-		defaultShader = new Shader(
-			R"(
-			#version 460 core
-
-			layout(location = 0) in vec3 position;
-
-			out vec3 outColor;
-
-			uniform vec3 color;
-
-			uniform mat4 model;
-			uniform mat4 view;
-			uniform mat4 projection;
-
-			void main()
-			{
-				outColor = color;
-				gl_Position = projection * view * model * vec4(position, 1.0f);
-			}	
-		)",
-
-			R"(
-			#version 460 core
-			
-			in vec3 outColor;
-			out vec4 FragColor;
-
-			void main()
-			{	
-				FragColor = vec4(outColor, 1.0f);
-			}
-		)"
-		);
-	}
-
 	const unsigned int axisRingResolution = 80;
 
-	// TODO: We're literally creating a new VAO for every axis object. Bad.
 	vertices.push_back(0.0f);
 	vertices.push_back(0.0f);
 	vertices.push_back(length);
@@ -89,8 +48,52 @@ Axis::Axis(const glm::vec3& direction, float length) :
 		indices.push_back((3 * i + 5) % (axisRingResolution * 3) + 1);
 	}
 
+	// Has to exist before the VAO layout refers to it
+	glGenBuffers(1, &instanceVbo);
+
 	CreateVAO();
+}
+
+AxisMesh::~AxisMesh()
+{
+	glDeleteBuffers(1, &instanceVbo);
+}
+
+void AxisMesh::SetInstances(const Instance* instances, unsigned int count)
+{
+	glBindBuffer(GL_ARRAY_BUFFER, instanceVbo);
+	glBufferData(GL_ARRAY_BUFFER, count * sizeof(Instance), instances, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	instanceCount = count;
+}
 
+void AxisMesh::DrawInstanced()
+{
+	Model::DrawInstanced(instanceCount);
+}
+
+void AxisMesh::DefineVAOLayout()
+{
+	Model::DefineVAOLayout();
+
+	// The model matrix takes up locations 1 to 4, one column each
+	glBindBuffer(GL_ARRAY_BUFFER, instanceVbo);
+	for (unsigned int column = 0; column < 4; column++)
+	{
+		glVertexAttribPointer(1 + column, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), (void*)(offsetof(Instance, model) + column * sizeof(glm::vec4)));
+		glVertexAttribDivisor(1 + column, 1);
+		glEnableVertexAttribArray(1 + column);
+	}
+
+	glVertexAttribPointer(5, 3, GL_FLOAT, GL_FALSE, sizeof(Instance), (void*)offsetof(Instance, color));
+	glVertexAttribDivisor(5, 1);
+	glEnableVertexAttribArray(5);
+}
+
+Axis::Axis(const glm::vec3& direction) :
+	color({0.6f, 0.6f, 0.6f}), modelMatrix(1.0f)
+{
 	float angleBetweenVectors = std::acos(glm::dot(direction, glm::vec3(0.0f, 0.0f, 1.0f)) / glm::length(direction));
 	if (angleBetweenVectors > 0.01)
 	{
@@ -100,15 +103,6 @@ Axis::Axis(const glm::vec3& direction, float length) :
 	modelMatrix = glm::scale(modelMatrix, glm::vec3(0.03f, 0.03f, 1.0f));
 }
 
-void Axis::BindDefaultShader(Camera& camera)
-{
-	defaultShader->Bind();
-	defaultShader->SetMatrix("model", glm::value_ptr(modelMatrix));
-	defaultShader->SetMatrix("view", glm::value_ptr(camera.GetViewMatrix()));
-	defaultShader->SetMatrix("projection", glm::value_ptr(camera.GetProjectionMatrix()));
-	defaultShader->SetVector3("color", glm::value_ptr(color));
-}
-
 const glm::mat4 Axis::GetModelMatrix()
 {
 	return modelMatrix;
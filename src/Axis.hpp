@@ -1,17 +1,42 @@
 #pragma once
 
 #include <glm/vec3.hpp>
+#include <glm/matrix.hpp>
+
 #include "Model.hpp"
 
-class Shader;
-class Camera;
+// What an axis looks like (a long thin cylinder with a cone on top, along z). All axes share one of these
+// and draw it instanced, every instance reads its transform and color from the instance buffer
+class AxisMesh : public Model
+{
+public:
+	struct Instance
+	{
+		glm::mat4 model;
+		glm::vec3 color;
+	};
+
+public:
+	AxisMesh(float length);
+	~AxisMesh();
+
+	void SetInstances(const Instance* instances, unsigned int count);
+	void DrawInstanced();
+
+protected:
+	void DefineVAOLayout() override;
+
+private:
+	unsigned int instanceVbo;
+	unsigned int instanceCount;
+};
 
-class Axis : public Model
+// A single axis, i.e. just a direction and a color. The geometry is in AxisMesh
+class Axis
 {
 public:
-	Axis(const glm::vec3& direction, float length);
+	Axis(const glm::vec3& direction);
 
-	void BindDefaultShader(Camera& camera);
 	const glm::mat4 GetModelMatrix();
 
 	float* GetColorVPtr();
@@ -20,5 +45,5 @@ public:
 	glm::vec3 color;
 
 private:
-	static Shader* defaultShader;
-};
\ No newline at end of file
+	glm::mat4 modelMatrix;
+};
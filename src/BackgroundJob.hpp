@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <utility>
+
+#include "ThreadPool.hpp"
+
+// Produces a T (usually a unique_ptr, empty when cancelled) on the default pool. The function gets the
+// cancel flag and has to capture everything else by value, so it never cares what happens to whoever
+// started it. That's what makes Cancel() (and destroying the job) free: nothing is waited for, a job
+// that's still running finishes on its own and its result is dropped with it.
+template<typename T>
+class BackgroundJob
+{
+public:
+	BackgroundJob() = default;
+	BackgroundJob(BackgroundJob&&) = default;
+	BackgroundJob(const BackgroundJob&) = delete;
+	BackgroundJob& operator=(const BackgroundJob&) = delete;
+
+	~BackgroundJob()
+	{
+		Cancel();
+	}
+
+	// Cancels the job that was running, if any
+	template<typename Function>
+	void Start(Function&& function)
+	{
+		Cancel();
+
+		std::shared_ptr<std::atomic<bool>> flag = std::make_shared<std::atomic<bool>>(false);
+		cancelled = flag;
+		result = ThreadPool::GetDefault().Submit([flag, function = std::forward<Function>(function)]() mutable
+		{
+			return function((const std::atomic<bool>*)flag.get());
+		});
+	}
+
+	void Cancel()
+	{
+		if (!result.valid())
+			return;
+
+		*cancelled = true;
+		cancelled.reset();
+		result = std::future<T>();
+	}
+
+	bool IsRunning() const
+	{
+		return result.valid();
+	}
+
+	// Doesn't wait. Once the job is done its result is moved out and the job is idle again
+	bool Poll(T& value)
+	{
+		if (!result.valid() || result.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			return false;
+
+		value = result.get();
+		cancelled.reset();
+		return true;
+	}
+
+private:
+	std::shared_ptr<std::atomic<bool>> cancelled;
+	std::future<T> result;
+};
@@ -0,0 +1,337 @@
+// Times the GL-free parts of the program (harmonic evaluation, grid generation and index building)
+// and prints the results as JSON, so runs can be compared against each other automatically.
+//
+//		orbitals_bench [--quick] [output.json]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Harmonics.hpp"
+#include "HarmonicsBatch.hpp"
+#include "HarmonicExpansion.hpp"
+#include "ExpansionGrid.hpp"
+#include "HarmonicAnalysis.hpp"
+#include "Hydrogen.hpp"
+#include "BrickedVolume.hpp"
+#include "ElectronCloud.hpp"
+#include "MeshExporter.hpp"
+#include "Isosurface.hpp"
+#include "ScalarVolume.hpp"
+#include "OrbitalMesh.hpp"
+#include "GridIndices.hpp"
+#include "ThreadPool.hpp"
+
+#define PI           3.14159265359
+#define TWO_PI       6.28318530718
+
+struct BenchmarkResult
+{
+	std::string name;
+	int l, m;
+	unsigned int resolution;
+	unsigned int threads;
+
+	size_t samples;				// Per run
+	double nsPerSample;
+};
+
+// Keeps the compiler from throwing away results nobody looks at
+static volatile double sink;
+
+// Runs work (which processes samples samples) often enough to get a stable time, and keeps the best of a few runs
+static double MeasureNsPerSample(size_t samples, const std::function<void()>& work, double minSeconds)
+{
+	typedef std::chrono::steady_clock Clock;
+
+	// Find out how many calls make a run long enough to time
+	work();
+	size_t calls = 1;
+	for (;;)
+	{
+		Clock::time_point start = Clock::now();
+		for (size_t i = 0; i < calls; i++)
+			work();
+
+		double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		if (seconds >= minSeconds)
+			break;
+
+		calls = (seconds > 0.0) ? std::max<size_t>(calls + 1, (size_t)(calls * 1.5 * minSeconds / seconds)) : calls * 10;
+	}
+
+	double best = 1e300;
+	for (int run = 0; run < 5; run++)
+	{
+		Clock::time_point start = Clock::now();
+		for (size_t i = 0; i < calls; i++)
+			work();
+
+		double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		best = std::min(best, seconds / calls);
+	}
+
+	return best * 1e9 / samples;
+}
+
+static void WriteJson(std::ostream& out, const std::vector<BenchmarkResult>& results)
+{
+	out << "{\n";
+	out << "\t\"simd_level\": \"" << GetSimdLevelName(GetSimdLevel()) << "\",\n";
+	out << "\t\"hardware_threads\": " << ThreadPool::GetDefault().GetThreadCount() << ",\n";
+	out << "\t\"results\": [\n";
+
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchmarkResult& result = results[i];
+		out << "\t\t{ \"name\": \"" << result.name << "\", \"l\": " << result.l << ", \"m\": " << result.m
+			<< ", \"resolution\": " << result.resolution << ", \"threads\": " << result.threads
+			<< ", \"samples\": " << result.samples << ", \"ns_per_sample\": " << result.nsPerSample
+			<< ", \"vertices_per_second\": " << 1e9 / result.nsPerSample << " }"
+			<< ((i + 1 < results.size()) ? ",\n" : "\n");
+	}
+
+	out << "\t]\n";
+	out << "}\n";
+}
+
+int main(int argc, char** argv)
+{
+	bool quick = false;
+	std::string outputPath;
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--quick") == 0)
+			quick = true;
+		else
+			outputPath = argv[i];
+	}
+
+	double minSeconds = quick ? 0.01 : 0.1;
+	ThreadPool& pool = ThreadPool::GetDefault();
+	std::vector<BenchmarkResult> results;
+
+	std::vector<int> degrees = quick ? std::vector<int>{ 2, 20 } : std::vector<int>{ 2, 10, 40, 100, 200 };
+	std::vector<unsigned int> resolutions = quick ? std::vector<unsigned int>{ 70, 300 } : std::vector<unsigned int>{ 70, 300, 1000 };
+
+	// Point evaluation, on a fixed set of pseudo random directions
+	const size_t pointCount = 4096;
+	std::vector<float> theta(pointCount), phi(pointCount), values(pointCount);
+	for (size_t i = 0; i < pointCount; i++)
+	{
+		theta[i] = (float)(PI * ((i * 0.618033988749) - std::floor(i * 0.618033988749)));
+		phi[i] = (float)(TWO_PI * ((i * 0.754877666247) - std::floor(i * 0.754877666247)));
+	}
+
+	for (int l : degrees)
+	{
+		for (int m : { 0, l / 2, -l })
+		{
+			double nsPerSample = MeasureNsPerSample(pointCount, [&]()
+			{
+				double sum = 0.0;
+				for (size_t i = 0; i < pointCount; i++)
+					sum += SphericalHarmonic(l, m, theta[i], phi[i]).real();
+
+				sink = sum;
+			}, minSeconds);
+			results.push_back({ "SphericalHarmonic", l, m, 0, 1, pointCount, nsPerSample });
+
+			nsPerSample = MeasureNsPerSample(pointCount, [&]()
+			{
+				EvaluateRealHarmonicsFromAngles(l, m, theta.data(), phi.data(), pointCount, values.data(), nullptr);
+				sink = values[0];
+			}, minSeconds);
+			results.push_back({ "EvaluateRealHarmonicsFromAngles", l, m, 0, 1, pointCount, nsPerSample });
+		}
+	}
+
+	// Whole meshes, single threaded and on the pool
+	for (int l : degrees)
+	{
+		for (unsigned int resolution : resolutions)
+		{
+			size_t vertexCount = (size_t)(resolution + 1) * resolution;
+			for (ThreadPool* meshPool : { (ThreadPool*)nullptr, &pool })
+			{
+				double nsPerSample = MeasureNsPerSample(vertexCount, [&]()
+				{
+					OrbitalMesh mesh(l, l / 2, resolution);
+					mesh.Generate(meshPool);
+					sink = mesh.GetRadius(0);
+				}, minSeconds);
+
+				unsigned int threads = (meshPool == nullptr) ? 1 : pool.GetThreadCount() + 1;
+				results.push_back({ "OrbitalMesh::Generate", l, l / 2, resolution, threads, vertexCount, nsPerSample });
+			}
+
+			// The other mesh types on the pool, per vertex of the grid they stand in for
+			const std::pair<MeshType, const char*> types[] = {
+				{ MeshType::Adaptive, "OrbitalMesh::Generate (adaptive)" },
+				{ MeshType::Healpix, "OrbitalMesh::Generate (HEALPix)" },
+				{ MeshType::Icosphere, "OrbitalMesh::Generate (icosphere)" }
+			};
+
+			for (const auto& type : types)
+			{
+				double nsPerSample = MeasureNsPerSample(vertexCount, [&]()
+				{
+					OrbitalMesh mesh(l, l / 2, resolution, VertexFormat::Float, type.first);
+					mesh.Generate(&pool);
+					sink = mesh.GetRadius(0);
+				}, minSeconds);
+				results.push_back({ type.second, l, l / 2, resolution, pool.GetThreadCount() + 1, vertexCount, nsPerSample });
+			}
+		}
+	}
+
+	// Superpositions with a basis that's already there, which is what a change of coefficients costs
+	for (int maxL : quick ? std::vector<int>{ 2, 8 } : std::vector<int>{ 2, 8, 20 })
+	{
+		std::shared_ptr<HarmonicExpansion> expansion = std::make_shared<HarmonicExpansion>(maxL);
+		for (size_t i = 0; i < expansion->coefficients.size(); i++)
+			expansion->coefficients[i] = 1.0 / (1.0 + i);
+
+		for (unsigned int resolution : resolutions)
+		{
+			size_t vertexCount = (size_t)(resolution + 1) * resolution;
+			std::shared_ptr<const ExpansionBasis> basis = ExpansionBasis::GetShared(maxL, resolution);
+
+			double nsPerSample = MeasureNsPerSample(vertexCount, [&]()
+			{
+				OrbitalMesh mesh(expansion, resolution);
+				mesh.basis = basis;
+				mesh.Generate(&pool);
+				sink = mesh.GetRadius(0);
+			}, minSeconds);
+			results.push_back({ "OrbitalMesh::Generate (superposition)", maxL, 0, resolution, pool.GetThreadCount() + 1, vertexCount, nsPerSample });
+		}
+	}
+
+	// Analysis at the highest band limit each resolution allows, per sample of the grid
+	for (unsigned int resolution : resolutions)
+	{
+		int maxL = HarmonicAnalysis::GetMaxBandLimit(resolution);
+		OrbitalMesh mesh(maxL / 2, maxL / 4, resolution);
+		mesh.Generate(&pool);
+
+		HarmonicAnalysis analysis(resolution, maxL);
+		double nsPerSample = MeasureNsPerSample(mesh.GetVertexCount(), [&]()
+		{
+			sink = analysis.Analyze(mesh.radii.data(), &pool).coefficients[0];
+		}, minSeconds);
+		results.push_back({ "HarmonicAnalysis::Analyze", maxL, 0, resolution, pool.GetThreadCount() + 1, mesh.GetVertexCount(), nsPerSample });
+	}
+
+	// Hydrogen volumes and their isosurfaces, per sample of the volume
+	for (unsigned int size : { 64u, 128u })
+	{
+		HydrogenWavefunction wavefunction(4, 2, 1);
+		size_t sampleCount = (size_t)size * size * size;
+
+		ScalarVolume volume;
+		double nsPerSample = MeasureNsPerSample(sampleCount, [&]()
+		{
+			wavefunction.Sample(volume, size, 0.0, &pool);
+			sink = volume.maxAbs;
+		}, minSeconds);
+		results.push_back({ "HydrogenWavefunction::Sample", 2, 1, size, pool.GetThreadCount() + 1, sampleCount, nsPerSample });
+
+		nsPerSample = MeasureNsPerSample(sampleCount, [&]()
+		{
+			Isosurface surface;
+			surface.Extract(volume, 0.1f * volume.maxAbs, 1.0f, &pool);
+			sink = (double)surface.GetTriangleCount();
+		}, minSeconds);
+		results.push_back({ "Isosurface::Extract", 2, 1, size, pool.GetThreadCount() + 1, sampleCount, nsPerSample });
+	}
+
+	// Bricked density volumes, per cell of the whole volume (most of which is skipped)
+	for (unsigned int cells : { 128u, 256u })
+	{
+		HydrogenWavefunction wavefunction(4, 2, 1);
+		size_t cellCount = (size_t)cells * cells * cells;
+		double nsPerSample = MeasureNsPerSample(cellCount, [&]()
+		{
+			BrickedVolume volume;
+			volume.Build(wavefunction, cells, 1e-4f, (size_t)1 << 20, &pool);
+			sink = (double)volume.GetBrickCount();
+		}, minSeconds);
+		results.push_back({ "BrickedVolume::Build", 2, 1, cells, pool.GetThreadCount() + 1, cellCount, nsPerSample });
+	}
+
+	// Electron clouds, per point
+	for (int n : { 1, 4 })
+	{
+		ElectronCloud cloud(HydrogenWavefunction(n, n - 1, 0));
+		size_t pointCount = (size_t)1 << 22;
+		double nsPerSample = MeasureNsPerSample(pointCount, [&]()
+		{
+			cloud.Generate(1, pointCount, &pool);
+			sink = cloud.positions[0];
+		}, minSeconds);
+		results.push_back({ "ElectronCloud::Generate", n - 1, 0, 0, pool.GetThreadCount() + 1, pointCount, nsPerSample });
+	}
+
+	// Mesh export, per vertex, into the temp directory. Mostly measures how fast the disk takes the bytes
+	{
+		OrbitalMesh mesh(10, 5, resolutions.back());
+		mesh.Generate(&pool);
+
+		for (MeshFileFormat format : { MeshFileFormat::Ply, MeshFileFormat::Glb, MeshFileFormat::Stl })
+		{
+			MeshExporter exporter(format);
+			std::string path = (std::filesystem::temp_directory_path() / (std::string("orbitals_bench.") + exporter.GetExtension())).string();
+			double nsPerSample = MeasureNsPerSample(mesh.GetVertexCount(), [&]()
+			{
+				sink = exporter.Write(mesh, path);
+			}, minSeconds);
+			std::filesystem::remove(path);
+
+			results.push_back({ std::string("MeshExporter::Write (") + exporter.GetExtension() + ")", 10, 5, mesh.resolution, 1, mesh.GetVertexCount(), nsPerSample });
+		}
+	}
+
+	// Index buffers, per vertex of the grid
+	for (unsigned int resolution : resolutions)
+	{
+		size_t vertexCount = (size_t)(resolution + 1) * resolution;
+		for (IndexEncoding encoding : { IndexEncoding::TriangleList, IndexEncoding::TriangleStrip })
+		{
+			double nsPerSample = MeasureNsPerSample(vertexCount, [&]()
+			{
+				GridIndices indices(resolution, encoding);
+				sink = (double)indices.GetCount();
+			}, minSeconds);
+
+			const char* name = (encoding == IndexEncoding::TriangleList) ? "GridIndices (list)" : "GridIndices (strip)";
+			results.push_back({ name, 0, 0, resolution, 1, vertexCount, nsPerSample });
+		}
+	}
+
+	if (outputPath.empty())
+	{
+		WriteJson(std::cout, results);
+		return 0;
+	}
+
+	std::ofstream file(outputPath);
+	if (!file)
+	{
+		std::cerr << "Failed to open " << outputPath << " for writing" << std::endl;
+		return -1;
+	}
+
+	WriteJson(file, results);
+	return 0;
+}
@@ -0,0 +1,219 @@
+#include "BrickedVolume.hpp"
+
+#define FOUR_PI      12.5663706144
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+#include "Hydrogen.hpp"
+#include "HarmonicsBatch.hpp"
+#include "ThreadPool.hpp"
+
+bool BrickedVolume::Build(const HydrogenWavefunction& wavefunction, unsigned int cells, float threshold, size_t maxBricks, ThreadPool* pool, const std::atomic<bool>* cancelled)
+{
+	gridSize = std::max(1u, (cells + brickCells - 1) / brickCells);
+	this->cells = gridSize * brickCells;
+	extent = (float)wavefunction.GetExtent();
+	truncated = false;
+
+	float spacing = 2.0f * extent / this->cells;
+
+	auto isCancelled = [&]() { return cancelled != nullptr && *cancelled; };
+
+	auto forEach = [&](size_t count, const std::function<void(size_t)>& task)
+	{
+		if (pool == nullptr)
+		{
+			for (size_t i = 0; i < count; i++)
+				task(i);
+		}
+		else
+		{
+			pool->ParallelFor(count, task);
+		}
+	};
+
+	// The largest |R_nl| in radial bins a quarter cell wide, from a few samples per bin. R is smooth
+	// at that scale, the margin covers what the samples miss between them
+	double radiusLimit = extent * std::sqrt(3.0);
+	double binWidth = 0.25 * spacing;
+	size_t binCount = (size_t)std::ceil(radiusLimit / binWidth) + 1;
+	std::vector<float> radialBound(binCount);
+	for (size_t bin = 0; bin < binCount; bin++)
+	{
+		double largest = 0.0;
+		for (int i = 0; i <= 4; i++)
+			largest = std::max(largest, std::abs(wavefunction.Radial((bin + i * 0.25) * binWidth)));
+
+		radialBound[bin] = (float)(1.1 * largest);
+	}
+
+	// Unsöld: the squares of all harmonics of degree l add up to (2l + 1) / 4pi everywhere
+	float angularBound = (float)std::sqrt((2.0 * wavefunction.l + 1.0) / FOUR_PI);
+	float peakBound = *std::max_element(radialBound.begin(), radialBound.end()) * angularBound;
+	peakBound *= peakBound;
+
+	float cutoff = threshold * peakBound;
+
+	// The bricks that could get above the cutoff, from the radii between their nearest and farthest point
+	std::vector<size_t> candidates;
+	indirection.assign((size_t)gridSize * gridSize * gridSize, -1);
+	for (unsigned int z = 0; z < gridSize; z++)
+	{
+		for (unsigned int y = 0; y < gridSize; y++)
+		{
+			for (unsigned int x = 0; x < gridSize; x++)
+			{
+				unsigned int brick[3] = { x, y, z };
+				double nearest = 0.0, farthest = 0.0;
+				for (int axis = 0; axis < 3; axis++)
+				{
+					double low = -extent + (double)brick[axis] * brickCells * spacing;
+					double high = low + brickCells * spacing;
+
+					double closest = (low > 0.0) ? low : ((high < 0.0) ? high : 0.0);
+					double furthest = std::max(std::abs(low), std::abs(high));
+					nearest += closest * closest;
+					farthest += furthest * furthest;
+				}
+
+				size_t first = (size_t)(std::sqrt(nearest) / binWidth);
+				size_t last = std::min((size_t)(std::sqrt(farthest) / binWidth), binCount - 1);
+				float bound = *std::max_element(radialBound.begin() + first, radialBound.begin() + last + 1) * angularBound;
+
+				if (bound * bound >= cutoff)
+					candidates.push_back(GetIndirectionIndex(x, y, z));
+			}
+		}
+	}
+
+	// R_nl through a table a sixteenth of a cell apart, the recurrence and the exponential cost more than the whole
+	// rest of a sample. Linear interpolation is off by about step^2 R'' / 8 in between, far below what's visible.
+	// The harmonic's normalization is folded in
+	double tableStep = spacing / 16.0;
+	double angularScale = wavefunction.GetAngularScale();
+	std::vector<float> radialTable((size_t)std::ceil(radiusLimit / tableStep) + 2);
+	forEach(radialTable.size(), [&](size_t i) { radialTable[i] = (float)(wavefunction.Radial(i * tableStep) * angularScale); });
+
+	auto sampleBrick = [&](size_t index, float* out)
+	{
+		unsigned int bx = (unsigned int)(index % gridSize), by = (unsigned int)((index / gridSize) % gridSize), bz = (unsigned int)(index / ((size_t)gridSize * gridSize));
+
+		std::vector<float> xs(brickSize), ys(brickSize), zs(brickSize);
+		size_t i = 0;
+		for (unsigned int z = 0; z < brickSamples; z++)
+		{
+			for (unsigned int y = 0; y < brickSamples; y++)
+			{
+				for (unsigned int x = 0; x < brickSamples; x++, i++)
+				{
+					xs[i] = -extent + (bx * brickCells + x) * spacing;
+					ys[i] = -extent + (by * brickCells + y) * spacing;
+					zs[i] = -extent + (bz * brickCells + z) * spacing;
+				}
+			}
+		}
+
+		// The kernel wants directions, at the nucleus any will do (R_nl is 0 there for l > 0)
+		std::vector<float> directionZ(zs);
+		for (i = 0; i < brickSize; i++)
+		{
+			if (xs[i] == 0.0f && ys[i] == 0.0f && zs[i] == 0.0f)
+				directionZ[i] = 1.0f;
+		}
+
+		EvaluateRealHarmonics(wavefunction.l, wavefunction.m, xs.data(), ys.data(), directionZ.data(), brickSize, out, nullptr);
+
+		float largest = 0.0f;
+		for (i = 0; i < brickSize; i++)
+		{
+			float position = std::sqrt(xs[i] * xs[i] + ys[i] * ys[i] + zs[i] * zs[i]) / (float)tableStep;
+			size_t entry = std::min((size_t)position, radialTable.size() - 2);
+			float t = position - entry;
+			out[i] *= radialTable[entry] + t * (radialTable[entry + 1] - radialTable[entry]);
+
+			out[i] *= std::abs(out[i]);
+			largest = std::max(largest, std::abs(out[i]));
+		}
+
+		return largest;
+	};
+
+	// Bricks above the cutoff take the next free slot while there are any, so usually a single pass does it.
+	// Their densest sample is kept either way, in case the budget runs out and the densest have to be picked
+	size_t slots = std::min(candidates.size(), maxBricks);
+	samples.resize(slots * brickSize);
+
+	std::vector<float> brickPeak(candidates.size());
+	std::atomic<size_t> nextSlot{ 0 };
+	forEach(candidates.size(), [&](size_t candidate)
+	{
+		if (isCancelled())
+			return;
+
+		std::vector<float> brick(brickSize);
+		brickPeak[candidate] = sampleBrick(candidates[candidate], brick.data());
+		if (brickPeak[candidate] < cutoff)
+			return;
+
+		size_t slot = nextSlot++;
+		if (slot < slots)
+		{
+			std::copy(brick.begin(), brick.end(), samples.begin() + slot * brickSize);
+			indirection[candidates[candidate]] = (int32_t)slot;
+		}
+	});
+
+	if (isCancelled())
+		return false;
+
+	size_t occupied = nextSlot;
+	if (occupied > slots)
+	{
+		// Over budget, only the densest bricks stay and they're sampled again
+		truncated = true;
+		std::vector<size_t> order(candidates.size());
+		for (size_t i = 0; i < order.size(); i++)
+			order[i] = i;
+
+		std::nth_element(order.begin(), order.begin() + slots, order.end(), [&](size_t a, size_t b) { return brickPeak[a] > brickPeak[b]; });
+		order.resize(slots);
+
+		std::fill(indirection.begin(), indirection.end(), -1);
+		forEach(slots, [&](size_t slot)
+		{
+			if (isCancelled())
+				return;
+
+			size_t index = candidates[order[slot]];
+			sampleBrick(index, samples.data() + slot * brickSize);
+			indirection[index] = (int32_t)slot;
+		});
+
+		if (isCancelled())
+			return false;
+
+		occupied = slots;
+	}
+
+	samples.resize(occupied * brickSize);
+	samples.shrink_to_fit();
+
+	peak = 0.0f;
+	for (size_t candidate = 0; candidate < candidates.size(); candidate++)
+		peak = std::max(peak, brickPeak[candidate]);
+
+	if (peak > 0.0f)
+	{
+		float scale = 1.0f / peak;
+		forEach(occupied, [&](size_t slot)
+		{
+			float* brick = samples.data() + slot * brickSize;
+			for (size_t i = 0; i < brickSize; i++)
+				brick[i] *= scale;
+		});
+	}
+
+	return !isCancelled();
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class HydrogenWavefunction;
+class ThreadPool;
+
+// The density |psi|^2 of a HydrogenWavefunction over [-extent, extent]^3, kept only where there is any.
+// The cells are grouped into bricks of brickCells^3, and only bricks whose density gets above the threshold
+// are sampled and stored, each with its own brickSamples^3 corners so it can be filtered on its own. An
+// indirection grid maps every brick of the volume to its data or marks it empty.
+//
+// Bricks are ruled out before evaluating a single sample by bounding psi over them: the largest |R_nl| over
+// the radii the brick covers times the largest any harmonic of degree l gets, sqrt((2l + 1) / 4pi). That skips
+// the space far from the nucleus, and the radial nodes where it's wide enough. What's left is sampled in
+// parallel, one brick per task. The stored bricks never take more than maxBricks, if there are more the
+// densest are kept, so the memory stays bounded whatever the resolution.
+class BrickedVolume
+{
+public:
+	static const unsigned int brickCells = 8;
+	static const unsigned int brickSamples = brickCells + 1;
+	static const size_t brickSize = brickSamples * brickSamples * brickSamples;
+
+	// Cells per axis are rounded up to whole bricks, the threshold is relative to the bound on the peak density.
+	// Returns false if cancelled before it was done
+	bool Build(const HydrogenWavefunction& wavefunction, unsigned int cells, float threshold, size_t maxBricks,
+		ThreadPool* pool = nullptr, const std::atomic<bool>* cancelled = nullptr);
+
+	size_t GetBrickCount() const { return samples.size() / brickSize; }
+	size_t GetByteSize() const { return samples.size() * sizeof(float) + indirection.size() * sizeof(int32_t); }
+
+	// What a dense float grid of the same resolution would take
+	size_t GetDenseByteSize() const { return (size_t)(cells + 1) * (cells + 1) * (cells + 1) * sizeof(float); }
+
+	size_t GetIndirectionIndex(unsigned int x, unsigned int y, unsigned int z) const { return ((size_t)z * gridSize + y) * gridSize + x; }
+
+public:
+	float extent;
+	unsigned int cells, gridSize;
+
+	// Largest density of all samples, the stored values are relative to it
+	float peak;
+
+	// True if there were more bricks above the threshold than maxBricks
+	bool truncated;
+
+	// Per brick of the grid (x fastest), the index of its data or -1 if it's empty
+	std::vector<int32_t> indirection;
+
+	// brickSize samples per stored brick (x fastest), psi |psi| / peak, so the density keeps the sign of psi
+	std::vector<float> samples;
+};
@@ -3,7 +3,7 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 Camera::Camera(float fov, float aspectRatio) :
-	viewMatrix(1.0f), position(0.0f), 
+	viewMatrix(1.0f), viewDirty(true), position(0.0f), 
 	front({ 0.0f, 0.0f, -1.0f }), up({ 0.0f, 1.0f, 0.0f }), 
 	yawPitchRoll({ -90.0f, 0.0f, 0.0f })
 {
@@ -13,6 +13,17 @@ Camera::Camera(float fov, float aspectRatio) :
 void Camera::SetPosition(const glm::vec3& position)
 {
 	this->position = position;
+	viewDirty = true;
+}
+
+void Camera::LookAt(const glm::vec3& target)
+{
+	front = glm::normalize(target - position);
+
+	// Keep the angles in sync so mouse movement continues from here
+	yawPitchRoll.x = glm::degrees(atan2(front.z, front.x));
+	yawPitchRoll.y = glm::degrees(asin(front.y));
+	viewDirty = true;
 }
 
 void Camera::UpdatePerspective(float fov, float aspectRatio)
@@ -23,16 +34,19 @@ void Camera::UpdatePerspective(float fov, float aspectRatio)
 void Camera::MoveForward(float amount, float frametime)
 {
 	position += amount * front * frametime;
+	viewDirty = true;
 }
 
 void Camera::MoveRight(float amount, float frametime)
 {
 	position += amount * glm::normalize(glm::cross(front, up)) * frametime;
+	viewDirty = true;
 }
 
 void Camera::MoveUp(float amount, float frametime)
 {
 	position += amount * up * frametime;
+	viewDirty = true;
 }
 
 void Camera::HandleMouseMoved(double deltaX, double deltaY, float sensitivity, float frametime)
@@ -53,11 +67,17 @@ void Camera::HandleMouseMoved(double deltaX, double deltaY, float sensitivity, f
 	direction.y = sin(glm::radians(yawPitchRoll.y));
 	direction.z = sin(glm::radians(yawPitchRoll.x)) * cos(glm::radians(yawPitchRoll.y));
 	front = glm::normalize(direction);
+	viewDirty = true;
 }
 
 const glm::mat4& Camera::GetViewMatrix()
 {
-	viewMatrix = glm::lookAt(position, position + front, up);
+	if (viewDirty)
+	{
+		viewMatrix = glm::lookAt(position, position + front, up);
+		viewDirty = false;
+	}
+
 	return viewMatrix;
 }
 
@@ -8,6 +8,7 @@ public:
 	Camera(float fov, float aspectRatio);
 
 	void SetPosition(const glm::vec3& position);
+	void LookAt(const glm::vec3& target);
 	void UpdatePerspective(float fov, float aspectRatio);
 
 	void MoveForward(float amount, float frametime);
@@ -16,11 +17,14 @@ public:
 
 	void HandleMouseMoved(double deltaX, double deltaY, float sensitivity, float frametime);
 
+	// The view matrix is only recomputed after the camera moved
 	const glm::mat4& GetViewMatrix();
 	const glm::mat4& GetProjectionMatrix() const;
+	const glm::vec3& GetPosition() const { return position; }
 
 private:
 	glm::mat4 viewMatrix;
+	bool viewDirty;
 	glm::mat4 projectionMatrix;
 
 	glm::vec3 position;
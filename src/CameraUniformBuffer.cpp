@@ -0,0 +1,44 @@
+#include "CameraUniformBuffer.hpp"
+
+#include <glad/glad.h>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "Camera.hpp"
+
+// Laid out according to std140, every member is 16 byte aligned already
+struct CameraBlock
+{
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::mat4 viewProjection;
+	glm::vec4 position;
+};
+
+CameraUniformBuffer::CameraUniformBuffer() :
+	ubo(0)
+{
+	glGenBuffers(1, &ubo);
+	glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(CameraBlock), nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+CameraUniformBuffer::~CameraUniformBuffer()
+{
+	glDeleteBuffers(1, &ubo);
+}
+
+void CameraUniformBuffer::Update(Camera& camera)
+{
+	CameraBlock block;
+	block.view = camera.GetViewMatrix();
+	block.projection = camera.GetProjectionMatrix();
+	block.viewProjection = block.projection * block.view;
+	block.position = glm::vec4(camera.GetPosition(), 1.0f);
+
+	glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(CameraBlock), &block);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, ubo);
+}
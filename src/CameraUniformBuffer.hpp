@@ -0,0 +1,32 @@
+#pragma once
+
+class Camera;
+
+// The camera matrices as a std140 uniform block, shared by every shader that declares
+//
+//		layout(std140, binding = 0) uniform Camera
+//		{
+//			mat4 view;
+//			mat4 projection;
+//			mat4 viewProjection;
+//			vec4 cameraPosition;
+//		};
+//
+// Update() once per frame (or whenever the camera changes) instead of setting the matrices on every shader.
+class CameraUniformBuffer
+{
+public:
+	CameraUniformBuffer();
+	~CameraUniformBuffer();
+
+	CameraUniformBuffer(const CameraUniformBuffer&) = delete;
+	CameraUniformBuffer& operator=(const CameraUniformBuffer&) = delete;
+
+	// Uploads the camera's matrices and binds the buffer to the binding point
+	void Update(Camera& camera);
+
+	static const unsigned int bindingPoint = 0;
+
+private:
+	unsigned int ubo;
+};
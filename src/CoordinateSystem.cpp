@@ -4,7 +4,6 @@
 
 #include "Shader.hpp"
 #include "Axis.hpp"
-#include "Camera.hpp"
 
 Shader* CoordinateSystem::defaultShader = nullptr;
 
@@ -19,19 +18,26 @@ CoordinateSystem::CoordinateSystem() :
 
 			layout(location = 0) in vec3 position;
 
+			// Per axis
+			layout(location = 1) in mat4 axisModel;
+			layout(location = 5) in vec3 axisColor;
+
 			out vec3 outColor;
 
-			uniform vec3 axisColor;
+			layout(std140, binding = 0) uniform Camera
+			{
+				mat4 view;
+				mat4 projection;
+				mat4 viewProjection;
+				vec4 cameraPosition;
+			};
 
-			uniform mat4 axisModel;
 			uniform mat4 model;
-			uniform mat4 view;
-			uniform mat4 projection;
 
 			void main()
 			{
 				outColor = axisColor;
-				gl_Position = projection * view * model * axisModel * vec4(position, 1.0f);
+				gl_Position = viewProjection * model * axisModel * vec4(position, 1.0f);
 			}	
 		)",
 
@@ -49,13 +55,15 @@ CoordinateSystem::CoordinateSystem() :
 		);
 	}
 
-	axes[0] = new Axis(glm::vec3(1.0f, 0.0f, 0.0f), 4.0f);
+	axisMesh = new AxisMesh(4.0f);
+
+	axes[0] = new Axis(glm::vec3(1.0f, 0.0f, 0.0f));
 	axes[0]->color = glm::vec3(1.0f, 0.0f, 0.0f);
 
-	axes[1] = new Axis(glm::vec3(0.0f, 1.0f, 0.0f), 4.0f);
+	axes[1] = new Axis(glm::vec3(0.0f, 1.0f, 0.0f));
 	axes[1]->color = glm::vec3(0.0f, 1.0f, 0.0f);
 
-	axes[2] = new Axis(glm::vec3(0.0f, 0.0f, 1.0f), 4.0f);
+	axes[2] = new Axis(glm::vec3(0.0f, 0.0f, 1.0f));
 	axes[2]->color = glm::vec3(0.0f, 0.0f, 1.0f);
 
 }
@@ -65,23 +73,24 @@ CoordinateSystem::~CoordinateSystem()
 	delete axes[2];
 	delete axes[1];
 	delete axes[0];
+
+	delete axisMesh;
 }
 
-void CoordinateSystem::BindDefaultShader(Camera& camera)
+void CoordinateSystem::BindDefaultShader()
 {
 	defaultShader->Bind();
 
 	defaultShader->SetMatrix("model", glm::value_ptr(modelMatrix));
-	defaultShader->SetMatrix("view", glm::value_ptr(camera.GetViewMatrix()));
-	defaultShader->SetMatrix("projection", glm::value_ptr(camera.GetProjectionMatrix()));
 }
 
 void CoordinateSystem::Draw()
 {
-	for (Axis* axis : axes)
-	{
-		defaultShader->SetMatrix("axisModel", glm::value_ptr(axis->GetModelMatrix()));
-		defaultShader->SetVector3("axisColor", glm::value_ptr(axis->color));
-		axis->Draw();
-	}
+	// The colors can change any time, three instances are cheap enough to just upload every frame
+	std::array<AxisMesh::Instance, 3> instances;
+	for (unsigned int i = 0; i < axes.size(); i++)
+		instances[i] = { axes[i]->GetModelMatrix(), axes[i]->color };
+
+	axisMesh->SetInstances(instances.data(), (unsigned int)instances.size());
+	axisMesh->DrawInstanced();
 }
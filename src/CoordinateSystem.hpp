@@ -7,7 +7,6 @@
 #include "Axis.hpp"
 
 class Shader;
-class Camera;
 
 class CoordinateSystem
 {
@@ -15,13 +14,14 @@ public:
 	CoordinateSystem();
 	~CoordinateSystem();
 
-	void BindDefaultShader(Camera& camera);
+	void BindDefaultShader();
 	void Draw();
 
 	Axis* GetAxis(unsigned int index) { return axes[index]; };
 
 private:
 	std::array<Axis*, 3> axes;
+	AxisMesh* axisMesh;
 	glm::mat4 modelMatrix;
 
 	static Shader* defaultShader;
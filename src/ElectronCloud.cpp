@@ -0,0 +1,160 @@
+#include "ElectronCloud.hpp"
+
+#define PI           3.14159265359
+#define TWO_PI       6.28318530718
+
+#include <algorithm>
+#include <cmath>
+
+#include "Harmonics.hpp"
+#include "Hydrogen.hpp"
+#include "Philox.hpp"
+#include "ThreadPool.hpp"
+
+void InverseCdf::Build(const std::vector<double>& density, double low, double high, size_t size)
+{
+	// The CDF at the density's points, by the trapezoidal rule
+	double step = (high - low) / (density.size() - 1);
+	std::vector<double> cumulative(density.size(), 0.0);
+	for (size_t k = 1; k < density.size(); k++)
+		cumulative[k] = cumulative[k - 1] + 0.5 * (density[k - 1] + density[k]) * step;
+
+	// Then inverted at evenly spaced probabilities, linear in between the points
+	values.resize(size + 1);
+	size_t k = 0;
+	for (size_t j = 0; j <= size; j++)
+	{
+		double target = cumulative.back() * j / size;
+		while (k + 2 < density.size() && cumulative[k + 1] < target)
+			k++;
+
+		double width = cumulative[k + 1] - cumulative[k];
+		double t = (width > 0.0) ? std::clamp((target - cumulative[k]) / width, 0.0, 1.0) : 0.0;
+		values[j] = (float)(low + (k + t) * step);
+	}
+}
+
+ElectronCloud::ElectronCloud(const HydrogenWavefunction& wavefunction, size_t tableSize)
+{
+	unsigned int l = wavefunction.l, absM = std::abs(wavefunction.m);
+	extent = (float)wavefunction.GetExtent();
+
+	// The densities are sampled a lot finer than the tables, so the inversion doesn't lose the narrow lobes
+	size_t points = 8 * tableSize + 1;
+	std::vector<double> density(points);
+
+	for (size_t k = 0; k < points; k++)
+	{
+		double r = extent * k / (points - 1);
+		double radial = wavefunction.Radial(r);
+		density[k] = r * r * radial * radial;
+	}
+	radius.Build(density, 0.0, extent, tableSize);
+
+	radiusSigns.resize(radius.values.size());
+	for (size_t j = 0; j < radius.values.size(); j++)
+		radiusSigns[j] = wavefunction.Radial(radius.values[j]) < 0.0;
+
+	// Pbar_l^|m| from the end of its column
+	LegendreRecurrence recurrence(l);
+	std::vector<double> column(l - absM + 1);
+	auto legendre = [&](double theta)
+	{
+		recurrence.EvaluateColumn(absM, std::cos(theta), std::sin(theta), column.data());
+		return column.back();
+	};
+
+	for (size_t k = 0; k < points; k++)
+	{
+		double theta = PI * k / (points - 1);
+		double value = legendre(theta);
+		density[k] = value * value * std::sin(theta);
+	}
+	cosTheta.Build(density, 0.0, PI, tableSize);
+
+	thetaSigns.resize(cosTheta.values.size());
+	for (size_t j = 0; j < cosTheta.values.size(); j++)
+	{
+		thetaSigns[j] = legendre(cosTheta.values[j]) < 0.0;
+		cosTheta.values[j] = (float)std::cos(cosTheta.values[j]);
+	}
+
+	// cos(m phi) for m >= 0, sin(|m| phi) for m < 0, like RealSphericalHarmonic
+	auto trig = [&](double phi) { return (wavefunction.m >= 0) ? std::cos(absM * phi) : std::sin(absM * phi); };
+	for (size_t k = 0; k < points; k++)
+	{
+		double value = trig(TWO_PI * k / (points - 1));
+		density[k] = value * value;
+	}
+
+	InverseCdf phi;
+	phi.Build(density, 0.0, TWO_PI, tableSize);
+
+	phiSigns.resize(phi.values.size());
+	cosPhi.values.resize(phi.values.size());
+	sinPhi.values.resize(phi.values.size());
+	for (size_t j = 0; j < phi.values.size(); j++)
+	{
+		phiSigns[j] = trig(phi.values[j]) < 0.0;
+		cosPhi.values[j] = (float)std::cos(phi.values[j]);
+		sinPhi.values[j] = (float)std::sin(phi.values[j]);
+	}
+}
+
+void ElectronCloud::Sample(uint64_t seed, size_t first, size_t count, float* positions, unsigned char* signs) const
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		uint32_t random[4];
+		Philox4x32(first + i, seed, random);
+
+		float u0 = PhiloxToUnit(random[0]), u1 = PhiloxToUnit(random[1]), u2 = PhiloxToUnit(random[2]);
+
+		uint32_t nearestRadius, nearestTheta, nearestPhi;
+		float r = radius.Lookup(u0, nearestRadius);
+		float z = cosTheta.Lookup(u1, nearestTheta);
+		float rho = r * std::sqrt(std::max(0.0f, 1.0f - z * z));
+
+		// Both phi tables have the same entries
+		float x = cosPhi.Lookup(u2, nearestPhi);
+		float y = sinPhi.Lookup(u2, nearestPhi);
+
+		positions[3 * i + 0] = rho * x;
+		positions[3 * i + 1] = rho * y;
+		positions[3 * i + 2] = r * z;
+
+		// The sign of psi is the product of the factors' signs. Right at a node the nearest entry might be on the
+		// wrong side, but the density is 0 there anyway
+		signs[i] = radiusSigns[nearestRadius] ^ thetaSigns[nearestTheta] ^ phiSigns[nearestPhi];
+	}
+}
+
+bool ElectronCloud::Generate(uint64_t seed, size_t count, ThreadPool* pool, const std::atomic<bool>* cancelled)
+{
+	positions.resize(3 * count);
+	signs.resize(count);
+
+	const size_t chunkSize = 65536;
+	size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+	auto sampleChunk = [&](size_t chunk)
+	{
+		if (cancelled != nullptr && *cancelled)
+			return;
+
+		size_t first = chunk * chunkSize;
+		size_t last = std::min(first + chunkSize, count);
+		Sample(seed, first, last - first, positions.data() + 3 * first, signs.data() + first);
+	};
+
+	if (pool == nullptr)
+	{
+		for (size_t chunk = 0; chunk < chunkCount; chunk++)
+			sampleChunk(chunk);
+	}
+	else
+	{
+		pool->ParallelFor(chunkCount, sampleChunk);
+	}
+
+	return (cancelled == nullptr || !*cancelled);
+}
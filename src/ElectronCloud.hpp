@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class HydrogenWavefunction;
+class ThreadPool;
+
+// A density on an interval turned into its inverse CDF, tabulated at evenly spaced probabilities so a
+// uniform number maps to a sample with one lookup and a linear interpolation
+class InverseCdf
+{
+public:
+	// density holds the density at evenly spaced points from low to high (at least 2)
+	void Build(const std::vector<double>& density, double low, double high, size_t size);
+
+	// u in [0, 1), also gives the index of the entry closest to u
+	float Lookup(float u, uint32_t& nearest) const
+	{
+		float position = u * (float)(values.size() - 1);
+		uint32_t i = (uint32_t)position;
+		float t = position - (float)i;
+		nearest = i + (t >= 0.5f);
+		return values[i] + t * (values[i + 1] - values[i]);
+	}
+
+public:
+	std::vector<float> values;
+};
+
+// Positions of the electron drawn from |psi_nlm|^2, the dot picture of an orbital.
+//
+// In spherical coordinates the probability r^2 |psi|^2 dr sin(theta) dtheta dphi factors into
+//
+//		r^2 R_nl(r)^2 dr  *  Pbar_l^|m|(cos theta)^2 sin(theta) dtheta  *  (cos or sin)(|m| phi)^2 dphi
+//
+// so r, theta and phi are independent and each is drawn from its own InverseCdf, no rejection needed. The
+// angular tables come from the LegendreRecurrence like the harmonics themselves. Sample i takes its
+// three uniform numbers from the Philox counter i, so a cloud is the same for the same seed no matter how
+// many threads generated it, and any range of it can be generated on its own.
+class ElectronCloud
+{
+public:
+	ElectronCloud(const HydrogenWavefunction& wavefunction, size_t tableSize = 4096);
+
+	// Samples first, ..., first + count - 1 of the seed's sequence. xyz per sample into positions,
+	// 1 into signs where psi is negative there (for coloring) and 0 elsewhere
+	void Sample(uint64_t seed, size_t first, size_t count, float* positions, unsigned char* signs) const;
+
+	// count samples spread over the pool in chunks. Returns false if cancelled before it was done
+	bool Generate(uint64_t seed, size_t count, ThreadPool* pool = nullptr, const std::atomic<bool>* cancelled = nullptr);
+
+	// Where nearly all of the probability is, in Bohr radii
+	float GetExtent() const { return extent; }
+
+public:
+	std::vector<float> positions;
+	std::vector<unsigned char> signs;
+
+private:
+	InverseCdf radius, cosTheta, cosPhi, sinPhi;
+
+	// Per table entry, 1 where the factor is negative there
+	std::vector<unsigned char> radiusSigns, thetaSigns, phiSigns;
+
+	float extent;
+};
@@ -0,0 +1,92 @@
+// Checks that electron clouds are reproducible: Philox4x32-10 against the known answers of the reference
+// implementation (Random123), then clouds generated with pools of different sizes and any range sampled on
+// its own against a serial run, which all have to match bit for bit. Runs as a CTest.
+//
+//		orbitals_check_cloud
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "ElectronCloud.hpp"
+#include "Hydrogen.hpp"
+#include "Philox.hpp"
+#include "ThreadPool.hpp"
+
+static bool CheckPhilox()
+{
+	struct KnownAnswer
+	{
+		uint32_t counter[4];
+		uint32_t key[2];
+		uint32_t expected[4];
+	};
+
+	// kat_vectors of Random123, philox4x32 with 10 rounds
+	const KnownAnswer answers[] =
+	{
+		{ { 0x00000000, 0x00000000, 0x00000000, 0x00000000 }, { 0x00000000, 0x00000000 }, { 0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8 } },
+		{ { 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff }, { 0xffffffff, 0xffffffff }, { 0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd } },
+		{ { 0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344 }, { 0xa4093822, 0x299f31d0 }, { 0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1 } }
+	};
+
+	bool passed = true;
+	for (const KnownAnswer& answer : answers)
+	{
+		uint32_t out[4];
+		Philox4x32(answer.counter, answer.key, out);
+		passed &= std::memcmp(out, answer.expected, sizeof(out)) == 0;
+	}
+
+	// The 64 bit counter is the lower half of the full one
+	uint32_t full[4], short64[4];
+	const uint32_t counter[4] = { 0x89abcdef, 0x01234567, 0, 0 }, key[2] = { 0x76543210, 0xfedcba98 };
+	Philox4x32(counter, key, full);
+	Philox4x32(0x0123456789abcdefull, 0xfedcba9876543210ull, short64);
+	passed &= std::memcmp(full, short64, sizeof(full)) == 0;
+
+	std::cout << "Philox4x32-10 known answers: " << (passed ? "match" : "don't match (FAILED)") << std::endl;
+	return passed;
+}
+
+static bool CheckCloud(int n, int l, int m)
+{
+	const uint64_t seed = 12345;
+	const size_t count = 200000;
+
+	HydrogenWavefunction wavefunction(n, l, m);
+	ElectronCloud serial(wavefunction);
+	serial.Generate(seed, count);
+
+	bool passed = true;
+	for (unsigned int threadCount : { 1u, 3u, 8u })
+	{
+		ThreadPool pool(threadCount);
+		ElectronCloud parallel(wavefunction);
+		parallel.Generate(seed, count, &pool);
+
+		passed &= parallel.positions == serial.positions && parallel.signs == serial.signs;
+	}
+
+	// A range in the middle on its own, not starting on a chunk boundary
+	const size_t first = 12345, rangeCount = 54321;
+	std::vector<float> positions(3 * rangeCount);
+	std::vector<unsigned char> signs(rangeCount);
+	serial.Sample(seed, first, rangeCount, positions.data(), signs.data());
+	passed &= std::memcmp(positions.data(), serial.positions.data() + 3 * first, positions.size() * sizeof(float)) == 0;
+	passed &= std::memcmp(signs.data(), serial.signs.data() + first, signs.size()) == 0;
+
+	std::cout << "Cloud n = " << n << ", l = " << l << ", m = " << m << ": " << (passed ? "reproducible" : "differs (FAILED)") << std::endl;
+	return passed;
+}
+
+int main()
+{
+	bool passed = CheckPhilox();
+	passed &= CheckCloud(1, 0, 0);
+	passed &= CheckCloud(3, 2, -1);
+	passed &= CheckCloud(6, 4, 3);
+
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,96 @@
+#include "ExpansionGrid.hpp"
+
+#define TWO_PI       6.28318530718
+#define PI           3.14159265359
+
+#include <algorithm>
+#include <cmath>
+
+#include "HarmonicExpansion.hpp"
+#include "Harmonics.hpp"
+
+std::map<std::pair<int, unsigned int>, std::weak_ptr<const ExpansionBasis>> ExpansionBasis::sharedBases;
+std::mutex ExpansionBasis::sharedMutex;
+
+ExpansionBasis::ExpansionBasis(int maxL, unsigned int resolution) :
+	maxL(maxL), resolution(resolution), triangularSize(LegendreRecurrence::TriangularSize(maxL)),
+	recurrence(maxL), columnTrig((2 * (size_t)maxL + 1) * resolution)
+{
+	if ((resolution + 1) * triangularSize * sizeof(double) <= maxTableBytes)
+	{
+		ringLegendre.resize((resolution + 1) * triangularSize);
+		for (unsigned int ring = 0; ring <= resolution; ring++)
+		{
+			double theta = ring * PI / resolution;
+			recurrence.EvaluateAll(std::cos(theta), std::abs(std::sin(theta)), ringLegendre.data() + ring * triangularSize);
+		}
+	}
+
+	for (int m = 0; m <= maxL; m++)
+	{
+		double* cosines = columnTrig.data() + (size_t)m * resolution;
+		double* sines = columnTrig.data() + (size_t)(maxL + m) * resolution;
+		for (unsigned int column = 0; column < resolution; column++)
+		{
+			// Reduced on the grid like in HarmonicGrid
+			double mPhi = ((unsigned long long)m * column % resolution) * TWO_PI / resolution;
+			cosines[column] = std::cos(mPhi);
+
+			// k = maxL is cos(maxL phi), the sines start after it
+			if (m > 0)
+				sines[column] = std::sin(mPhi);
+		}
+	}
+}
+
+const double* ExpansionBasis::GetRingLegendre(unsigned int ring, double* scratch) const
+{
+	if (!ringLegendre.empty())
+		return ringLegendre.data() + ring * triangularSize;
+
+	double theta = ring * PI / resolution;
+	recurrence.EvaluateAll(std::cos(theta), std::abs(std::sin(theta)), scratch);
+	return scratch;
+}
+
+std::shared_ptr<const ExpansionBasis> ExpansionBasis::GetShared(int maxL, unsigned int resolution)
+{
+	std::lock_guard<std::mutex> lock(sharedMutex);
+	std::weak_ptr<const ExpansionBasis>& slot = sharedBases[{ maxL, resolution }];
+
+	std::shared_ptr<const ExpansionBasis> basis = slot.lock();
+	if (basis == nullptr)
+	{
+		basis = std::make_shared<ExpansionBasis>(maxL, resolution);
+		slot = basis;
+	}
+
+	return basis;
+}
+
+ExpansionGrid::ExpansionGrid(const ExpansionBasis& basis, const HarmonicExpansion& expansion) :
+	basis(basis), termCount(2 * basis.GetMaxL() + 1),
+	ringWeights((size_t)basis.GetRingCount() * termCount, 0.0)
+{
+	int maxL = std::min(basis.GetMaxL(), expansion.GetMaxL());
+	std::vector<double> scratch(LegendreRecurrence::TriangularSize(basis.GetMaxL()));
+
+	for (unsigned int ring = 0; ring < basis.GetRingCount(); ring++)
+	{
+		const double* legendre = basis.GetRingLegendre(ring, scratch.data());
+		double* weights = ringWeights.data() + (size_t)ring * termCount;
+
+		for (int l = 0; l <= maxL; l++)
+		{
+			const double* c = expansion.coefficients.data() + HarmonicExpansion::GetIndex(l, 0);
+			const double* pbar = legendre + LegendreRecurrence::TriangularIndex(l, 0);
+
+			weights[0] += c[0] * pbar[0];
+			for (int m = 1; m <= l; m++)
+			{
+				weights[m] += c[m] * pbar[m];
+				weights[basis.GetMaxL() + m] += c[-m] * pbar[m];
+			}
+		}
+	}
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "Harmonics.hpp"
+
+class HarmonicExpansion;
+
+// Every real harmonic up to maxL on Orbital's theta/phi grid (see HarmonicGrid), kept in separated form:
+// Pbar_l^m(cos theta) for all 0 <= m <= l <= maxL per ring, from a single LegendreRecurrence::EvaluateAll()
+// sweep, and cos(m phi), sin(m phi) for m = 0, ..., maxL per column. Only depends on maxL and the resolution,
+// so an orbital keeps it around while its coefficients change.
+//
+// The Legendre table grows with resolution * maxL^2, past maxTableBytes (band limits in the hundreds, from
+// HarmonicAnalysis) it isn't kept and every ring is evaluated again when it's needed.
+class ExpansionBasis
+{
+public:
+	ExpansionBasis(int maxL, unsigned int resolution);
+
+	int GetMaxL() const { return maxL; }
+	unsigned int GetResolution() const { return resolution; }
+	unsigned int GetRingCount() const { return resolution + 1; }
+	size_t GetVertexCount() const { return (size_t)GetRingCount() * resolution; }
+
+	// Pbar_l^m of the ring at LegendreRecurrence::TriangularIndex(l, m). Without a table
+	// they're evaluated into scratch, which has to hold LegendreRecurrence::TriangularSize(maxL) values
+	const double* GetRingLegendre(unsigned int ring, double* scratch) const;
+
+	// cos(m phi) of every column for k = m, sin(m phi) for k = maxL + m, m > 0
+	const double* GetColumnTrig(unsigned int k) const { return columnTrig.data() + (size_t)k * resolution; }
+
+	size_t GetByteSize() const { return (ringLegendre.size() + columnTrig.size()) * sizeof(double); }
+
+	// Bases are shared for as long as someone holds on to them
+	static std::shared_ptr<const ExpansionBasis> GetShared(int maxL, unsigned int resolution);
+
+	static const size_t maxTableBytes = 64 * 1024 * 1024;
+
+private:
+	int maxL;
+	unsigned int resolution;
+	size_t triangularSize;
+
+	LegendreRecurrence recurrence;
+	std::vector<double> ringLegendre;
+	std::vector<double> columnTrig;
+
+	static std::map<std::pair<int, unsigned int>, std::weak_ptr<const ExpansionBasis>> sharedBases;
+	static std::mutex sharedMutex;
+};
+
+// A HarmonicExpansion on the grid of a basis. The l sums are done per ring when this is constructed,
+//
+//		f(ring, column) = sum over m of A_m(ring) * cos(m phi) + B_m(ring) * sin(m phi),
+//		A_m = sum over l of c_lm Pbar_l^m,		B_m = sum over l of c_l(-m) Pbar_l^m
+//
+// which is O(maxL^2) per ring, after that every sample only costs 2 maxL + 1 multiply-adds.
+// New coefficients only need a new ExpansionGrid, the basis stays as it is.
+class ExpansionGrid
+{
+public:
+	// The basis has to cover the expansion's maxL and outlive the grid
+	ExpansionGrid(const ExpansionBasis& basis, const HarmonicExpansion& expansion);
+
+	unsigned int GetResolution() const { return basis.GetResolution(); }
+	unsigned int GetRingCount() const { return basis.GetRingCount(); }
+	size_t GetVertexCount() const { return basis.GetVertexCount(); }
+
+	// Same as HarmonicGrid::FillValues()
+	template<typename Output, typename Convert>
+	void FillValues(unsigned int firstRing, unsigned int lastRing, Output* out, Convert convert) const
+	{
+		unsigned int resolution = basis.GetResolution();
+		std::vector<double> row(resolution);
+
+		for (unsigned int ring = firstRing; ring < lastRing; ring++)
+		{
+			// Term by term over the whole ring, so the inner loops run over contiguous columns
+			const double* weights = ringWeights.data() + (size_t)ring * termCount;
+			std::fill(row.begin(), row.end(), weights[0]);
+
+			for (unsigned int k = 1; k < termCount; k++)
+			{
+				double weight = weights[k];
+				if (weight == 0.0)
+					continue;
+
+				const double* trig = basis.GetColumnTrig(k);
+				for (unsigned int column = 0; column < resolution; column++)
+					row[column] += weight * trig[column];
+			}
+
+			for (unsigned int column = 0; column < resolution; column++)
+				*(out++) = convert(row[column]);
+		}
+	}
+
+private:
+	const ExpansionBasis& basis;
+	unsigned int termCount;				// 2 maxL + 1
+
+	// A_0, A_1, ..., A_maxL, B_1, ..., B_maxL per ring
+	std::vector<double> ringWeights;
+};
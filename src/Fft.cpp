@@ -0,0 +1,101 @@
+#include "Fft.hpp"
+
+#define PI           3.14159265359
+
+#include <cmath>
+
+static bool IsPowerOfTwo(size_t n)
+{
+	return (n & (n - 1)) == 0;
+}
+
+static std::vector<std::complex<double>> MakeTwiddles(size_t n)
+{
+	std::vector<std::complex<double>> twiddles(n / 2);
+	for (size_t k = 0; k < n / 2; k++)
+		twiddles[k] = std::polar(1.0, -2.0 * PI * k / n);
+
+	return twiddles;
+}
+
+Fft::Fft(size_t size) :
+	size(size), paddedSize(0)
+{
+	if (IsPowerOfTwo(size))
+	{
+		twiddles = MakeTwiddles(size);
+		return;
+	}
+
+	// Room for the linear convolution of two sequences of length size
+	paddedSize = 1;
+	while (paddedSize < 2 * size - 1)
+		paddedSize *= 2;
+
+	twiddles = MakeTwiddles(paddedSize);
+
+	// j^2 is reduced mod 2 size first, the angles get too large for doubles otherwise
+	chirp.resize(size);
+	for (size_t j = 0; j < size; j++)
+		chirp[j] = std::polar(1.0, -PI * (double)((unsigned long long)j * j % (2 * size)) / size);
+
+	chirpSpectrum.assign(paddedSize, 0.0);
+	chirpSpectrum[0] = std::conj(chirp[0]);
+	for (size_t j = 1; j < size; j++)
+		chirpSpectrum[j] = chirpSpectrum[paddedSize - j] = std::conj(chirp[j]);
+
+	TransformPowerOfTwo(chirpSpectrum.data(), paddedSize, twiddles);
+}
+
+void Fft::Transform(std::complex<double>* data) const
+{
+	if (paddedSize == 0)
+	{
+		TransformPowerOfTwo(data, size, twiddles);
+		return;
+	}
+
+	// X_k = chirp_k * sum over j of (x_j chirp_j) * conj(chirp_(k - j))
+	std::vector<std::complex<double>> padded(paddedSize, 0.0);
+	for (size_t j = 0; j < size; j++)
+		padded[j] = data[j] * chirp[j];
+
+	TransformPowerOfTwo(padded.data(), paddedSize, twiddles);
+	for (size_t k = 0; k < paddedSize; k++)
+		padded[k] = std::conj(padded[k] * chirpSpectrum[k]);
+
+	// The inverse transform is the forward transform of the conjugate, conjugated and scaled
+	TransformPowerOfTwo(padded.data(), paddedSize, twiddles);
+	for (size_t k = 0; k < size; k++)
+		data[k] = chirp[k] * std::conj(padded[k]) / (double)paddedSize;
+}
+
+void Fft::TransformPowerOfTwo(std::complex<double>* data, size_t n, const std::vector<std::complex<double>>& twiddles) const
+{
+	// Bit reversed order first, then log2(n) passes of butterflies in place
+	for (size_t i = 1, j = 0; i < n; i++)
+	{
+		size_t bit = n >> 1;
+		for (; j & bit; bit >>= 1)
+			j ^= bit;
+		j ^= bit;
+
+		if (i < j)
+			std::swap(data[i], data[j]);
+	}
+
+	for (size_t length = 2; length <= n; length *= 2)
+	{
+		size_t stride = n / length;
+		for (size_t start = 0; start < n; start += length)
+		{
+			for (size_t k = 0; k < length / 2; k++)
+			{
+				std::complex<double> even = data[start + k];
+				std::complex<double> odd = data[start + k + length / 2] * twiddles[k * stride];
+				data[start + k] = even + odd;
+				data[start + k + length / 2] = even - odd;
+			}
+		}
+	}
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+// Discrete Fourier transform of one fixed size,
+//
+//		out[k] = sum over j of in[j] * e^(-2pi i jk / size)
+//
+// Powers of two use an iterative radix-2 transform. Every other size goes through Bluestein's algorithm,
+// which writes the transform as a convolution with a chirp and does that with power-of-two transforms.
+// Everything is planned in the constructor, Transform() only reads the plan so threads can share one Fft.
+class Fft
+{
+public:
+	Fft(size_t size);
+
+	size_t GetSize() const { return size; }
+
+	// In place, data holds size values
+	void Transform(std::complex<double>* data) const;
+
+private:
+	void TransformPowerOfTwo(std::complex<double>* data, size_t n, const std::vector<std::complex<double>>& twiddles) const;
+
+	size_t size;
+	std::vector<std::complex<double>> twiddles;		// e^(-2pi i k / n) for k < n / 2, n = size or the padded size
+
+	// Bluestein only
+	size_t paddedSize;
+	std::vector<std::complex<double>> chirp;		// e^(-pi i j^2 / size)
+	std::vector<std::complex<double>> chirpSpectrum;	// Transform of the conjugate chirp, wrapped around to paddedSize
+};
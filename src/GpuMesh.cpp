@@ -0,0 +1,124 @@
+#include "GpuMesh.hpp"
+
+#include <glad/glad.h>
+
+#include "OrbitalMesh.hpp"
+#include "IndexBuffer.hpp"
+#include "SamplingBuffer.hpp"
+
+GpuMesh::GpuMesh() :
+	vao(0), vbo(0), resolution(0), fence(nullptr)
+{
+	glGenVertexArrays(1, &vao);
+	glBindVertexArray(vao);
+
+	glGenBuffers(1, &vbo);
+
+	// Just the signed radius, the shader works out the rest from gl_VertexID
+	glEnableVertexAttribArray(0);
+
+	glBindVertexArray(0);
+}
+
+GpuMesh::~GpuMesh()
+{
+	if (fence != nullptr)
+		glDeleteSync(fence);
+
+	glDeleteBuffers(1, &vbo);
+	glDeleteVertexArrays(1, &vao);
+}
+
+void GpuMesh::Upload(const OrbitalMesh& mesh)
+{
+	if (!mesh.IsSampled())
+	{
+		Upload(mesh.GetVertexData(), mesh.GetVertexByteSize(), mesh.format, mesh.resolution);
+		return;
+	}
+
+	UploadRadii(mesh.GetVertexData(), mesh.GetVertexByteSize(), mesh.format);
+
+	resolution = 0;
+	samplingBuffer = SamplingBuffer::GetShared(mesh.sampling);
+	samplingBuffer->Bind();
+	indexBuffer = samplingBuffer->GetIndexBuffer();
+
+	glBindVertexArray(0);
+
+	PlaceFence();
+}
+
+void GpuMesh::Upload(const void* radii, size_t byteSize, VertexFormat format, unsigned int resolution)
+{
+	UploadRadii(radii, byteSize, format);
+
+	glDisableVertexAttribArray(1);
+	glBindVertexArray(0);
+
+	this->resolution = resolution;
+	samplingBuffer = nullptr;
+	indexBuffer = nullptr;
+	SetEncoding(IndexBuffer::GetDefaultEncoding());
+
+	PlaceFence();
+}
+
+bool GpuMesh::IsReady()
+{
+	if (fence == nullptr)
+		return true;
+
+	GLenum status = glClientWaitSync(fence, 0, 0);
+	if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+		return false;
+
+	glDeleteSync(fence);
+	fence = nullptr;
+	return true;
+}
+
+void GpuMesh::SetEncoding(IndexEncoding encoding)
+{
+	// A triangle list of its own doesn't come in other encodings
+	if (samplingBuffer != nullptr || (indexBuffer != nullptr && indexBuffer->GetEncoding() == encoding))
+		return;
+
+	indexBuffer = IndexBuffer::GetShared(resolution, encoding);
+
+	// The element buffer binding is VAO state
+	glBindVertexArray(vao);
+	indexBuffer->Bind();
+	glBindVertexArray(0);
+}
+
+void GpuMesh::UploadRadii(const void* radii, size_t byteSize, VertexFormat format)
+{
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBufferData(GL_ARRAY_BUFFER, byteSize, radii, GL_STATIC_DRAW);
+
+	// Half floats are converted back to float by the vertex fetch
+	glVertexAttribPointer(0, 1, (format == VertexFormat::Half) ? GL_HALF_FLOAT : GL_FLOAT, GL_FALSE, 0, (void*)0);
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void GpuMesh::PlaceFence()
+{
+	if (fence != nullptr)
+		glDeleteSync(fence);
+
+	fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	glFlush();
+}
+
+void GpuMesh::Draw()
+{
+	if (indexBuffer == nullptr)
+		return;
+
+	glBindVertexArray(vao);
+	indexBuffer->Draw();
+	glBindVertexArray(0);
+}
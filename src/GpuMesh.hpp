@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+#include "GridIndices.hpp"
+#include "OrbitalMesh.hpp"
+
+class IndexBuffer;
+class SamplingBuffer;
+
+typedef struct __GLsync* GLsync;
+
+// An OrbitalMesh that lives on the GPU. After Upload() a fence is placed behind the buffer
+// transfer, so the owner can keep drawing something else until IsReady() says the data has arrived.
+// The indices come from the IndexBuffer shared by all meshes of the same resolution. Sampled meshes take
+// their directions and triangles from the SamplingBuffer of their sampling instead, and report a resolution
+// of 0 so the shader reads the directions.
+class GpuMesh
+{
+public:
+	GpuMesh();
+	~GpuMesh();
+
+	GpuMesh(const GpuMesh&) = delete;
+	GpuMesh& operator=(const GpuMesh&) = delete;
+
+	void Upload(const OrbitalMesh& mesh);
+
+	// The radii of a grid mesh from anywhere, like a MeshArchive's mapping. They're only read during the call
+	void Upload(const void* radii, size_t byteSize, VertexFormat format, unsigned int resolution);
+
+	bool IsReady();
+
+	// Switches to the shared index buffer with a different encoding
+	void SetEncoding(IndexEncoding encoding);
+
+	void Draw();
+
+	unsigned int GetResolution() const { return resolution; }
+
+private:
+	// Leaves the VAO bound
+	void UploadRadii(const void* radii, size_t byteSize, VertexFormat format);
+	void PlaceFence();
+
+private:
+	unsigned int vao, vbo;
+	unsigned int resolution;
+	std::shared_ptr<IndexBuffer> indexBuffer;
+	std::shared_ptr<SamplingBuffer> samplingBuffer;
+
+	GLsync fence;
+};
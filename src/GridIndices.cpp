@@ -0,0 +1,68 @@
+#include "GridIndices.hpp"
+
+#include <limits>
+
+GridIndices::GridIndices(unsigned int resolution, IndexEncoding encoding) :
+	resolution(resolution), encoding(encoding), shortIndices(FitsShort(resolution)), count(0)
+{
+	if (shortIndices)
+		Build(indices16);
+	else
+		Build(indices32);
+}
+
+const void* GridIndices::GetData() const
+{
+	return shortIndices ? (const void*)indices16.data() : (const void*)indices32.data();
+}
+
+bool GridIndices::FitsShort(unsigned int resolution)
+{
+	// 0xFFFF is the restart index
+	return (size_t)(resolution + 1) * resolution <= std::numeric_limits<uint16_t>::max();
+}
+
+template<typename Index>
+void GridIndices::Build(std::vector<Index>& out)
+{
+	if (encoding == IndexEncoding::TriangleList)
+	{
+		out.resize(6 * (size_t)resolution * resolution);
+
+		Index* index = out.data();
+		for (unsigned int ring = 0; ring < resolution; ring++)
+		{
+			for (unsigned int vertex = 0; vertex < resolution; vertex++)
+			{
+				*(index++) = resolution * ring + vertex;
+				*(index++) = resolution * ring + ((vertex + 1) % resolution);
+				*(index++) = resolution * (ring + 1) + ((vertex + 1) % resolution);
+
+				*(index++) = resolution * ring + vertex;
+				*(index++) = resolution * (ring + 1) + ((vertex + 1) % resolution);
+				*(index++) = resolution * (ring + 1) + vertex;
+			}
+		}
+	}
+	else
+	{
+		// Every strip zig-zags between two rings and wraps around to close the ring. Starting
+		// with the vertex of the next ring keeps the winding the same as in the triangle list.
+		out.resize((size_t)resolution * (2 * (resolution + 1) + 1) - 1);
+
+		Index* index = out.data();
+		for (unsigned int ring = 0; ring < resolution; ring++)
+		{
+			if (ring > 0)
+				*(index++) = std::numeric_limits<Index>::max();
+
+			for (unsigned int vertex = 0; vertex <= resolution; vertex++)
+			{
+				*(index++) = resolution * (ring + 1) + (vertex % resolution);
+				*(index++) = resolution * ring + (vertex % resolution);
+			}
+		}
+	}
+
+	count = out.size();
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum class IndexEncoding
+{
+	TriangleList,		// 6 indices per grid cell
+	TriangleStrip		// One strip per pair of rings, separated by primitive restart indices
+};
+
+// The indices connecting the (resolution + 1) rings of resolution vertices each of an orbital grid.
+// They only depend on the resolution, so every orbital of the same resolution can share them.
+// 16 bit indices are used whenever the vertex count allows it, the largest value of the index type
+// is reserved as the primitive restart index.
+class GridIndices
+{
+public:
+	GridIndices(unsigned int resolution, IndexEncoding encoding);
+
+	unsigned int GetResolution() const { return resolution; }
+	IndexEncoding GetEncoding() const { return encoding; }
+
+	bool IsShort() const { return shortIndices; }
+	size_t GetCount() const { return count; }
+	size_t GetByteSize() const { return count * (shortIndices ? sizeof(uint16_t) : sizeof(uint32_t)); }
+	const void* GetData() const;
+
+	static bool FitsShort(unsigned int resolution);
+
+private:
+	template<typename Index>
+	void Build(std::vector<Index>& out);
+
+private:
+	unsigned int resolution;
+	IndexEncoding encoding;
+	bool shortIndices;
+	size_t count;
+
+	std::vector<uint16_t> indices16;
+	std::vector<uint32_t> indices32;
+};
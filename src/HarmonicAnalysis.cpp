@@ -0,0 +1,179 @@
+#include "HarmonicAnalysis.hpp"
+
+#define TWO_PI       6.28318530718
+#define PI           3.14159265359
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "ThreadPool.hpp"
+
+HarmonicAnalysis::HarmonicAnalysis(unsigned int resolution, int maxL) :
+	resolution(resolution), maxL(std::min(maxL, GetMaxBandLimit(resolution))), fft(resolution),
+	recurrence(std::max(this->maxL, 0)), ringWeights(resolution + 1)
+{
+	if (maxL > this->maxL)
+		std::cerr << "Band limit " << maxL << " is too high for resolution " << resolution << ", using " << this->maxL << std::endl;
+
+	// Clenshaw-Curtis on the n + 1 Chebyshev nodes cos(k pi / n), for the integral over cos theta from -1 to 1
+	unsigned int n = resolution;
+	for (unsigned int k = 0; k <= n; k++)
+	{
+		double sum = 0.0;
+		for (unsigned int j = 1; j <= n / 2; j++)
+		{
+			double b = (2 * j == n) ? 1.0 : 2.0;
+			sum += b / (4.0 * j * j - 1.0) * std::cos(((unsigned long long)2 * j * k % (2 * n)) * PI / n);
+		}
+
+		double c = (k == 0 || k == n) ? 1.0 : 2.0;
+		ringWeights[k] = c / n * (1.0 - sum) * TWO_PI / resolution;
+	}
+}
+
+HarmonicExpansion HarmonicAnalysis::Analyze(const float* samples, ThreadPool* pool) const
+{
+	HarmonicExpansion expansion(maxL);
+	unsigned int ringCount = resolution + 1;
+
+	// Only m = 0, ..., maxL of every ring's spectrum are needed, stored m-major for the quadrature
+	std::vector<std::complex<double>> spectra((size_t)(maxL + 1) * ringCount);
+
+	// The samples are real, so two rings share one complex transform: ring a goes into the real part,
+	// ring b into the imaginary part, and the spectra are separated again by their symmetry
+	auto transformRingPair = [&](size_t pair)
+	{
+		size_t a = 2 * pair, b = std::min<size_t>(a + 1, ringCount - 1);
+		std::vector<std::complex<double>> data(resolution);
+		for (unsigned int column = 0; column < resolution; column++)
+			data[column] = { samples[a * resolution + column], (b != a) ? samples[b * resolution + column] : 0.0f };
+
+		fft.Transform(data.data());
+
+		for (int m = 0; m <= maxL; m++)
+		{
+			std::complex<double> z = data[m];
+			std::complex<double> mirrored = std::conj(data[(resolution - m) % resolution]);
+
+			spectra[(size_t)m * ringCount + a] = 0.5 * (z + mirrored);
+			if (b != a)
+				spectra[(size_t)m * ringCount + b] = std::complex<double>(0.0, -0.5) * (z - mirrored);
+		}
+	};
+
+	// Every m is a column of the Legendre recurrence of its own, so they're independent
+	auto integrateOrder = [&](size_t order)
+	{
+		unsigned int m = (unsigned int)order;
+		std::vector<std::complex<double>> sums(maxL - m + 1, 0.0);
+		std::vector<double> legendre(maxL - m + 1);
+
+		// Rings k and resolution - k mirror each other, where Pbar_l^m only changes by (-1)^(l + m).
+		// So the recurrence runs for the northern half only and sees the sum and difference of both rings
+		for (unsigned int ring = 0; 2 * ring <= resolution; ring++)
+		{
+			unsigned int mirror = resolution - ring;
+			std::complex<double> north = ringWeights[ring] * spectra[(size_t)m * ringCount + ring];
+			std::complex<double> south = (mirror != ring) ? ringWeights[mirror] * spectra[(size_t)m * ringCount + mirror] : 0.0;
+			std::complex<double> even = north + south, odd = north - south;
+
+			double theta = ring * PI / resolution;
+			recurrence.EvaluateColumn(m, std::cos(theta), std::abs(std::sin(theta)), legendre.data());
+
+			for (unsigned int l = m; l <= (unsigned int)maxL; l++)
+				sums[l - m] += legendre[l - m] * (((l - m) % 2 == 0) ? even : odd);
+		}
+
+		for (unsigned int l = m; l <= (unsigned int)maxL; l++)
+		{
+			if (m == 0)
+			{
+				expansion.coefficients[HarmonicExpansion::GetIndex(l, 0)] = sums[l].real();
+				continue;
+			}
+
+			expansion.coefficients[HarmonicExpansion::GetIndex(l, m)] = 2.0 * sums[l - m].real();
+			expansion.coefficients[HarmonicExpansion::GetIndex(l, -(int)m)] = -2.0 * sums[l - m].imag();
+		}
+	};
+
+	if (pool == nullptr)
+	{
+		for (size_t pair = 0; pair < (ringCount + 1) / 2; pair++)
+			transformRingPair(pair);
+
+		for (int m = 0; m <= maxL; m++)
+			integrateOrder(m);
+	}
+	else
+	{
+		pool->ParallelFor((ringCount + 1) / 2, transformRingPair);
+		pool->ParallelFor(maxL + 1, integrateOrder);
+	}
+
+	return expansion;
+}
+
+bool LoadSampledGrid(const std::string& path, unsigned int& resolution, std::vector<float>& samples)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file)
+	{
+		std::cerr << "Failed to open sampled grid " << path << std::endl;
+		return false;
+	}
+
+	char magic[4];
+	uint32_t fileResolution = 0;
+	file.read(magic, sizeof(magic));
+	file.read((char*)&fileResolution, sizeof(fileResolution));
+	if (!file || std::memcmp(magic, "SHGD", 4) != 0 || fileResolution < 2)
+	{
+		std::cerr << path << " is not a sampled grid" << std::endl;
+		return false;
+	}
+
+	// The samples have to be exactly what's left of the file, a corrupt resolution mustn't decide how much gets allocated
+	uint64_t sampleCount = ((uint64_t)fileResolution + 1) * fileResolution;
+	std::streamoff start = file.tellg();
+	file.seekg(0, std::ios::end);
+	std::streamoff end = file.tellg();
+	if (start < 0 || end < start || (uint64_t)(end - start) % sizeof(float) != 0 || (uint64_t)(end - start) / sizeof(float) != sampleCount)
+	{
+		std::cerr << path << " doesn't hold the " << sampleCount << " samples its header promises" << std::endl;
+		return false;
+	}
+
+	file.seekg(start);
+	resolution = fileResolution;
+	samples.resize((size_t)sampleCount);
+	file.read((char*)samples.data(), samples.size() * sizeof(float));
+	if (!file)
+	{
+		std::cerr << "Failed to read the samples of " << path << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+bool SaveSampledGrid(const std::string& path, unsigned int resolution, const float* samples)
+{
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+	{
+		std::cerr << "Failed to open " << path << " for writing" << std::endl;
+		return false;
+	}
+
+	uint32_t fileResolution = resolution;
+	file.write("SHGD", 4);
+	file.write((const char*)&fileResolution, sizeof(fileResolution));
+	file.write((const char*)samples, ((size_t)resolution + 1) * resolution * sizeof(float));
+	return (bool)file;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "Fft.hpp"
+#include "HarmonicExpansion.hpp"
+#include "Harmonics.hpp"
+
+class ThreadPool;
+
+// The way back from a surface to its coefficients: takes a function sampled on Orbital's theta/phi grid
+// (see HarmonicGrid, (resolution + 1) x resolution samples ring by ring) and projects it onto every
+// real harmonic up to maxL. This is done in two separable steps:
+//
+//		F_m(ring) = integral of f e^(-i m phi) dphi			one FFT per ring
+//		G_lm = sum over rings of w_ring * Pbar_l^m * F_m(ring)	Clenshaw-Curtis quadrature in theta
+//
+// The rings sit at theta = k pi / resolution, which are exactly the Chebyshev nodes in cos theta, so both
+// steps are exact for band-limited functions as long as maxL <= GetMaxBandLimit(resolution). That costs
+// O(resolution^2 log resolution + resolution maxL^2) = O(L^3), against O(L^4) for projecting on every Y_lm directly.
+//
+// In the basis of HarmonicExpansion (which has norm 1 / sqrt(2) for m != 0) the coefficients come out as
+// c_l0 = G_l0, c_lm = 2 Re(G_lm) and c_l(-m) = -2 Im(G_lm).
+class HarmonicAnalysis
+{
+public:
+	HarmonicAnalysis(unsigned int resolution, int maxL);
+
+	unsigned int GetResolution() const { return resolution; }
+	int GetMaxL() const { return maxL; }
+
+	// With a pool the FFTs are split over the rings and the quadrature over m
+	HarmonicExpansion Analyze(const float* samples, ThreadPool* pool = nullptr) const;
+
+	static int GetMaxBandLimit(unsigned int resolution) { return ((int)resolution - 1) / 2; }
+
+private:
+	unsigned int resolution;
+	int maxL;
+
+	Fft fft;
+	LegendreRecurrence recurrence;
+
+	// Clenshaw-Curtis weights of the rings, with the 2pi / resolution of the phi sum folded in
+	std::vector<double> ringWeights;
+};
+
+// Sampled grid files: the 4 bytes "SHGD", the resolution as a 32 bit unsigned integer, then the
+// (resolution + 1) x resolution samples as 32 bit floats ring by ring. All of it little endian.
+bool LoadSampledGrid(const std::string& path, unsigned int& resolution, std::vector<float>& samples);
+bool SaveSampledGrid(const std::string& path, unsigned int resolution, const float* samples);
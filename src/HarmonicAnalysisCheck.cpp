@@ -0,0 +1,66 @@
+// Round trip through HarmonicAnalysis: expansions with made up coefficients are turned into grid meshes,
+// analyzed again, and the coefficients have to come back. The grid only holds floats, so that's the
+// error allowed. Fails if any coefficient is off by more than that. Runs as a CTest.
+//
+//		orbitals_check_analysis
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <memory>
+
+#include "HarmonicAnalysis.hpp"
+#include "HarmonicExpansion.hpp"
+#include "OrbitalMesh.hpp"
+#include "ThreadPool.hpp"
+
+// Relative to the largest coefficient
+static const double maxError = 1e-6;
+
+int main()
+{
+	struct Case
+	{
+		int maxL;
+		unsigned int resolution;
+		int bandLimit;
+	};
+
+	// The smallest grid that holds the band limit, finer grids up to L = 300, and a band limit above the
+	// expansion's (whose extra coefficients have to come out as 0)
+	const Case cases[] = { { 20, 41, 20 }, { 100, 301, 100 }, { 300, 700, 300 }, { 30, 201, 60 } };
+
+	bool passed = true;
+	for (const Case& test : cases)
+	{
+		std::shared_ptr<HarmonicExpansion> expansion = std::make_shared<HarmonicExpansion>(test.maxL);
+		for (size_t i = 0; i < expansion->coefficients.size(); i++)
+			expansion->coefficients[i] = std::sin(1.7 * i + 0.3) / (1.0 + 0.01 * i);
+
+		OrbitalMesh mesh(expansion, test.resolution);
+		mesh.Generate(&ThreadPool::GetDefault());
+
+		HarmonicAnalysis analysis(test.resolution, test.bandLimit);
+		HarmonicExpansion result = analysis.Analyze(mesh.radii.data(), &ThreadPool::GetDefault());
+
+		double largest = 0.0, worst = 0.0;
+		for (double coefficient : expansion->coefficients)
+			largest = std::max(largest, std::abs(coefficient));
+
+		for (int l = 0; l <= result.GetMaxL(); l++)
+		{
+			for (int m = -l; m <= l; m++)
+			{
+				double expected = (l <= test.maxL) ? expansion->Get(l, m) : 0.0;
+				worst = std::max(worst, std::abs(result.Get(l, m) - expected));
+			}
+		}
+
+		bool casePassed = (result.GetMaxL() == test.bandLimit) && (worst <= maxError * largest);
+		std::cout << "L = " << test.maxL << ", resolution " << test.resolution << ", band limit " << test.bandLimit << ": "
+			<< worst / largest << (casePassed ? "" : " (FAILED)") << std::endl;
+		passed &= casePassed;
+	}
+
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,159 @@
+#include "HarmonicExpansion.hpp"
+
+#include <cmath>
+#include <cstdlib>
+
+HarmonicExpansion::HarmonicExpansion(int maxL) :
+	coefficients(GetSize(maxL), 0.0), maxL(maxL)
+{
+}
+
+void HarmonicExpansion::SetMaxL(int maxL)
+{
+	// Growing only appends, l = maxL + 1 starts right where l = maxL ended
+	this->maxL = maxL;
+	coefficients.resize(GetSize(maxL), 0.0);
+}
+
+double HarmonicExpansion::Get(int l, int m) const
+{
+	if (l > maxL || std::abs(m) > l)
+		return 0.0;
+
+	return coefficients[GetIndex(l, m)];
+}
+
+void HarmonicExpansion::Set(int l, int m, double value)
+{
+	if (std::abs(m) > l)
+		return;
+
+	if (l > maxL)
+		SetMaxL(l);
+
+	coefficients[GetIndex(l, m)] = value;
+}
+
+void HarmonicExpansion::Evolve(double time, double energyScale)
+{
+	for (int l = 1; l <= maxL; l++)
+	{
+		double phase = std::cos(energyScale * l * (l + 1) * time);
+		for (int m = -l; m <= l; m++)
+			coefficients[GetIndex(l, m)] *= phase;
+	}
+}
+
+void HarmonicExpansion::RotateZ(double angle)
+{
+	// cos(m (phi - angle)) = cos(m phi) cos(m angle) + sin(m phi) sin(m angle), and the same for sin
+	for (int m = 1; m <= maxL; m++)
+	{
+		double c = std::cos(m * angle);
+		double s = std::sin(m * angle);
+		for (int l = m; l <= maxL; l++)
+		{
+			double& cosine = coefficients[GetIndex(l, m)];
+			double& sine = coefficients[GetIndex(l, -m)];
+
+			double rotatedCosine = cosine * c - sine * s;
+			sine = sine * c + cosine * s;
+			cosine = rotatedCosine;
+		}
+	}
+}
+
+HarmonicExpansion HarmonicExpansion::Hybrid(HybridOrbital hybrid, int index)
+{
+	// In the orthonormal real basis s = Y_00, p_z = Y_10, d_z2 = Y_20, while p_x, p_y and d_x2-y2 are
+	// sqrt(2) times RealSphericalHarmonic(1, 1), (1, -1) and (2, 2) (there's no Condon-Shortley phase,
+	// so all of them point the usual way)
+	const double sqrt2 = std::sqrt(2.0);
+	double s = 0.0, px = 0.0, py = 0.0, pz = 0.0, dz2 = 0.0, dx2y2 = 0.0;
+
+	switch (hybrid)
+	{
+	case HybridOrbital::Sp:
+		s = 1.0 / sqrt2;
+		pz = (index == 0) ? 1.0 / sqrt2 : -1.0 / sqrt2;
+		break;
+
+	case HybridOrbital::Sp2:
+	{
+		double angle = index * 2.0 * 3.14159265359 / 3.0;
+		s = 1.0 / std::sqrt(3.0);
+		px = std::sqrt(2.0 / 3.0) * std::cos(angle);
+		py = std::sqrt(2.0 / 3.0) * std::sin(angle);
+		break;
+	}
+
+	case HybridOrbital::Sp3:
+	{
+		// The signs of (x, y, z) are (+, +, +), (+, -, -), (-, +, -), (-, -, +)
+		const int signs[4][3] = { { 1, 1, 1 }, { 1, -1, -1 }, { -1, 1, -1 }, { -1, -1, 1 } };
+		s = 0.5;
+		px = 0.5 * signs[index][0];
+		py = 0.5 * signs[index][1];
+		pz = 0.5 * signs[index][2];
+		break;
+	}
+
+	case HybridOrbital::D2sp3:
+	{
+		// +z, -z, +x, -x, +y, -y
+		double sign = (index % 2 == 0) ? 1.0 : -1.0;
+		s = 1.0 / std::sqrt(6.0);
+		if (index < 2)
+		{
+			pz = sign / sqrt2;
+			dz2 = 1.0 / std::sqrt(3.0);
+		}
+		else
+		{
+			if (index < 4)
+				px = sign / sqrt2;
+			else
+				py = sign / sqrt2;
+
+			dz2 = -1.0 / (2.0 * std::sqrt(3.0));
+			dx2y2 = (index < 4) ? 0.5 : -0.5;
+		}
+		break;
+	}
+	}
+
+	HarmonicExpansion expansion(hybrid == HybridOrbital::D2sp3 ? 2 : 1);
+	expansion.Set(0, 0, s);
+	expansion.Set(1, 1, sqrt2 * px);
+	expansion.Set(1, -1, sqrt2 * py);
+	expansion.Set(1, 0, pz);
+	if (hybrid == HybridOrbital::D2sp3)
+	{
+		expansion.Set(2, 0, dz2);
+		expansion.Set(2, 2, sqrt2 * dx2y2);
+	}
+
+	return expansion;
+}
+
+int HarmonicExpansion::GetHybridCount(HybridOrbital hybrid)
+{
+	switch (hybrid)
+	{
+	case HybridOrbital::Sp:		return 2;
+	case HybridOrbital::Sp2:	return 3;
+	case HybridOrbital::Sp3:	return 4;
+	default:					return 6;
+	}
+}
+
+const char* HarmonicExpansion::GetHybridName(HybridOrbital hybrid)
+{
+	switch (hybrid)
+	{
+	case HybridOrbital::Sp:		return "sp";
+	case HybridOrbital::Sp2:	return "sp2";
+	case HybridOrbital::Sp3:	return "sp3";
+	default:					return "d2sp3";
+	}
+}
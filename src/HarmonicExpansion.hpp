@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+enum class HybridOrbital
+{
+	Sp,			// 2 hybrids along +-z
+	Sp2,		// 3 hybrids in the xy plane, 120 degrees apart
+	Sp3,		// 4 hybrids pointing at the corners of a tetrahedron
+	D2sp3		// 6 hybrids along +-x, +-y, +-z
+};
+
+// The coefficients of a real function on the sphere in the basis Orbital displays,
+//
+//		f(theta, phi) = sum over l <= maxL, |m| <= l of c_lm * RealSphericalHarmonic(l, m, theta, phi)
+//
+// Keep in mind that this basis is only orthogonal, not orthonormal: for m != 0 the functions have norm
+// 1 / sqrt(2). Coefficients taken from textbook (orthonormal real) expansions get a factor of sqrt(2)
+// for m != 0, the hybrid presets already include it.
+class HarmonicExpansion
+{
+public:
+	HarmonicExpansion(int maxL = 0);
+
+	int GetMaxL() const { return maxL; }
+
+	// Keeps whatever coefficients still fit
+	void SetMaxL(int maxL);
+
+	// 0 beyond maxL
+	double Get(int l, int m) const;
+
+	// Raises maxL if needed
+	void Set(int l, int m, double value);
+
+	// Real part of the time evolution of the rigid rotor, every c_lm picks up the phase e^(-i E_l time)
+	// with E_l = energyScale * l(l + 1). (Only the real part, since that's what Orbital can display)
+	void Evolve(double time, double energyScale);
+
+	// Turns the function about the z axis, f(theta, phi) -> f(theta, phi - angle). Mixes c_lm with c_l(-m)
+	void RotateZ(double angle);
+
+	static size_t GetIndex(int l, int m) { return (size_t)(l * l + l + m); }
+	static size_t GetSize(int maxL) { return (size_t)(maxL + 1) * (maxL + 1); }
+
+	// One of the standard normalized hybrid orbitals, index < GetHybridCount(hybrid)
+	static HarmonicExpansion Hybrid(HybridOrbital hybrid, int index);
+	static int GetHybridCount(HybridOrbital hybrid);
+	static const char* GetHybridName(HybridOrbital hybrid);
+
+public:
+	// c_lm at GetIndex(l, m)
+	std::vector<double> coefficients;
+
+private:
+	int maxL;
+};
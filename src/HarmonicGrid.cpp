@@ -0,0 +1,29 @@
+#include "HarmonicGrid.hpp"
+
+#define TWO_PI       6.28318530718
+#define PI           3.14159265359
+
+#include <cmath>
+#include <cstdlib>
+
+#include "Harmonics.hpp"
+
+HarmonicGrid::HarmonicGrid(int l, int m, unsigned int resolution) :
+	l(l), m(m), resolution(resolution),
+	ringLegendre(resolution + 1), columnPhase(resolution)
+{
+	unsigned int absM = std::abs(m);
+
+	for (unsigned int ring = 0; ring <= resolution; ring++)
+	{
+		double theta = ring * PI / resolution;
+		ringLegendre[ring] = NormalizedLegendre(l, absM, std::cos(theta), std::abs(std::sin(theta)));
+	}
+
+	for (unsigned int column = 0; column < resolution; column++)
+	{
+		// m * phi is reduced on the grid first so high m doesn't lose precision
+		double mPhi = ((unsigned long long)absM * column % resolution) * TWO_PI / resolution;
+		columnPhase[column] = (m < 0) ? std::sin(mPhi) : std::cos(mPhi);
+	}
+}
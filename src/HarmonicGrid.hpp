@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Evaluates the real harmonic that Orbital displays on its theta/phi grid
+//
+//		theta = ring * pi / resolution,			ring = 0, ..., resolution
+//		phi = column * 2pi / resolution,		column = 0, ..., resolution - 1
+//
+// The harmonic separates into Pbar_l^|m|(cos theta) and cos(m phi) (or sin(|m| phi) for m < 0),
+// so the Legendre part is evaluated once per ring, the trig part once per column, and every
+// grid sample is just a product of the two. (The directions themselves are reconstructed
+// from the sample index in the orbital shader.)
+class HarmonicGrid
+{
+public:
+	HarmonicGrid(int l, int m, unsigned int resolution);
+
+	unsigned int GetResolution() const { return resolution; }
+	unsigned int GetRingCount() const { return resolution + 1; }
+	size_t GetVertexCount() const { return (size_t)GetRingCount() * resolution; }
+
+	double GetValue(unsigned int ring, unsigned int column) const { return ringLegendre[ring] * columnPhase[column]; }
+
+	// Writes the (signed) value of every sample in the rings [firstRing, lastRing) to out,
+	// starting with the first sample of firstRing
+	template<typename Output, typename Convert>
+	void FillValues(unsigned int firstRing, unsigned int lastRing, Output* out, Convert convert) const
+	{
+		for (unsigned int ring = firstRing; ring < lastRing; ring++)
+		{
+			double legendre = ringLegendre[ring];
+			for (unsigned int column = 0; column < resolution; column++)
+				*(out++) = convert(legendre * columnPhase[column]);
+		}
+	}
+
+private:
+	int l, m;
+	unsigned int resolution;
+
+	std::vector<double> ringLegendre;
+	std::vector<double> columnPhase;
+};
@@ -0,0 +1,165 @@
+#include "Harmonics.hpp"
+
+#define FOUR_PI      12.5663706144
+
+#include <cmath>
+
+// sin^m(theta) underflows long before the actual function values do (e.g. for m = 300 near the poles),
+// so the recurrences carry their values scaled by 2^(SCALE_EXPONENT * exponent) and only unscale at the end.
+static const int SCALE_EXPONENT = 480;
+static const double SCALE_UP = std::ldexp(1.0, SCALE_EXPONENT);
+static const double SCALE_DOWN = std::ldexp(1.0, -SCALE_EXPONENT);
+
+static inline double Unscale(double value, int exponent)
+{
+	return (exponent == 0) ? value : std::ldexp(value, -SCALE_EXPONENT * exponent);
+}
+
+// Pbar_m^m / sin^m(theta) is a constant, so build Pbar_m^m from Pbar_(m-1)^(m-1) one factor at a time
+static inline void SectoralStep(double factor, double sinTheta, double& value, int& exponent)
+{
+	value *= factor * sinTheta;
+	if (value != 0.0 && std::abs(value) < SCALE_DOWN)
+	{
+		value *= SCALE_UP;
+		exponent++;
+	}
+}
+
+// Runs the recurrence in l for a fixed m, starting at the (scaled) sectoral value Pbar_m^m.
+// Coefficients(l, a, b) has to provide the recurrence coefficients, emit(l, value) receives the results.
+template<typename Coefficients, typename Emit>
+static inline void ColumnRecurrence(unsigned int m, unsigned int maxL, double x, double sectoral, int exponent, Coefficients coefficients, Emit emit)
+{
+	double previous = sectoral;
+	emit(m, Unscale(previous, exponent));
+	if (maxL == m)
+		return;
+
+	double current = std::sqrt(2.0 * m + 3.0) * x * previous;
+	emit(m + 1, Unscale(current, exponent));
+
+	double a, b;
+	for (unsigned int l = m + 2; l <= maxL; l++)
+	{
+		coefficients(l, a, b);
+		double next = a * (x * current - b * previous);
+		previous = current;
+		current = next;
+
+		// Once the values have grown back into range the scaling isn't needed anymore
+		if (exponent > 0 && std::abs(current) > SCALE_UP)
+		{
+			previous *= SCALE_DOWN;
+			current *= SCALE_DOWN;
+			exponent--;
+		}
+
+		emit(l, Unscale(current, exponent));
+	}
+}
+
+static inline void RecurrenceCoefficients(unsigned int l, unsigned int m, double& a, double& b)
+{
+	double l2 = (double)l * l;
+	double m2 = (double)m * m;
+	a = std::sqrt((4.0 * l2 - 1.0) / (l2 - m2));
+	b = std::sqrt(((l - 1.0) * (l - 1.0) - m2) / (4.0 * (l - 1.0) * (l - 1.0) - 1.0));
+}
+
+LegendreRecurrence::LegendreRecurrence(unsigned int maxL) :
+	maxL(maxL), sectoral(maxL + 1, 0.0), a(TriangularSize(maxL), 0.0), b(TriangularSize(maxL), 0.0)
+{
+	for (unsigned int m = 1; m <= maxL; m++)
+		sectoral[m] = std::sqrt((2.0 * m + 1.0) / (2.0 * m));
+
+	// Only l >= m + 2 actually uses these
+	for (unsigned int l = 2; l <= maxL; l++)
+	{
+		for (unsigned int m = 0; m + 2 <= l; m++)
+			RecurrenceCoefficients(l, m, a[TriangularIndex(l, m)], b[TriangularIndex(l, m)]);
+	}
+}
+
+double LegendreRecurrence::Evaluate(unsigned int l, unsigned int m, double cosTheta, double sinTheta) const
+{
+	if (m > l || l > maxL)
+		return NormalizedLegendre(l, m, cosTheta, sinTheta);
+
+	double value = 1.0 / std::sqrt(FOUR_PI);
+	int exponent = 0;
+	for (unsigned int k = 1; k <= m; k++)
+		SectoralStep(sectoral[k], sinTheta, value, exponent);
+
+	double result = 0.0;
+	ColumnRecurrence(m, l, cosTheta, value, exponent,
+		[&](unsigned int n, double& an, double& bn) { an = a[TriangularIndex(n, m)]; bn = b[TriangularIndex(n, m)]; },
+		[&](unsigned int, double p) { result = p; }
+	);
+
+	return result;
+}
+
+void LegendreRecurrence::EvaluateColumn(unsigned int m, double cosTheta, double sinTheta, double* out) const
+{
+	double value = 1.0 / std::sqrt(FOUR_PI);
+	int exponent = 0;
+	for (unsigned int k = 1; k <= m; k++)
+		SectoralStep(sectoral[k], sinTheta, value, exponent);
+
+	ColumnRecurrence(m, maxL, cosTheta, value, exponent,
+		[&](unsigned int n, double& an, double& bn) { an = a[TriangularIndex(n, m)]; bn = b[TriangularIndex(n, m)]; },
+		[&](unsigned int l, double p) { out[l - m] = p; }
+	);
+}
+
+void LegendreRecurrence::EvaluateAll(double cosTheta, double sinTheta, double* out) const
+{
+	// The sectoral values are carried along from one m to the next, so every value costs O(1)
+	double value = 1.0 / std::sqrt(FOUR_PI);
+	int exponent = 0;
+	for (unsigned int m = 0; m <= maxL; m++)
+	{
+		if (m > 0)
+			SectoralStep(sectoral[m], sinTheta, value, exponent);
+
+		ColumnRecurrence(m, maxL, cosTheta, value, exponent,
+			[&](unsigned int n, double& an, double& bn) { an = a[TriangularIndex(n, m)]; bn = b[TriangularIndex(n, m)]; },
+			[&](unsigned int l, double p) { out[TriangularIndex(l, m)] = p; }
+		);
+	}
+}
+
+double NormalizedLegendre(unsigned int l, unsigned int m, double cosTheta, double sinTheta)
+{
+	if (m > l)
+		return 0.0;
+
+	double value = 1.0 / std::sqrt(FOUR_PI);
+	int exponent = 0;
+	for (unsigned int k = 1; k <= m; k++)
+		SectoralStep(std::sqrt((2.0 * k + 1.0) / (2.0 * k)), sinTheta, value, exponent);
+
+	double result = 0.0;
+	ColumnRecurrence(m, l, cosTheta, value, exponent,
+		[&](unsigned int n, double& an, double& bn) { RecurrenceCoefficients(n, m, an, bn); },
+		[&](unsigned int, double p) { result = p; }
+	);
+
+	return result;
+}
+
+std::complex<double> SphericalHarmonic(unsigned int l, int m, double theta, double phi)
+{
+	double legendre = NormalizedLegendre(l, std::abs(m), std::cos(theta), std::abs(std::sin(theta)));
+	return std::complex<double>(legendre * std::cos(m * phi), legendre * std::sin(m * phi));
+}
+
+double RealSphericalHarmonic(unsigned int l, int m, double theta, double phi)
+{
+	double legendre = NormalizedLegendre(l, std::abs(m), std::cos(theta), std::abs(std::sin(theta)));
+	if (m < 0)
+		return legendre * std::sin(-m * phi);
+
+	return legendre * std::cos(m * phi);
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <complex>
+#include <vector>
+
+// Fully normalized associated Legendre functions
+//
+//		Pbar_l^m(x) = sqrt((2l + 1) / 4pi * (l - m)! / (l + m)!) * P_l^m(x)
+//
+// so that Y_lm(theta, phi) = Pbar_l^m(cos theta) * e^(i m phi). They are computed with the usual
+// three-term recurrences, which never form a factorial and stay stable up to l of several thousand.
+// Just like std::assoc_legendre there is no Condon-Shortley phase.
+//
+// This class precomputes the recurrence coefficients up to some maximum l, use it whenever a lot of
+// values are needed (e.g. for every ring of a mesh)
+class LegendreRecurrence
+{
+public:
+	LegendreRecurrence(unsigned int maxL);
+
+	unsigned int GetMaxL() const { return maxL; }
+
+	// Pbar_l^m(cos theta), expects sinTheta >= 0
+	double Evaluate(unsigned int l, unsigned int m, double cosTheta, double sinTheta) const;
+
+	// Writes Pbar_l^m for l = m, ..., maxL into out[0], ..., out[maxL - m]
+	void EvaluateColumn(unsigned int m, double cosTheta, double sinTheta, double* out) const;
+
+	// Writes Pbar_l^m for every 0 <= m <= l <= maxL into out[TriangularIndex(l, m)]
+	void EvaluateAll(double cosTheta, double sinTheta, double* out) const;
+
+	static size_t TriangularIndex(unsigned int l, unsigned int m) { return (size_t)l * (l + 1) / 2 + m; }
+	static size_t TriangularSize(unsigned int maxL) { return TriangularIndex(maxL + 1, 0); }
+
+private:
+	unsigned int maxL;
+
+	std::vector<double> sectoral;	// sqrt((2m + 1) / 2m), factor between Pbar_(m-1)^(m-1) and Pbar_m^m / sin theta
+	std::vector<double> a, b;		// Coefficients of the recurrence in l, indexed by TriangularIndex(l, m)
+};
+
+// Pbar_l^m(cos theta) without any precomputed tables. Costs O(l) square roots.
+double NormalizedLegendre(unsigned int l, unsigned int m, double cosTheta, double sinTheta);
+
+// The orthonormal spherical harmonic Y_lm (without Condon-Shortley phase, Y_l(-m) = conj(Y_lm))
+std::complex<double> SphericalHarmonic(unsigned int l, int m, double theta, double phi);
+
+// The real valued function that is displayed as an orbital. For m >= 0 this is Re(Y_lm),
+// for m < 0 it's Im(Y_l|m|)
+double RealSphericalHarmonic(unsigned int l, int m, double theta, double phi);
@@ -0,0 +1,172 @@
+#include "HarmonicsBatch.hpp"
+
+#define FOUR_PI      12.5663706144
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#include "HarmonicsBatchKernel.hpp"
+
+// Owns the tables a BatchCoefficients points to
+class BatchCoefficientTable
+{
+public:
+	BatchCoefficientTable(unsigned int l, int m) :
+		a(l + 2, 0.0), b(l + 2, 0.0)
+	{
+		coefficients.l = l;
+		coefficients.m = std::abs(m);
+		coefficients.sine = (m < 0);
+
+		coefficients.sectoral = 1.0 / std::sqrt(FOUR_PI);
+		for (unsigned int k = 1; k <= coefficients.m; k++)
+			coefficients.sectoral *= std::sqrt((2.0 * k + 1.0) / (2.0 * k));
+
+		coefficients.first = std::sqrt(2.0 * coefficients.m + 3.0);
+
+		double m2 = (double)coefficients.m * coefficients.m;
+		for (unsigned int n = coefficients.m + 2; n <= l; n++)
+		{
+			double n2 = (double)n * n;
+			a[n - coefficients.m] = std::sqrt((4.0 * n2 - 1.0) / (n2 - m2));
+			b[n - coefficients.m] = std::sqrt(((n - 1.0) * (n - 1.0) - m2) / (4.0 * (n - 1.0) * (n - 1.0) - 1.0));
+		}
+
+		coefficients.a = a.data();
+		coefficients.b = b.data();
+	}
+
+	const BatchCoefficients& Get() const { return coefficients; }
+
+private:
+	BatchCoefficients coefficients;
+	std::vector<double> a, b;
+};
+
+static SimdLevel DetectSimdLevel()
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f"))
+		return SimdLevel::AVX512;
+	if (__builtin_cpu_supports("avx2"))
+		return SimdLevel::AVX2;
+	if (__builtin_cpu_supports("sse2"))
+		return SimdLevel::SSE2;
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	int info[4];
+	__cpuid(info, 1);
+	bool sse2 = (info[3] & (1 << 26)) != 0;
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+
+	// The OS has to save the wider registers too, otherwise the instructions are useless
+	unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+	bool avxState = (xcr0 & 0x6) == 0x6;
+	bool avx512State = (xcr0 & 0xe6) == 0xe6;
+
+	__cpuidex(info, 7, 0);
+	if (avx512State && (info[1] & (1 << 16)))
+		return SimdLevel::AVX512;
+	if (avxState && (info[1] & (1 << 5)))
+		return SimdLevel::AVX2;
+	if (sse2)
+		return SimdLevel::SSE2;
+#endif
+
+	return SimdLevel::Scalar;
+}
+
+// Also takes into account which kernels were actually compiled in
+static SimdLevel ClampToAvailable(SimdLevel level)
+{
+	if (level == SimdLevel::AVX512 && batchKernelFloatAVX512 == nullptr)
+		level = SimdLevel::AVX2;
+	if (level == SimdLevel::AVX2 && batchKernelFloatAVX2 == nullptr)
+		level = SimdLevel::SSE2;
+	if (level == SimdLevel::SSE2 && batchKernelFloatSSE2 == nullptr)
+		level = SimdLevel::Scalar;
+
+	return level;
+}
+
+static SimdLevel activeLevel = GetSupportedSimdLevel();
+
+void EvaluateRealHarmonics(unsigned int l, int m, const float* x, const float* y, const float* z, size_t count, float* values, unsigned char* signs)
+{
+	BatchCoefficientTable table(l, m);
+
+	BatchKernelFloat kernel = &RealHarmonicKernel<ScalarLanes, float>;
+	switch (activeLevel)
+	{
+	case SimdLevel::AVX512:		kernel = batchKernelFloatAVX512;	break;
+	case SimdLevel::AVX2:		kernel = batchKernelFloatAVX2;		break;
+	case SimdLevel::SSE2:		kernel = batchKernelFloatSSE2;		break;
+	default:															break;
+	}
+
+	kernel(table.Get(), x, y, z, count, values, signs);
+}
+
+void EvaluateRealHarmonicsFromAngles(unsigned int l, int m, const float* theta, const float* phi, size_t count, float* values, unsigned char* signs)
+{
+	BatchCoefficientTable table(l, m);
+
+	BatchKernelDouble kernel = &RealHarmonicKernel<ScalarLanes, double>;
+	switch (activeLevel)
+	{
+	case SimdLevel::AVX512:		kernel = batchKernelDoubleAVX512;	break;
+	case SimdLevel::AVX2:		kernel = batchKernelDoubleAVX2;		break;
+	case SimdLevel::SSE2:		kernel = batchKernelDoubleSSE2;		break;
+	default:															break;
+	}
+
+	// The unit vectors are built in double precision in small chunks, rounding them to float
+	// would cost far more accuracy than the kernel itself loses
+	const size_t chunkSize = 256;
+	double x[chunkSize], y[chunkSize], z[chunkSize];
+	for (size_t start = 0; start < count; start += chunkSize)
+	{
+		size_t chunk = (count - start < chunkSize) ? count - start : chunkSize;
+		for (size_t i = 0; i < chunk; i++)
+		{
+			double sinTheta = std::sin((double)theta[start + i]);
+			x[i] = sinTheta * std::cos((double)phi[start + i]);
+			y[i] = sinTheta * std::sin((double)phi[start + i]);
+			z[i] = std::cos((double)theta[start + i]);
+		}
+
+		kernel(table.Get(), x, y, z, chunk, (values != nullptr) ? values + start : nullptr, (signs != nullptr) ? signs + start : nullptr);
+	}
+}
+
+SimdLevel GetSupportedSimdLevel()
+{
+	return ClampToAvailable(DetectSimdLevel());
+}
+
+SimdLevel GetSimdLevel()
+{
+	return activeLevel;
+}
+
+void SetSimdLevel(SimdLevel level)
+{
+	SimdLevel supported = GetSupportedSimdLevel();
+	activeLevel = ((int)level > (int)supported) ? supported : ClampToAvailable(level);
+}
+
+const char* GetSimdLevelName(SimdLevel level)
+{
+	switch (level)
+	{
+	case SimdLevel::SSE2:		return "SSE2";
+	case SimdLevel::AVX2:		return "AVX2";
+	case SimdLevel::AVX512:		return "AVX-512";
+	default:					return "Scalar";
+	}
+}
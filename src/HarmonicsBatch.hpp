@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+
+// Batched evaluation of the displayed real harmonic (see RealSphericalHarmonic) for many directions at once.
+//
+// The kernels are vectorized over the directions (SSE2, AVX2 or AVX-512, picked at runtime depending on
+// what the CPU supports, with a scalar fallback). They use Pbar_l^m(cos theta) e^(im phi) = Q_l^m(z) (x + iy)^m
+// for unit vectors, where Q_l^m is a polynomial, so no trig functions are needed at all.
+// All arithmetic is done in double precision, the results are within 2 float ULPs of RealSphericalHarmonic
+// at the same direction rounded to float (ULPs measured at max(|Y|, 2^-20 * sqrt((2l + 1) / 4pi)), so near
+// the nodes the bound is absolute rather than relative).
+//
+// values and signs may each be nullptr, signs receives 1 where Y >= 0 and 0 elsewhere.
+
+enum class SimdLevel
+{
+	Scalar, SSE2, AVX2, AVX512
+};
+
+// Directions given as vectors, one array per component. They don't need to be normalized, but must not be zero
+void EvaluateRealHarmonics(unsigned int l, int m, const float* x, const float* y, const float* z, size_t count, float* values, unsigned char* signs);
+
+// Directions given as angles
+void EvaluateRealHarmonicsFromAngles(unsigned int l, int m, const float* theta, const float* phi, size_t count, float* values, unsigned char* signs);
+
+// The best level this CPU (and build) supports
+SimdLevel GetSupportedSimdLevel();
+
+// The level the kernels currently run at. Can be lowered to compare kernels against each other
+SimdLevel GetSimdLevel();
+void SetSimdLevel(SimdLevel level);
+
+const char* GetSimdLevelName(SimdLevel level);
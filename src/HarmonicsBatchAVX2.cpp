@@ -0,0 +1,10 @@
+#include "HarmonicsBatchKernel.hpp"
+
+// This file has to be compiled with AVX2 enabled, see CMakeLists.txt
+#if defined(__AVX2__)
+const BatchKernelFloat batchKernelFloatAVX2 = &RealHarmonicKernel<AVX2Lanes, float>;
+const BatchKernelDouble batchKernelDoubleAVX2 = &RealHarmonicKernel<AVX2Lanes, double>;
+#else
+const BatchKernelFloat batchKernelFloatAVX2 = nullptr;
+const BatchKernelDouble batchKernelDoubleAVX2 = nullptr;
+#endif
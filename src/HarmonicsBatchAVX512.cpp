@@ -0,0 +1,10 @@
+#include "HarmonicsBatchKernel.hpp"
+
+// This file has to be compiled with AVX512 enabled, see CMakeLists.txt
+#if defined(__AVX512F__)
+const BatchKernelFloat batchKernelFloatAVX512 = &RealHarmonicKernel<AVX512Lanes, float>;
+const BatchKernelDouble batchKernelDoubleAVX512 = &RealHarmonicKernel<AVX512Lanes, double>;
+#else
+const BatchKernelFloat batchKernelFloatAVX512 = nullptr;
+const BatchKernelDouble batchKernelDoubleAVX512 = nullptr;
+#endif
@@ -0,0 +1,101 @@
+// Checks every SIMD level of the batch evaluator that this CPU supports against RealSphericalHarmonic,
+// with the error budget promised in HarmonicsBatch.hpp. Prints the worst error per level and fails if
+// any result is off by more than the budget. Runs as a CTest.
+//
+//		orbitals_check_harmonics
+
+#define PI           3.14159265359
+#define TWO_PI       6.28318530718
+#define FOUR_PI      12.5663706144
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "Harmonics.hpp"
+#include "HarmonicsBatch.hpp"
+
+// The budget in float ULPs, see HarmonicsBatch.hpp
+static const double maxUlps = 2.0;
+
+// ULPs of the float result against the reference, measured at max(|Y|, 2^-20 * sqrt((2l + 1) / 4pi))
+static double UlpError(float value, double reference, unsigned int l)
+{
+	double scale = std::max(std::abs(reference), std::ldexp(std::sqrt((2.0 * l + 1.0) / FOUR_PI), -20));
+	int exponent;
+	std::frexp(scale, &exponent);
+	double ulp = std::ldexp(1.0, exponent - 24);
+
+	return std::abs((double)value - (double)(float)reference) / ulp;
+}
+
+int main()
+{
+	// A fixed spread of directions plus the poles and the equator, where the kernels have special cases
+	const size_t count = 2000;
+	std::vector<float> x(count), y(count), z(count), theta(count), phi(count), values(count);
+	std::vector<unsigned char> signs(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		double t = PI * ((i * 0.618033988749) - std::floor(i * 0.618033988749));
+		double p = TWO_PI * ((i * 0.754877666247) - std::floor(i * 0.754877666247));
+		if (i == 0)
+			t = 0.0;
+		else if (i == 1)
+			t = PI;
+		else if (i == 2)
+			t = PI / 2.0;
+
+		// Rounding to float must not push theta past pi, sin(theta) would turn negative
+		theta[i] = (float)t;
+		if (theta[i] > PI)
+			theta[i] = std::nextafter(theta[i], 0.0f);
+
+		phi[i] = (float)p;
+		x[i] = (float)(std::sin(t) * std::cos(p));
+		y[i] = (float)(std::sin(t) * std::sin(p));
+		z[i] = (float)std::cos(t);
+	}
+
+	// The pole directions have to be exactly on the axis, not just close
+	x[0] = y[0] = x[1] = y[1] = 0.0f;
+
+	bool passed = true;
+	for (int level = 0; level <= (int)GetSupportedSimdLevel(); level++)
+	{
+		SetSimdLevel((SimdLevel)level);
+
+		double worst = 0.0;
+		bool signsMatch = true;
+		for (unsigned int l : { 0u, 1u, 2u, 3u, 7u, 16u, 40u, 100u, 200u })
+		{
+			for (int m : { -(int)l, -(int)l / 2, 0, (int)l / 3, (int)l })
+			{
+				EvaluateRealHarmonics(l, m, x.data(), y.data(), z.data(), count, values.data(), signs.data());
+				for (size_t i = 0; i < count; i++)
+				{
+					// The reference at exactly the direction the kernel saw
+					double dx = x[i], dy = y[i], dz = z[i];
+					double reference = RealSphericalHarmonic(l, m, std::atan2(std::sqrt(dx * dx + dy * dy), dz), std::atan2(dy, dx));
+					worst = std::max(worst, UlpError(values[i], reference, l));
+					// Right at a node (values too small for a float included) either sign will do
+					if (values[i] != 0.0f)
+						signsMatch &= (signs[i] == (values[i] > 0.0f));
+				}
+
+				EvaluateRealHarmonicsFromAngles(l, m, theta.data(), phi.data(), count, values.data(), nullptr);
+				for (size_t i = 0; i < count; i++)
+					worst = std::max(worst, UlpError(values[i], RealSphericalHarmonic(l, m, theta[i], phi[i]), l));
+			}
+		}
+
+		bool levelPassed = (worst <= maxUlps) && signsMatch;
+		std::cout << GetSimdLevelName((SimdLevel)level) << ": " << worst << " ULPs" << (signsMatch ? "" : ", signs don't match the values")
+			<< (levelPassed ? "" : " (FAILED)") << std::endl;
+		passed &= levelPassed;
+	}
+
+	return passed ? 0 : 1;
+}
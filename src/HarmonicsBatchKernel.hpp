@@ -0,0 +1,197 @@
+#pragma once
+
+// Internal header of HarmonicsBatch, included by each of its translation units.
+//
+// Every one of those translation units is compiled for a different instruction set, so everything with
+// code in it lives in an anonymous namespace: the linker must never pick e.g. the AVX2 copy of an inline
+// function for the scalar fallback. For the same reason nothing here instantiates standard library templates.
+
+#include <cmath>
+#include <cstddef>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HARMONICS_BATCH_SSE2
+#include <immintrin.h>
+#endif
+
+// Everything the kernels need to know about (l, m), precomputed once per batch
+struct BatchCoefficients
+{
+	unsigned int l, m;			// m = |m|
+	bool sine;					// true for m < 0, i.e. take Im((x + iy)^|m|)
+
+	double sectoral;			// Q_m^m = Pbar_m^m / sin^m(theta)
+	double first;				// Q_(m+1)^m = first * z * Q_m^m
+	const double* a;			// Q_l^m = a[l - m] * (z * Q_(l-1)^m - b[l - m] * Q_(l-2)^m)
+	const double* b;
+};
+
+typedef void (*BatchKernelFloat)(const BatchCoefficients&, const float*, const float*, const float*, size_t, float*, unsigned char*);
+typedef void (*BatchKernelDouble)(const BatchCoefficients&, const double*, const double*, const double*, size_t, float*, unsigned char*);
+
+// nullptr if the respective translation unit wasn't compiled with the instruction set enabled
+extern const BatchKernelFloat batchKernelFloatSSE2, batchKernelFloatAVX2, batchKernelFloatAVX512;
+extern const BatchKernelDouble batchKernelDoubleSSE2, batchKernelDoubleAVX2, batchKernelDoubleAVX512;
+
+namespace
+{
+	struct ScalarLanes
+	{
+		static const size_t width = 1;
+		double v;
+
+		static inline ScalarLanes Load(const float* p) { return { *p }; }
+		static inline ScalarLanes Load(const double* p) { return { *p }; }
+		static inline ScalarLanes Broadcast(double value) { return { value }; }
+
+		inline void Store(float* p) const { *p = (float)v; }
+		inline void StoreSigns(unsigned char* p) const { *p = (v >= 0.0); }
+	};
+
+	inline ScalarLanes operator+(ScalarLanes a, ScalarLanes b) { return { a.v + b.v }; }
+	inline ScalarLanes operator-(ScalarLanes a, ScalarLanes b) { return { a.v - b.v }; }
+	inline ScalarLanes operator*(ScalarLanes a, ScalarLanes b) { return { a.v * b.v }; }
+	inline ScalarLanes operator/(ScalarLanes a, ScalarLanes b) { return { a.v / b.v }; }
+	inline ScalarLanes Sqrt(ScalarLanes a) { return { std::sqrt(a.v) }; }
+
+#if defined(HARMONICS_BATCH_SSE2)
+	struct SSE2Lanes
+	{
+		static const size_t width = 2;
+		__m128d v;
+
+		static inline SSE2Lanes Load(const float* p) { return { _mm_cvtps_pd(_mm_castsi128_ps(_mm_loadl_epi64((const __m128i*)p))) }; }
+		static inline SSE2Lanes Load(const double* p) { return { _mm_loadu_pd(p) }; }
+		static inline SSE2Lanes Broadcast(double value) { return { _mm_set1_pd(value) }; }
+
+		inline void Store(float* p) const { _mm_storel_epi64((__m128i*)p, _mm_castps_si128(_mm_cvtpd_ps(v))); }
+		inline void StoreSigns(unsigned char* p) const
+		{
+			int mask = _mm_movemask_pd(_mm_cmpge_pd(v, _mm_setzero_pd()));
+			for (size_t i = 0; i < width; i++)
+				p[i] = (mask >> i) & 1;
+		}
+	};
+
+	inline SSE2Lanes operator+(SSE2Lanes a, SSE2Lanes b) { return { _mm_add_pd(a.v, b.v) }; }
+	inline SSE2Lanes operator-(SSE2Lanes a, SSE2Lanes b) { return { _mm_sub_pd(a.v, b.v) }; }
+	inline SSE2Lanes operator*(SSE2Lanes a, SSE2Lanes b) { return { _mm_mul_pd(a.v, b.v) }; }
+	inline SSE2Lanes operator/(SSE2Lanes a, SSE2Lanes b) { return { _mm_div_pd(a.v, b.v) }; }
+	inline SSE2Lanes Sqrt(SSE2Lanes a) { return { _mm_sqrt_pd(a.v) }; }
+#endif
+
+#if defined(__AVX2__)
+	struct AVX2Lanes
+	{
+		static const size_t width = 4;
+		__m256d v;
+
+		static inline AVX2Lanes Load(const float* p) { return { _mm256_cvtps_pd(_mm_loadu_ps(p)) }; }
+		static inline AVX2Lanes Load(const double* p) { return { _mm256_loadu_pd(p) }; }
+		static inline AVX2Lanes Broadcast(double value) { return { _mm256_set1_pd(value) }; }
+
+		inline void Store(float* p) const { _mm_storeu_ps(p, _mm256_cvtpd_ps(v)); }
+		inline void StoreSigns(unsigned char* p) const
+		{
+			int mask = _mm256_movemask_pd(_mm256_cmp_pd(v, _mm256_setzero_pd(), _CMP_GE_OQ));
+			for (size_t i = 0; i < width; i++)
+				p[i] = (mask >> i) & 1;
+		}
+	};
+
+	inline AVX2Lanes operator+(AVX2Lanes a, AVX2Lanes b) { return { _mm256_add_pd(a.v, b.v) }; }
+	inline AVX2Lanes operator-(AVX2Lanes a, AVX2Lanes b) { return { _mm256_sub_pd(a.v, b.v) }; }
+	inline AVX2Lanes operator*(AVX2Lanes a, AVX2Lanes b) { return { _mm256_mul_pd(a.v, b.v) }; }
+	inline AVX2Lanes operator/(AVX2Lanes a, AVX2Lanes b) { return { _mm256_div_pd(a.v, b.v) }; }
+	inline AVX2Lanes Sqrt(AVX2Lanes a) { return { _mm256_sqrt_pd(a.v) }; }
+#endif
+
+#if defined(__AVX512F__)
+	struct AVX512Lanes
+	{
+		static const size_t width = 8;
+		__m512d v;
+
+		static inline AVX512Lanes Load(const float* p) { return { _mm512_cvtps_pd(_mm256_loadu_ps(p)) }; }
+		static inline AVX512Lanes Load(const double* p) { return { _mm512_loadu_pd(p) }; }
+		static inline AVX512Lanes Broadcast(double value) { return { _mm512_set1_pd(value) }; }
+
+		inline void Store(float* p) const { _mm256_storeu_ps(p, _mm512_cvtpd_ps(v)); }
+		inline void StoreSigns(unsigned char* p) const
+		{
+			unsigned int mask = _mm512_cmp_pd_mask(v, _mm512_setzero_pd(), _CMP_GE_OQ);
+			for (size_t i = 0; i < width; i++)
+				p[i] = (mask >> i) & 1;
+		}
+	};
+
+	inline AVX512Lanes operator+(AVX512Lanes a, AVX512Lanes b) { return { _mm512_add_pd(a.v, b.v) }; }
+	inline AVX512Lanes operator-(AVX512Lanes a, AVX512Lanes b) { return { _mm512_sub_pd(a.v, b.v) }; }
+	inline AVX512Lanes operator*(AVX512Lanes a, AVX512Lanes b) { return { _mm512_mul_pd(a.v, b.v) }; }
+	inline AVX512Lanes operator/(AVX512Lanes a, AVX512Lanes b) { return { _mm512_div_pd(a.v, b.v) }; }
+	inline AVX512Lanes Sqrt(AVX512Lanes a) { return { _mm512_sqrt_pd(a.v) }; }
+#endif
+
+	// Evaluates V::width directions starting at index i
+	template<typename V, typename T>
+	inline void EvaluateLanes(const BatchCoefficients& c, const T* x, const T* y, const T* z, size_t i, float* values, unsigned char* signs)
+	{
+		V vx = V::Load(x + i), vy = V::Load(y + i), vz = V::Load(z + i);
+
+		// Normalizing in double precision matters, a float "unit" vector is off by enough to cost
+		// hundreds of ULPs once it's raised to the m-th power
+		V inverseLength = V::Broadcast(1.0) / Sqrt(vx * vx + vy * vy + vz * vz);
+		vz = vz * inverseLength;
+
+		// (x + iy)^m = sin^m(theta) e^(im phi), by repeated squaring
+		V baseRe = vx * inverseLength, baseIm = vy * inverseLength;
+		V re = V::Broadcast(1.0), im = V::Broadcast(0.0);
+		for (unsigned int e = c.m; e > 0; e >>= 1)
+		{
+			if (e & 1)
+			{
+				V t = re * baseRe - im * baseIm;
+				im = re * baseIm + im * baseRe;
+				re = t;
+			}
+
+			if (e > 1)
+			{
+				V t = baseRe * baseRe - baseIm * baseIm;
+				baseIm = V::Broadcast(2.0) * baseRe * baseIm;
+				baseRe = t;
+			}
+		}
+
+		// Q_l^m(z) with the same recurrence as the normalized Legendre functions
+		V previous = V::Broadcast(c.sectoral);
+		V current = previous;
+		if (c.l > c.m)
+		{
+			current = V::Broadcast(c.first) * vz * previous;
+			for (unsigned int k = 2; k <= c.l - c.m; k++)
+			{
+				V next = V::Broadcast(c.a[k]) * (vz * current - V::Broadcast(c.b[k]) * previous);
+				previous = current;
+				current = next;
+			}
+		}
+
+		V value = current * (c.sine ? im : re);
+		if (values != nullptr)
+			value.Store(values + i);
+		if (signs != nullptr)
+			value.StoreSigns(signs + i);
+	}
+
+	template<typename V, typename T>
+	void RealHarmonicKernel(const BatchCoefficients& c, const T* x, const T* y, const T* z, size_t count, float* values, unsigned char* signs)
+	{
+		size_t i = 0;
+		for (; i + V::width <= count; i += V::width)
+			EvaluateLanes<V>(c, x, y, z, i, values, signs);
+
+		for (; i < count; i++)
+			EvaluateLanes<ScalarLanes>(c, x, y, z, i, values, signs);
+	}
+}
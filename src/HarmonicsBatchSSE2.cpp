@@ -0,0 +1,10 @@
+#include "HarmonicsBatchKernel.hpp"
+
+// This file has to be compiled with SSE2 enabled, see CMakeLists.txt
+#if defined(HARMONICS_BATCH_SSE2)
+const BatchKernelFloat batchKernelFloatSSE2 = &RealHarmonicKernel<SSE2Lanes, float>;
+const BatchKernelDouble batchKernelDoubleSSE2 = &RealHarmonicKernel<SSE2Lanes, double>;
+#else
+const BatchKernelFloat batchKernelFloatSSE2 = nullptr;
+const BatchKernelDouble batchKernelDoubleSSE2 = nullptr;
+#endif
@@ -0,0 +1,416 @@
+#include "Headless.hpp"
+
+#include <deque>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <tuple>
+
+#include <glad/glad.h>
+
+#if defined(ORBITALS_EGL)
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#include "Orbital.hpp"
+#include "OrbitalMesh.hpp"
+#include "MeshCache.hpp"
+#include "Camera.hpp"
+#include "CameraUniformBuffer.hpp"
+#include "ImageWriter.hpp"
+#include "Shader.hpp"
+#include "ThreadPool.hpp"
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+bool LoadRenderJobs(const std::string& path, std::vector<RenderJob>& jobs)
+{
+	std::ifstream file(path);
+	if (!file)
+	{
+		std::cerr << "Failed to open job file " << path << std::endl;
+		return false;
+	}
+
+	std::string line;
+	unsigned int lineNumber = 0;
+	while (std::getline(file, line))
+	{
+		lineNumber++;
+
+		size_t start = line.find_first_not_of(" \t\r");
+		if (start == std::string::npos || line[start] == '#')
+			continue;
+
+		RenderJob job;
+		std::istringstream stream(line);
+		stream >> job.l >> job.m >> job.resolution >> job.cameraPosition.x >> job.cameraPosition.y >> job.cameraPosition.z >> job.fov >> job.output;
+		if (!stream || job.l < 0 || job.m < -job.l || job.m > job.l || job.resolution < 3)
+		{
+			std::cerr << path << ":" << lineNumber << ": invalid job" << std::endl;
+			return false;
+		}
+
+		jobs.push_back(job);
+	}
+
+	return true;
+}
+
+#if defined(ORBITALS_EGL)
+
+// A context without any surface, everything is drawn into our own framebuffer anyway
+class OffscreenContext
+{
+public:
+	OffscreenContext() :
+		display(EGL_NO_DISPLAY), context(EGL_NO_CONTEXT), surface(EGL_NO_SURFACE)
+	{
+	}
+
+	~OffscreenContext()
+	{
+		if (display == EGL_NO_DISPLAY)
+			return;
+
+		eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		if (surface != EGL_NO_SURFACE)
+			eglDestroySurface(display, surface);
+		if (context != EGL_NO_CONTEXT)
+			eglDestroyContext(display, context);
+
+		eglTerminate(display);
+	}
+
+	bool Create()
+	{
+		// Mesa's surfaceless platform needs neither X nor a GPU, otherwise take whatever the default is
+		PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+		if (getPlatformDisplay != nullptr)
+			display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+		if (display == EGL_NO_DISPLAY)
+			display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+		if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr))
+		{
+			std::cerr << "Failed to initialize EGL" << std::endl;
+			display = EGL_NO_DISPLAY;
+			return false;
+		}
+
+		const EGLint configAttributes[] = {
+			EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+			EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+			EGL_NONE
+		};
+
+		EGLConfig config;
+		EGLint configCount = 0;
+		if (!eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0)
+		{
+			std::cerr << "Failed to find an EGL config for desktop OpenGL" << std::endl;
+			return false;
+		}
+
+		eglBindAPI(EGL_OPENGL_API);
+
+		const EGLint contextAttributes[] = {
+			EGL_CONTEXT_MAJOR_VERSION, 4,
+			EGL_CONTEXT_MINOR_VERSION, 6,
+			EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+			EGL_NONE
+		};
+
+		context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+		if (context == EGL_NO_CONTEXT)
+		{
+			std::cerr << "Failed to create an OpenGL 4.6 core context" << std::endl;
+			return false;
+		}
+
+		// Without EGL_KHR_surfaceless_context there has to be some surface, a tiny pbuffer will do
+		if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+		{
+			const EGLint surfaceAttributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+			surface = eglCreatePbufferSurface(display, config, surfaceAttributes);
+			if (surface == EGL_NO_SURFACE || !eglMakeCurrent(display, surface, surface, context))
+			{
+				std::cerr << "Failed to make the EGL context current" << std::endl;
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+private:
+	EGLDisplay display;
+	EGLContext context;
+	EGLSurface surface;
+};
+
+// Reads frames back through two pixel buffers: the copy of frame N is collected only after
+// frame N + 1 was submitted, so the GPU never waits for the CPU and vice versa
+class FrameReader
+{
+public:
+	FrameReader(unsigned int width, unsigned int height) :
+		width(width), height(height), next(0)
+	{
+		glGenBuffers(2, pbos);
+		for (int i = 0; i < 2; i++)
+		{
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[i]);
+			glBufferData(GL_PIXEL_PACK_BUFFER, GetFrameSize(), nullptr, GL_STREAM_READ);
+
+			fences[i] = nullptr;
+		}
+
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	}
+
+	~FrameReader()
+	{
+		for (int i = 0; i < 2; i++)
+		{
+			if (fences[i] != nullptr)
+				glDeleteSync(fences[i]);
+		}
+
+		glDeleteBuffers(2, pbos);
+	}
+
+	size_t GetFrameSize() const { return 4 * (size_t)width * height; }
+
+	// Starts copying the current framebuffer. Returns the previous frame, if there is one
+	bool Read(const std::string& output, std::string& previousOutput, std::vector<unsigned char>& previousPixels)
+	{
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[next]);
+		glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+		fences[next] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		outputs[next] = output;
+		next = 1 - next;
+
+		return Collect(next, previousOutput, previousPixels);
+	}
+
+	// The frame that is still in flight after the last Read()
+	bool Flush(std::string& lastOutput, std::vector<unsigned char>& lastPixels)
+	{
+		return Collect(1 - next, lastOutput, lastPixels);
+	}
+
+private:
+	bool Collect(int index, std::string& output, std::vector<unsigned char>& pixels)
+	{
+		if (fences[index] == nullptr)
+			return false;
+
+		glClientWaitSync(fences[index], GL_SYNC_FLUSH_COMMANDS_BIT, ~(GLuint64)0);
+		glDeleteSync(fences[index]);
+		fences[index] = nullptr;
+
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, pbos[index]);
+		const unsigned char* data = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, GetFrameSize(), GL_MAP_READ_BIT);
+		pixels.assign(data, data + GetFrameSize());
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+		output = outputs[index];
+		return true;
+	}
+
+private:
+	unsigned int width, height;
+
+	unsigned int pbos[2];
+	GLsync fences[2];
+	std::string outputs[2];
+	int next;
+};
+
+int RunHeadless(const std::vector<RenderJob>& jobs, unsigned int width, unsigned int height)
+{
+	OffscreenContext offscreenContext;
+	if (!offscreenContext.Create())
+		return -1;
+
+	if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress))
+	{
+		std::cerr << "Failed to initialize GLAD" << std::endl;
+		return -1;
+	}
+
+	Shader::SetBinaryCacheDirectory("shader_cache");
+	Shader::EnableParallelCompile((void* (*)(const char*))eglGetProcAddress);
+
+	int exitCode = 0;
+	{
+		unsigned int fbo, renderbuffers[2];
+		glGenFramebuffers(1, &fbo);
+		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+
+		glGenRenderbuffers(2, renderbuffers);
+		glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+
+		glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		{
+			std::cerr << "Offscreen framebuffer is incomplete" << std::endl;
+			return -1;
+		}
+
+		glViewport(0, 0, width, height);
+		glEnable(GL_DEPTH_TEST);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+		// Jobs that share a mesh only generate it once
+		MeshCache meshCache(512 * 1024 * 1024);
+		Orbital orbital(0, 0, &meshCache);
+		Camera camera(110.0f, (float)width / (float)height);
+		CameraUniformBuffer cameraBuffer;
+		FrameReader reader(width, height);
+
+		ThreadPool& pool = ThreadPool::GetDefault();
+
+		// The meshes of the next few jobs are generated while the current one renders. Cached meshes
+		// get an empty future instead, jobs with a mesh that's already being generated share its future
+		const size_t prefetchCount = 2;
+		std::deque<std::shared_future<std::shared_ptr<OrbitalMesh>>> meshes;
+		std::map<std::tuple<int, int, unsigned int>, std::shared_future<std::shared_ptr<OrbitalMesh>>> generating;
+		size_t prefetched = 0;
+
+		// Encoding and writing happens on the pool too, but only so many frames may pile up in memory
+		const size_t maxPendingWrites = 2 * (size_t)pool.GetThreadCount() + 2;
+		std::deque<std::future<bool>> writes;
+		unsigned int failedWrites = 0;
+
+		auto writeFrame = [&](std::string output, std::vector<unsigned char>&& pixels)
+		{
+			if (writes.size() >= maxPendingWrites)
+			{
+				failedWrites += !writes.front().get();
+				writes.pop_front();
+			}
+
+			std::shared_ptr<std::vector<unsigned char>> frame = std::make_shared<std::vector<unsigned char>>(std::move(pixels));
+			writes.push_back(pool.Submit([output, frame, width, height]()
+			{
+				return WriteImage(output, width, height, frame->data());
+			}));
+		};
+
+		for (size_t i = 0; i < jobs.size(); i++)
+		{
+			for (; prefetched < jobs.size() && prefetched <= i + prefetchCount; prefetched++)
+			{
+				const RenderJob& job = jobs[prefetched];
+
+				auto it = generating.find({ job.l, job.m, job.resolution });
+				if (it != generating.end())
+				{
+					meshes.push_back(it->second);
+					continue;
+				}
+
+				// Not counted, UpdateModel() looks it up again
+				MeshCache::Entry entry;
+				if (meshCache.Find(job.l, job.m, job.resolution, VertexFormat::Float, MeshType::Grid, entry, false))
+				{
+					meshes.emplace_back();
+					continue;
+				}
+
+				int l = job.l, m = job.m;
+				unsigned int resolution = job.resolution;
+
+				std::shared_future<std::shared_ptr<OrbitalMesh>> mesh = pool.Submit([l, m, resolution]()
+				{
+					std::shared_ptr<OrbitalMesh> mesh = std::make_shared<OrbitalMesh>(l, m, resolution);
+					mesh->Generate(&ThreadPool::GetDefault());
+					return mesh;
+				}).share();
+
+				generating[{ l, m, resolution }] = mesh;
+				meshes.push_back(mesh);
+			}
+
+			const RenderJob& job = jobs[i];
+			std::shared_future<std::shared_ptr<OrbitalMesh>> mesh = std::move(meshes.front());
+			meshes.pop_front();
+
+			// Only the first job with a shared mesh uploads it, the others find it in the cache
+			auto it = generating.find({ job.l, job.m, job.resolution });
+			if (mesh.valid() && it != generating.end())
+			{
+				orbital.SetMesh(mesh.get());
+				generating.erase(it);
+			}
+			else
+			{
+				orbital.l = job.l;
+				orbital.m = job.m;
+				orbital.resolution = job.resolution;
+				orbital.UpdateModel();
+			}
+
+			camera.UpdatePerspective(job.fov, (float)width / (float)height);
+			camera.SetPosition(job.cameraPosition);
+			camera.LookAt(glm::vec3(0.0f));
+			cameraBuffer.Update(camera);
+
+			glClearColor(0.0f, 0.0f, 0.05f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+			orbital.BindDefaultShader();
+			orbital.Draw();
+
+			std::string previousOutput;
+			std::vector<unsigned char> previousPixels;
+			if (reader.Read(job.output, previousOutput, previousPixels))
+				writeFrame(previousOutput, std::move(previousPixels));
+		}
+
+		std::string lastOutput;
+		std::vector<unsigned char> lastPixels;
+		if (reader.Flush(lastOutput, lastPixels))
+			writeFrame(lastOutput, std::move(lastPixels));
+
+		for (std::future<bool>& write : writes)
+			failedWrites += !write.get();
+
+		if (failedWrites > 0)
+		{
+			std::cerr << failedWrites << " of " << jobs.size() << " images could not be written" << std::endl;
+			exitCode = -1;
+		}
+
+		glDeleteRenderbuffers(2, renderbuffers);
+		glDeleteFramebuffers(1, &fbo);
+	}
+
+	return exitCode;
+}
+
+#else
+
+int RunHeadless(const std::vector<RenderJob>& jobs, unsigned int width, unsigned int height)
+{
+	std::cerr << "Headless rendering needs EGL, which this build was compiled without" << std::endl;
+	return -1;
+}
+
+#endif
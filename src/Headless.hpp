@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+// One image of a batch render. Job files have one job per line:
+//
+//		l m resolution cameraX cameraY cameraZ fov output
+//
+// The camera looks at the origin, the output extension picks the format (.png or .ppm).
+// Empty lines and lines starting with # are ignored.
+struct RenderJob
+{
+	int l, m;
+	unsigned int resolution;
+
+	glm::vec3 cameraPosition;
+	float fov;
+
+	std::string output;
+};
+
+bool LoadRenderJobs(const std::string& path, std::vector<RenderJob>& jobs);
+
+// Renders all jobs into an offscreen framebuffer without ever opening a window (EGL, so this also
+// works on machines without a display or GPU as long as Mesa is around). Returns the exit code.
+int RunHeadless(const std::vector<RenderJob>& jobs, unsigned int width, unsigned int height);
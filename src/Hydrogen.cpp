@@ -0,0 +1,138 @@
+#include "Hydrogen.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "Harmonics.hpp"
+#include "HarmonicsBatch.hpp"
+#include "ScalarVolume.hpp"
+#include "ThreadPool.hpp"
+
+HydrogenWavefunction::HydrogenWavefunction(int n, int l, int m) :
+	n(n), l(l), m(m)
+{
+	// N_nl = sqrt((2 / n)^3 (n - l - 1)! / (2n (n + l)!))
+	logNormalization = 0.5 * (3.0 * std::log(2.0 / n) + std::lgamma(n - l) - std::log(2.0 * n) - std::lgamma(n + l + 1));
+	angularScale = (m != 0) ? std::sqrt(2.0) : 1.0;
+}
+
+double HydrogenWavefunction::Radial(double r) const
+{
+	double rho = 2.0 * r / n;
+
+	// Generalized Laguerre polynomial L_k^alpha by its recurrence in k
+	int k = n - l - 1;
+	double alpha = 2.0 * l + 1.0;
+	double previous = 1.0, laguerre = 1.0;
+	if (k > 0)
+		laguerre = 1.0 + alpha - rho;
+
+	for (int i = 1; i < k; i++)
+	{
+		double next = ((2.0 * i + 1.0 + alpha - rho) * laguerre - (i + alpha) * previous) / (i + 1.0);
+		previous = laguerre;
+		laguerre = next;
+	}
+
+	// rho^l is 1 for l = 0 even at the nucleus, the logarithm would make that 0 * -inf
+	double logPower = (l == 0) ? 0.0 : l * std::log(rho);
+	return std::exp(logNormalization + logPower - 0.5 * rho) * laguerre;
+}
+
+double HydrogenWavefunction::Evaluate(double x, double y, double z) const
+{
+	double r = std::sqrt(x * x + y * y + z * z);
+	if (r == 0.0)
+		return (l == 0) ? Radial(0.0) / std::sqrt(4.0 * 3.14159265359) : 0.0;
+
+	return Radial(r) * angularScale * RealSphericalHarmonic(l, m, std::acos(z / r), std::atan2(y, x));
+}
+
+double HydrogenWavefunction::GetExtent() const
+{
+	// The density falls off like e^(-2r / n) past the classical turning point at about 2n^2,
+	// so integrating r^2 R^2 out to a generous limit catches everything
+	double limit = 4.0 * n * n + 20.0 * n;
+	const int steps = 4096;
+	double step = limit / steps;
+
+	std::vector<double> cumulative(steps + 1, 0.0);
+	double previous = 0.0;
+	for (int i = 1; i <= steps; i++)
+	{
+		double r = i * step;
+		double radial = Radial(r);
+		double density = r * r * radial * radial;
+		cumulative[i] = cumulative[i - 1] + 0.5 * (previous + density) * step;
+		previous = density;
+	}
+
+	for (int i = 0; i <= steps; i++)
+	{
+		if (cumulative[i] >= (1.0 - 1e-4) * cumulative[steps])
+			return i * step;
+	}
+
+	return limit;
+}
+
+bool HydrogenWavefunction::Sample(ScalarVolume& volume, unsigned int size, double extent, ThreadPool* pool, const std::atomic<bool>* cancelled) const
+{
+	volume.size = size;
+	volume.extent = (float)((extent > 0.0) ? extent : GetExtent());
+	volume.values.resize((size_t)size * size * size);
+
+	std::vector<float> sliceMax(size, 0.0f);
+
+	auto sampleSlice = [&](size_t z)
+	{
+		if (cancelled != nullptr && *cancelled)
+			return;
+
+		std::vector<float> xs(size), ys(size), zs(size), angular(size);
+		float cz = volume.GetCoordinate((unsigned int)z);
+		float maxAbs = 0.0f;
+
+		for (unsigned int y = 0; y < size; y++)
+		{
+			float cy = volume.GetCoordinate(y);
+			for (unsigned int x = 0; x < size; x++)
+			{
+				xs[x] = volume.GetCoordinate(x);
+				ys[x] = cy;
+				zs[x] = cz;
+
+				// The kernel wants a direction, at the nucleus any will do (R_nl is 0 there for l > 0)
+				if (xs[x] == 0.0f && cy == 0.0f && cz == 0.0f)
+					zs[x] = 1.0f;
+			}
+
+			EvaluateRealHarmonics(l, m, xs.data(), ys.data(), zs.data(), size, angular.data(), nullptr);
+
+			float* row = volume.values.data() + volume.GetIndex(0, y, (unsigned int)z);
+			for (unsigned int x = 0; x < size; x++)
+			{
+				double r = std::sqrt((double)xs[x] * xs[x] + (double)cy * cy + (double)cz * cz);
+				row[x] = (float)(Radial(r) * angularScale * angular[x]);
+				maxAbs = std::max(maxAbs, std::abs(row[x]));
+			}
+		}
+
+		sliceMax[z] = maxAbs;
+	};
+
+	if (pool == nullptr)
+	{
+		for (size_t z = 0; z < size; z++)
+			sampleSlice(z);
+	}
+	else
+	{
+		pool->ParallelFor(size, sampleSlice);
+	}
+
+	volume.maxAbs = *std::max_element(sliceMax.begin(), sliceMax.end());
+	return (cancelled == nullptr || !*cancelled);
+}
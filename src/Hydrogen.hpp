@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+
+struct ScalarVolume;
+class ThreadPool;
+
+// A bound state of hydrogen in atomic units (lengths in Bohr radii),
+//
+//		psi_nlm(r, theta, phi) = R_nl(r) * c_m * RealSphericalHarmonic(l, m, theta, phi)
+//		R_nl(r) = N_nl * rho^l * e^(-rho / 2) * L_(n-l-1)^(2l+1)(rho),		rho = 2r / n
+//
+// RealSphericalHarmonic is the real (or imaginary) part of the complex harmonic, which leaves it with a norm
+// of 1 / sqrt(2) for m != 0. c_m = sqrt(2) there (and 1 for m = 0) keeps |psi|^2 a probability density.
+//
+// The normalization is worked out through lgamma and the whole product in logarithms, so states with
+// large n don't overflow the factorials or underflow e^(-rho / 2) before the polynomial is applied.
+class HydrogenWavefunction
+{
+public:
+	HydrogenWavefunction(int n, int l, int m);
+
+	double Radial(double r) const;
+	double Evaluate(double x, double y, double z) const;
+
+	// c_m, for anything that puts psi together from Radial() and the harmonic itself
+	double GetAngularScale() const { return angularScale; }
+
+	// The radius that holds all but 1e-4 of the probability
+	double GetExtent() const;
+
+	// Samples psi over [-extent, extent]^3 on size^3 points (extent <= 0 picks GetExtent()). Slices of z are
+	// spread over the pool, the angular part goes through the batched harmonic kernel a row at a time.
+	// Returns false if cancelled before it was done
+	bool Sample(ScalarVolume& volume, unsigned int size, double extent = 0.0, ThreadPool* pool = nullptr, const std::atomic<bool>* cancelled = nullptr) const;
+
+public:
+	int n, l, m;
+
+private:
+	double logNormalization;
+	double angularScale;
+};
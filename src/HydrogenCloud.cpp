@@ -0,0 +1,151 @@
+#include "HydrogenCloud.hpp"
+
+#include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "Shader.hpp"
+#include "ElectronCloud.hpp"
+#include "Hydrogen.hpp"
+#include "ThreadPool.hpp"
+
+Shader* HydrogenCloud::defaultShader = nullptr;
+
+HydrogenCloud::HydrogenCloud(int n, int l, int m) :
+	n(n), l(l), m(m), count(2000000), seed(1), pointSize(1.0f), pointCount(0), modelMatrix(1.0f)
+{
+	if (defaultShader == nullptr)
+	{
+		defaultShader = new Shader(
+			R"(
+			#version 460 core
+
+			layout(location = 0) in vec3 position;
+			layout(location = 1) in float negative;	// 0 or 1
+
+			out vec3 outColor;
+
+			layout(std140, binding = 0) uniform Camera
+			{
+				mat4 view;
+				mat4 projection;
+				mat4 viewProjection;
+				vec4 cameraPosition;
+			};
+
+			uniform mat4 model;
+
+			uniform vec3 positiveColor;
+			uniform vec3 negativeColor;
+
+			void main()
+			{
+				outColor = mix(positiveColor, negativeColor, negative);
+				gl_Position = viewProjection * model * vec4(position, 1.0f);
+			}
+		)",
+
+			R"(
+			#version 460 core
+
+			in vec3 outColor;
+			out vec4 FragColor;
+
+			void main()
+			{
+				FragColor = vec4(outColor, 1.0f);
+			}
+		)"
+		);
+	}
+
+	glGenVertexArrays(1, &vao);
+	glBindVertexArray(vao);
+
+	glGenBuffers(1, &positions);
+	glBindBuffer(GL_ARRAY_BUFFER, positions);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+
+	// The signs stay bytes, the vertex fetch turns them into floats
+	glGenBuffers(1, &signs);
+	glBindBuffer(GL_ARRAY_BUFFER, signs);
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 1, GL_UNSIGNED_BYTE, GL_FALSE, 0, (void*)0);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	RequestUpdate();
+}
+
+HydrogenCloud::~HydrogenCloud()
+{
+	glDeleteBuffers(1, &positions);
+	glDeleteBuffers(1, &signs);
+	glDeleteVertexArrays(1, &vao);
+}
+
+bool HydrogenCloud::IsShaderReady() const
+{
+	return defaultShader->IsReady();
+}
+
+void HydrogenCloud::BindDefaultShader(const glm::vec3& positiveColor, const glm::vec3& negativeColor)
+{
+	defaultShader->Bind();
+	defaultShader->SetMatrix("model", glm::value_ptr(modelMatrix));
+
+	defaultShader->SetVector3("positiveColor", glm::value_ptr(positiveColor));
+	defaultShader->SetVector3("negativeColor", glm::value_ptr(negativeColor));
+}
+
+void HydrogenCloud::Draw()
+{
+	if (pointCount == 0)
+		return;
+
+	glPointSize(pointSize);
+
+	glBindVertexArray(vao);
+	glDrawArrays(GL_POINTS, 0, (GLsizei)pointCount);
+	glBindVertexArray(0);
+}
+
+void HydrogenCloud::RequestUpdate()
+{
+	int stateN = n, stateL = l, stateM = m;
+	size_t points = count;
+	uint64_t cloudSeed = seed;
+	job.Start([stateN, stateL, stateM, points, cloudSeed](const std::atomic<bool>* cancelled)
+	{
+		std::unique_ptr<ElectronCloud> cloud = std::make_unique<ElectronCloud>(HydrogenWavefunction(stateN, stateL, stateM));
+		if (!cloud->Generate(cloudSeed, points, &ThreadPool::GetDefault(), cancelled))
+			cloud.reset();
+
+		return cloud;
+	});
+}
+
+void HydrogenCloud::CancelUpdate()
+{
+	job.Cancel();
+}
+
+void HydrogenCloud::Poll()
+{
+	std::unique_ptr<ElectronCloud> cloud;
+	if (!job.Poll(cloud) || cloud == nullptr)
+		return;
+
+	glBindBuffer(GL_ARRAY_BUFFER, positions);
+	glBufferData(GL_ARRAY_BUFFER, cloud->positions.size() * sizeof(float), cloud->positions.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, signs);
+	glBufferData(GL_ARRAY_BUFFER, cloud->signs.size(), cloud->signs.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	pointCount = cloud->signs.size();
+
+	// Same size on screen as the orbitals, whatever n is
+	modelMatrix = glm::scale(glm::mat4(1.0f), glm::vec3(3.0f / cloud->GetExtent()));
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include <glm/matrix.hpp>
+
+#include "BackgroundJob.hpp"
+
+class Shader;
+class ElectronCloud;
+
+// A state of hydrogen as a cloud of points drawn from |psi|^2 (see ElectronCloud), colored by the sign of psi.
+// The points are generated in the background and drawn as GL_POINTS.
+class HydrogenCloud
+{
+public:
+	HydrogenCloud(int n, int l, int m);
+	~HydrogenCloud();
+
+	HydrogenCloud(const HydrogenCloud&) = delete;
+	HydrogenCloud& operator=(const HydrogenCloud&) = delete;
+
+	// False while the shader is still being compiled in the background, binding it would wait for it
+	bool IsShaderReady() const;
+
+	// The camera comes from the CameraUniformBuffer
+	void BindDefaultShader(const glm::vec3& positiveColor, const glm::vec3& negativeColor);
+	void Draw();
+
+	// The current points keep being drawn until the new ones are done
+	void RequestUpdate();
+	void CancelUpdate();
+	bool IsUpdating() const { return job.IsRunning(); }
+
+	// Has to be called once per frame, uploads finished points
+	void Poll();
+
+	size_t GetPointCount() const { return pointCount; }
+
+public:
+	int n, l, m;
+	unsigned int count;
+	uint64_t seed;
+	float pointSize;
+
+private:
+	unsigned int vao, positions, signs;
+	size_t pointCount;
+	glm::mat4 modelMatrix;
+
+	BackgroundJob<std::unique_ptr<ElectronCloud>> job;
+
+	static Shader* defaultShader;
+};
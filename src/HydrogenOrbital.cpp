@@ -0,0 +1,224 @@
+#include "HydrogenOrbital.hpp"
+
+#include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "Shader.hpp"
+#include "Hydrogen.hpp"
+#include "ScalarVolume.hpp"
+#include "ThreadPool.hpp"
+
+Shader* HydrogenOrbital::defaultShader = nullptr;
+
+HydrogenOrbital::HydrogenOrbital(int n, int l, int m) :
+	n(n), l(l), m(m), volumeSize(128), isoFraction(0.1f), modelMatrix(1.0f), extent(1.0f), volumeN(0), volumeL(0), volumeM(0)
+{
+	if (defaultShader == nullptr)
+	{
+		defaultShader = new Shader(
+			R"(
+			#version 460 core
+
+			layout(location = 0) in vec3 position;
+			layout(location = 1) in vec3 normal;
+
+			out vec3 outNormal;
+			out vec3 outPosition;
+
+			layout(std140, binding = 0) uniform Camera
+			{
+				mat4 view;
+				mat4 projection;
+				mat4 viewProjection;
+				vec4 cameraPosition;
+			};
+
+			uniform mat4 model;
+
+			void main()
+			{
+				// The model matrix only scales uniformly, so it leaves the normals alone
+				outNormal = normal;
+				outPosition = vec3(model * vec4(position, 1.0f));
+				gl_Position = viewProjection * vec4(outPosition, 1.0f);
+			}
+		)",
+
+			R"(
+			#version 460 core
+
+			in vec3 outNormal;
+			in vec3 outPosition;
+			out vec4 FragColor;
+
+			layout(std140, binding = 0) uniform Camera
+			{
+				mat4 view;
+				mat4 projection;
+				mat4 viewProjection;
+				vec4 cameraPosition;
+			};
+
+			uniform vec3 color;
+
+			void main()
+			{
+				// Lit from the camera, so the shape shows without having to place a light
+				vec3 toCamera = normalize(cameraPosition.xyz - outPosition);
+				float diffuse = abs(dot(normalize(outNormal), toCamera));
+				FragColor = vec4(color * (0.25f + 0.75f * diffuse), 1.0f);
+			}
+		)"
+		);
+	}
+
+	for (SurfaceBuffers& buffers : surfaces)
+	{
+		glGenVertexArrays(1, &buffers.vao);
+		glBindVertexArray(buffers.vao);
+
+		glGenBuffers(1, &buffers.positions);
+		glGenBuffers(1, &buffers.normals);
+		glGenBuffers(1, &buffers.ebo);
+
+		glBindBuffer(GL_ARRAY_BUFFER, buffers.positions);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+
+		glBindBuffer(GL_ARRAY_BUFFER, buffers.normals);
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers.ebo);
+
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		buffers.count = 0;
+	}
+
+	RequestUpdate();
+}
+
+HydrogenOrbital::~HydrogenOrbital()
+{
+	for (SurfaceBuffers& buffers : surfaces)
+	{
+		glDeleteBuffers(1, &buffers.positions);
+		glDeleteBuffers(1, &buffers.normals);
+		glDeleteBuffers(1, &buffers.ebo);
+		glDeleteVertexArrays(1, &buffers.vao);
+	}
+}
+
+bool HydrogenOrbital::IsShaderReady() const
+{
+	return defaultShader->IsReady();
+}
+
+void HydrogenOrbital::BindDefaultShader(const glm::vec3& positiveColor, const glm::vec3& negativeColor)
+{
+	defaultShader->Bind();
+	defaultShader->SetMatrix("model", glm::value_ptr(modelMatrix));
+
+	// Draw() switches between them
+	colors[0] = positiveColor;
+	colors[1] = negativeColor;
+}
+
+void HydrogenOrbital::Draw()
+{
+	for (int i = 0; i < 2; i++)
+	{
+		if (surfaces[i].count == 0)
+			continue;
+
+		defaultShader->SetVector3("color", glm::value_ptr(colors[i]));
+
+		glBindVertexArray(surfaces[i].vao);
+		glDrawElements(GL_TRIANGLES, (GLsizei)surfaces[i].count, GL_UNSIGNED_INT, (void*)0);
+	}
+
+	glBindVertexArray(0);
+}
+
+void HydrogenOrbital::RequestUpdate()
+{
+	// Only the iso value changed, the volume can stay
+	std::shared_ptr<const ScalarVolume> reused;
+	if (volume != nullptr && volumeN == n && volumeL == l && volumeM == m && volume->size == volumeSize)
+		reused = volume;
+
+	int stateN = n, stateL = l, stateM = m;
+	unsigned int size = volumeSize;
+	float fraction = isoFraction;
+	job.Start([reused, stateN, stateL, stateM, size, fraction](const std::atomic<bool>* cancelled)
+	{
+		ThreadPool* pool = &ThreadPool::GetDefault();
+		std::unique_ptr<Result> result = std::make_unique<Result>();
+		result->n = stateN;
+		result->l = stateL;
+		result->m = stateM;
+
+		result->volume = reused;
+		if (result->volume == nullptr)
+		{
+			std::shared_ptr<ScalarVolume> sampled = std::make_shared<ScalarVolume>();
+			if (!HydrogenWavefunction(stateN, stateL, stateM).Sample(*sampled, size, 0.0, pool, cancelled))
+				return std::unique_ptr<Result>();
+
+			result->volume = sampled;
+		}
+
+		float isoValue = fraction * result->volume->maxAbs;
+		if (!result->positive.Extract(*result->volume, isoValue, 1.0f, pool, cancelled) ||
+			!result->negative.Extract(*result->volume, isoValue, -1.0f, pool, cancelled))
+			return std::unique_ptr<Result>();
+
+		return result;
+	});
+}
+
+void HydrogenOrbital::CancelUpdate()
+{
+	job.Cancel();
+}
+
+void HydrogenOrbital::Poll()
+{
+	std::unique_ptr<Result> result;
+	if (!job.Poll(result) || result == nullptr)
+		return;
+
+	volume = result->volume;
+	volumeN = result->n;
+	volumeL = result->l;
+	volumeM = result->m;
+
+	Upload(surfaces[0], result->positive);
+	Upload(surfaces[1], result->negative);
+
+	// Same size on screen as the orbitals, whatever n is
+	extent = volume->extent;
+	modelMatrix = glm::scale(glm::mat4(1.0f), glm::vec3(3.0f / extent));
+}
+
+void HydrogenOrbital::Upload(SurfaceBuffers& buffers, const Isosurface& surface)
+{
+	glBindBuffer(GL_ARRAY_BUFFER, buffers.positions);
+	glBufferData(GL_ARRAY_BUFFER, surface.positions.size() * sizeof(float), surface.positions.data(), GL_STATIC_DRAW);
+
+	glBindBuffer(GL_ARRAY_BUFFER, buffers.normals);
+	glBufferData(GL_ARRAY_BUFFER, surface.normals.size() * sizeof(float), surface.normals.data(), GL_STATIC_DRAW);
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	// The element buffer is part of the vao's state
+	glBindVertexArray(buffers.vao);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers.ebo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, surface.indices.size() * sizeof(uint32_t), surface.indices.data(), GL_STATIC_DRAW);
+	glBindVertexArray(0);
+
+	buffers.count = surface.indices.size();
+}
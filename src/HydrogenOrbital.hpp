@@ -0,0 +1,78 @@
+#pragma once
+
+#include <memory>
+
+#include <glm/matrix.hpp>
+
+#include "BackgroundJob.hpp"
+#include "Isosurface.hpp"
+
+class Shader;
+struct ScalarVolume;
+
+// A state of hydrogen (see HydrogenWavefunction) drawn as the two surfaces psi = +iso and psi = -iso,
+// with iso a fraction of the largest |psi| in the volume. Sampling the volume and extracting the surfaces
+// run in the background like the orbital's meshes. The last volume is kept, so changing only the
+// iso value just extracts again.
+class HydrogenOrbital
+{
+public:
+	HydrogenOrbital(int n, int l, int m);
+	~HydrogenOrbital();
+
+	HydrogenOrbital(const HydrogenOrbital&) = delete;
+	HydrogenOrbital& operator=(const HydrogenOrbital&) = delete;
+
+	// False while the shader is still being compiled in the background, binding it would wait for it
+	bool IsShaderReady() const;
+
+	// The camera comes from the CameraUniformBuffer
+	void BindDefaultShader(const glm::vec3& positiveColor, const glm::vec3& negativeColor);
+	void Draw();
+
+	// The current surfaces keep being drawn until the new ones are done
+	void RequestUpdate();
+	void CancelUpdate();
+	bool IsUpdating() const { return job.IsRunning(); }
+
+	// Has to be called once per frame, uploads finished surfaces
+	void Poll();
+
+	size_t GetTriangleCount() const { return surfaces[0].count / 3 + surfaces[1].count / 3; }
+	float GetExtent() const { return extent; }
+
+public:
+	int n, l, m;
+	unsigned int volumeSize;
+	float isoFraction;
+
+private:
+	struct Result
+	{
+		int n, l, m;
+		std::shared_ptr<const ScalarVolume> volume;
+		Isosurface positive, negative;
+	};
+
+	struct SurfaceBuffers
+	{
+		unsigned int vao, positions, normals, ebo;
+		size_t count;
+	};
+
+	void Upload(SurfaceBuffers& buffers, const Isosurface& surface);
+
+	// Positive first, then negative
+	SurfaceBuffers surfaces[2];
+	glm::vec3 colors[2];
+	glm::mat4 modelMatrix;
+	float extent;
+
+	// The volume the surfaces were extracted from, and what it was sampled for
+	std::shared_ptr<const ScalarVolume> volume;
+	int volumeN, volumeL, volumeM;
+
+	BackgroundJob<std::unique_ptr<Result>> job;
+
+	static Shader* defaultShader;
+};
@@ -0,0 +1,333 @@
+#include "HydrogenVolume.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "Shader.hpp"
+#include "BrickedVolume.hpp"
+#include "Hydrogen.hpp"
+#include "ThreadPool.hpp"
+
+Shader* HydrogenVolume::defaultShader = nullptr;
+
+// The corners of [-1, 1]^3 by their bits (x, y, z), and the faces wound counter clockwise from the outside
+static const float cubeVertices[] = {
+	-1.0f, -1.0f, -1.0f,	1.0f, -1.0f, -1.0f,	-1.0f, 1.0f, -1.0f,	1.0f, 1.0f, -1.0f,
+	-1.0f, -1.0f, 1.0f,		1.0f, -1.0f, 1.0f,	-1.0f, 1.0f, 1.0f,	1.0f, 1.0f, 1.0f
+};
+
+static const unsigned int cubeIndices[] = {
+	0, 6, 2, 0, 4, 6,	1, 3, 7, 1, 7, 5,
+	0, 1, 5, 0, 5, 4,	2, 7, 3, 2, 6, 7,
+	0, 3, 1, 0, 2, 3,	4, 5, 7, 4, 7, 6
+};
+
+HydrogenVolume::HydrogenVolume(int n, int l, int m) :
+	n(n), l(l), m(m), cells(256), threshold(1e-4f), budget(256), densityScale(20.0f), stepSize(0.5f), bricksPerFrame(4096),
+	atlas(0), indirection(0), modelMatrix(1.0f), atlasBricks(0), gridSize(0), volumeCells(0), brickCount(0), denseByteSize(0), truncated(false), uploaded(0)
+{
+	if (defaultShader == nullptr)
+	{
+		defaultShader = new Shader(
+			R"(
+			#version 460 core
+
+			layout(location = 0) in vec3 position;
+
+			out vec3 outPosition;
+			flat out vec3 outCamera;
+
+			layout(std140, binding = 0) uniform Camera
+			{
+				mat4 view;
+				mat4 projection;
+				mat4 viewProjection;
+				vec4 cameraPosition;
+			};
+
+			uniform mat4 model;
+
+			void main()
+			{
+				// The ray is marched in the cube's own space
+				outPosition = position;
+				outCamera = vec3(inverse(model) * vec4(cameraPosition.xyz, 1.0f));
+				gl_Position = viewProjection * model * vec4(position, 1.0f);
+			}
+		)",
+
+			R"(
+			#version 460 core
+
+			in vec3 outPosition;
+			flat in vec3 outCamera;
+			out vec4 FragColor;
+
+			layout(binding = 0) uniform sampler3D atlas;
+			layout(binding = 1) uniform isampler3D indirection;
+
+			uniform uint cells;
+			uniform uint atlasBricks;
+
+			uniform float densityScale;
+			uniform float stepSize;
+
+			uniform vec3 positiveColor;
+			uniform vec3 negativeColor;
+
+			const float brickCells = 8.0f;
+			const float brickSamples = 9.0f;
+
+			void main()
+			{
+				// Everything in cells from the corner of the volume. Only back faces are drawn, so the ray
+				// ends here and starts where it enters the cube (or at the camera if that's inside)
+				vec3 direction = normalize(outPosition - outCamera);
+				direction = mix(direction, vec3(1e-6f), equal(direction, vec3(0.0f)));
+				vec3 inverseDirection = 1.0f / direction;
+
+				float size = float(cells);
+				vec3 origin = (outCamera + 1.0f) * 0.5f * size;
+				vec3 t0 = -origin * inverseDirection;
+				vec3 t1 = (vec3(size) - origin) * inverseDirection;
+				float t = max(max(max(min(t0.x, t1.x), min(t0.y, t1.y)), min(t0.z, t1.z)), 0.0f);
+				float end = length((outPosition + 1.0f) * 0.5f * size - origin);
+
+				ivec3 lastBrick = ivec3(int(size / brickCells) - 1);
+				float atlasSize = float(atlasBricks) * brickSamples;
+				int bricks = int(atlasBricks);
+
+				// The stored density is relative to the peak, the opacity goes by the length in the cube's units
+				float opacity = densityScale * stepSize * 2.0f / size;
+
+				vec4 color = vec4(0.0f);
+				for (int i = 0; i < 65536 && t < end; i++)
+				{
+					vec3 position = origin + t * direction;
+					ivec3 brick = clamp(ivec3(floor(position / brickCells)), ivec3(0), lastBrick);
+
+					int index = texelFetch(indirection, brick, 0).r;
+					if (index < 0)
+					{
+						// Empty, straight on to where the ray leaves the brick
+						vec3 leave = ((vec3(brick) + step(0.0f, direction)) * brickCells - position) * inverseDirection;
+						t += max(min(min(leave.x, leave.y), leave.z), 0.0f) + 0.01f;
+						continue;
+					}
+
+					// Each brick has its own corner samples, so the filtering never reaches into a neighbour in the atlas
+					vec3 atlasBrick = vec3(index % bricks, (index / bricks) % bricks, index / (bricks * bricks));
+					vec3 local = clamp(position - vec3(brick) * brickCells, 0.0f, brickCells);
+					float value = texture(atlas, (atlasBrick * brickSamples + local + 0.5f) / atlasSize).r;
+
+					float alpha = 1.0f - exp(-abs(value) * opacity);
+					color.rgb += (1.0f - color.a) * alpha * ((value >= 0.0f) ? positiveColor : negativeColor);
+					color.a += (1.0f - color.a) * alpha;
+
+					// Nothing behind shows through anymore
+					if (color.a > 0.99f)
+						break;
+
+					t += stepSize;
+				}
+
+				// Premultiplied
+				FragColor = color;
+			}
+		)"
+		);
+	}
+
+	glGenVertexArrays(1, &vao);
+	glBindVertexArray(vao);
+
+	glGenBuffers(1, &vbo);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVertices), cubeVertices, GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+
+	glGenBuffers(1, &ebo);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(cubeIndices), cubeIndices, GL_STATIC_DRAW);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	// Same size on screen as the orbitals
+	modelMatrix = glm::scale(modelMatrix, glm::vec3(3.0f));
+
+	RequestUpdate();
+}
+
+HydrogenVolume::~HydrogenVolume()
+{
+	glDeleteTextures(1, &atlas);
+	glDeleteTextures(1, &indirection);
+	glDeleteBuffers(1, &vbo);
+	glDeleteBuffers(1, &ebo);
+	glDeleteVertexArrays(1, &vao);
+}
+
+bool HydrogenVolume::IsShaderReady() const
+{
+	return defaultShader->IsReady();
+}
+
+void HydrogenVolume::BindDefaultShader(const glm::vec3& positiveColor, const glm::vec3& negativeColor)
+{
+	defaultShader->Bind();
+	defaultShader->SetMatrix("model", glm::value_ptr(modelMatrix));
+
+	defaultShader->SetVector3("positiveColor", glm::value_ptr(positiveColor));
+	defaultShader->SetVector3("negativeColor", glm::value_ptr(negativeColor));
+
+	defaultShader->SetUnsignedInt("cells", volumeCells);
+	defaultShader->SetUnsignedInt("atlasBricks", atlasBricks);
+	defaultShader->SetFloat("densityScale", densityScale);
+	defaultShader->SetFloat("stepSize", stepSize);
+}
+
+void HydrogenVolume::Draw()
+{
+	if (atlas == 0)
+		return;
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_3D, atlas);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_3D, indirection);
+	glActiveTexture(GL_TEXTURE0);
+
+	// Back faces only, so there's a fragment to start from even with the camera inside
+	glEnable(GL_CULL_FACE);
+	glCullFace(GL_FRONT);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+	glDepthMask(GL_FALSE);
+
+	glBindVertexArray(vao);
+	glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, (void*)0);
+	glBindVertexArray(0);
+
+	glDepthMask(GL_TRUE);
+	glDisable(GL_BLEND);
+	glCullFace(GL_BACK);
+	glDisable(GL_CULL_FACE);
+}
+
+void HydrogenVolume::RequestUpdate()
+{
+	// The atlas stores half floats
+	size_t maxBricks = std::max((size_t)1, ((size_t)budget << 20) / (BrickedVolume::brickSize * 2));
+
+	int stateN = n, stateL = l, stateM = m;
+	unsigned int size = cells;
+	float cutoff = threshold;
+	job.Start([stateN, stateL, stateM, size, cutoff, maxBricks](const std::atomic<bool>* cancelled)
+	{
+		std::unique_ptr<BrickedVolume> volume = std::make_unique<BrickedVolume>();
+		if (!volume->Build(HydrogenWavefunction(stateN, stateL, stateM), size, cutoff, maxBricks, &ThreadPool::GetDefault(), cancelled))
+			volume.reset();
+
+		return volume;
+	});
+}
+
+void HydrogenVolume::CancelUpdate()
+{
+	// A volume that's halfway uploaded gets finished, there's nothing left to compute
+	job.Cancel();
+}
+
+void HydrogenVolume::Poll()
+{
+	std::unique_ptr<BrickedVolume> volume;
+	if (job.Poll(volume) && volume != nullptr)
+	{
+		pending = std::move(volume);
+		Allocate();
+	}
+
+	if (pending == nullptr)
+		return;
+
+	// Bricks that aren't there yet read as empty from the cleared atlas, so the volume fills in as they arrive
+	size_t last = std::min(uploaded + bricksPerFrame, pending->GetBrickCount());
+	glBindTexture(GL_TEXTURE_3D, atlas);
+	for (; uploaded < last; uploaded++)
+	{
+		unsigned int x = (unsigned int)(uploaded % atlasBricks);
+		unsigned int y = (unsigned int)((uploaded / atlasBricks) % atlasBricks);
+		unsigned int z = (unsigned int)(uploaded / ((size_t)atlasBricks * atlasBricks));
+
+		const unsigned int samples = BrickedVolume::brickSamples;
+		glTexSubImage3D(GL_TEXTURE_3D, 0, x * samples, y * samples, z * samples, samples, samples, samples,
+			GL_RED, GL_FLOAT, pending->samples.data() + uploaded * BrickedVolume::brickSize);
+	}
+
+	glBindTexture(GL_TEXTURE_3D, 0);
+
+	if (uploaded == pending->GetBrickCount())
+		pending.reset();
+}
+
+size_t HydrogenVolume::GetByteSize() const
+{
+	size_t atlasSize = (size_t)atlasBricks * BrickedVolume::brickSamples;
+	return atlasSize * atlasSize * atlasSize * 2 + (size_t)gridSize * gridSize * gridSize * sizeof(int32_t);
+}
+
+void HydrogenVolume::Allocate()
+{
+	glDeleteTextures(1, &atlas);
+	glDeleteTextures(1, &indirection);
+
+	brickCount = pending->GetBrickCount();
+	denseByteSize = pending->GetDenseByteSize();
+	truncated = pending->truncated;
+	gridSize = pending->gridSize;
+	volumeCells = pending->cells;
+	uploaded = 0;
+
+	// The smallest cube of bricks that holds them all
+	atlasBricks = 1;
+	while ((size_t)atlasBricks * atlasBricks * atlasBricks < brickCount)
+		atlasBricks++;
+
+	int maxSize = 0;
+	glGetIntegerv(GL_MAX_3D_TEXTURE_SIZE, &maxSize);
+	if (atlasBricks * BrickedVolume::brickSamples > (unsigned int)maxSize)
+	{
+		std::cerr << "A volume of " << brickCount << " bricks doesn't fit into a 3D texture of at most " << maxSize << "^3" << std::endl;
+		atlas = indirection = 0;
+		pending.reset();
+		return;
+	}
+
+	GLsizei atlasSize = atlasBricks * BrickedVolume::brickSamples;
+	glGenTextures(1, &atlas);
+	glBindTexture(GL_TEXTURE_3D, atlas);
+	glTexStorage3D(GL_TEXTURE_3D, 1, GL_R16F, atlasSize, atlasSize, atlasSize);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	glClearTexImage(atlas, 0, GL_RED, GL_FLOAT, nullptr);
+
+	// The whole grid right away, it's tiny next to the atlas
+	glGenTextures(1, &indirection);
+	glBindTexture(GL_TEXTURE_3D, indirection);
+	glTexStorage3D(GL_TEXTURE_3D, 1, GL_R32I, gridSize, gridSize, gridSize);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexSubImage3D(GL_TEXTURE_3D, 0, 0, 0, 0, gridSize, gridSize, gridSize, GL_RED_INTEGER, GL_INT, pending->indirection.data());
+
+	glBindTexture(GL_TEXTURE_3D, 0);
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <memory>
+
+#include <glm/matrix.hpp>
+
+#include "BackgroundJob.hpp"
+
+class Shader;
+class BrickedVolume;
+
+// The density |psi|^2 of a state of hydrogen, ray marched through a BrickedVolume on the GPU.
+// The stored bricks go into a 3D texture atlas, a second integer texture holds the indirection grid. Rays skip
+// straight across bricks that are empty and stop once they're nearly opaque.
+//
+// The volume is built in the background. Its bricks are then streamed into the atlas a batch per frame, so
+// big volumes fill in over a few frames instead of stalling one. Once all are uploaded the CPU copy is dropped.
+class HydrogenVolume
+{
+public:
+	HydrogenVolume(int n, int l, int m);
+	~HydrogenVolume();
+
+	HydrogenVolume(const HydrogenVolume&) = delete;
+	HydrogenVolume& operator=(const HydrogenVolume&) = delete;
+
+	// False while the shader is still being compiled in the background, binding it would wait for it
+	bool IsShaderReady() const;
+
+	// The camera comes from the CameraUniformBuffer
+	void BindDefaultShader(const glm::vec3& positiveColor, const glm::vec3& negativeColor);
+
+	// Blends over whatever is there already, so it should come after the opaque things
+	void Draw();
+
+	// The current volume keeps being drawn until the new one is built
+	void RequestUpdate();
+	void CancelUpdate();
+	bool IsUpdating() const { return job.IsRunning() || pending != nullptr; }
+
+	// Has to be called once per frame, streams bricks of a finished volume into the atlas
+	void Poll();
+
+	size_t GetBrickCount() const { return brickCount; }
+	size_t GetByteSize() const;
+	size_t GetDenseByteSize() const { return denseByteSize; }
+	bool IsTruncated() const { return truncated; }
+
+public:
+	int n, l, m;
+	unsigned int cells;
+
+	// Bricks below threshold times the peak density are left out, and the atlas takes at most budget MB
+	float threshold;
+	unsigned int budget;
+
+	// Opacity per unit of density and length (in orbital radii), and the ray step in cells
+	float densityScale;
+	float stepSize;
+
+	unsigned int bricksPerFrame;
+
+private:
+	// Recreates the textures for the pending volume, the atlas starts out empty
+	void Allocate();
+
+	unsigned int vao, vbo, ebo;
+	unsigned int atlas, indirection;
+	glm::mat4 modelMatrix;
+
+	// Bricks per side of the atlas, and of the indirection grid
+	unsigned int atlasBricks, gridSize;
+	unsigned int volumeCells;
+	size_t brickCount, denseByteSize;
+	bool truncated;
+
+	// Being streamed into the atlas, up to uploaded
+	std::unique_ptr<BrickedVolume> pending;
+	size_t uploaded;
+
+	BackgroundJob<std::unique_ptr<BrickedVolume>> job;
+
+	static Shader* defaultShader;
+};
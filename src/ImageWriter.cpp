@@ -0,0 +1,180 @@
+#include "ImageWriter.hpp"
+
+#include <array>
+#include <cctype>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+static uint32_t Crc32(const unsigned char* data, size_t size, uint32_t crc = 0)
+{
+	// Built once on first use, that's thread safe for function statics (images are written from pool tasks)
+	static const std::array<uint32_t, 256> table = []()
+	{
+		std::array<uint32_t, 256> table;
+		for (uint32_t i = 0; i < 256; i++)
+		{
+			uint32_t c = i;
+			for (int k = 0; k < 8; k++)
+				c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+
+			table[i] = c;
+		}
+
+		return table;
+	}();
+
+	crc = ~crc;
+	for (size_t i = 0; i < size; i++)
+		crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+
+	return ~crc;
+}
+
+static void PutBigEndian(std::vector<unsigned char>& out, uint32_t value)
+{
+	out.push_back(value >> 24);
+	out.push_back(value >> 16);
+	out.push_back(value >> 8);
+	out.push_back(value);
+}
+
+static void WriteChunk(std::ofstream& file, const char* type, const std::vector<unsigned char>& data)
+{
+	std::vector<unsigned char> chunk;
+	chunk.reserve(data.size() + 12);
+
+	PutBigEndian(chunk, (uint32_t)data.size());
+	chunk.insert(chunk.end(), type, type + 4);
+	chunk.insert(chunk.end(), data.begin(), data.end());
+	PutBigEndian(chunk, Crc32(chunk.data() + 4, data.size() + 4));
+
+	file.write((const char*)chunk.data(), chunk.size());
+}
+
+bool WritePPM(const std::string& path, unsigned int width, unsigned int height, const unsigned char* pixels)
+{
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+	{
+		std::cerr << "Failed to open " << path << " for writing" << std::endl;
+		return false;
+	}
+
+	file << "P6\n" << width << " " << height << "\n255\n";
+
+	std::vector<unsigned char> row(3 * (size_t)width);
+	for (unsigned int y = 0; y < height; y++)
+	{
+		const unsigned char* source = pixels + 4 * (size_t)width * (height - 1 - y);
+		for (unsigned int x = 0; x < width; x++)
+		{
+			row[3 * x + 0] = source[4 * x + 0];
+			row[3 * x + 1] = source[4 * x + 1];
+			row[3 * x + 2] = source[4 * x + 2];
+		}
+
+		file.write((const char*)row.data(), row.size());
+	}
+
+	return (bool)file;
+}
+
+bool WritePNG(const std::string& path, unsigned int width, unsigned int height, const unsigned char* pixels)
+{
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+	{
+		std::cerr << "Failed to open " << path << " for writing" << std::endl;
+		return false;
+	}
+
+	static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+	file.write((const char*)signature, sizeof(signature));
+
+	std::vector<unsigned char> header;
+	PutBigEndian(header, width);
+	PutBigEndian(header, height);
+	header.push_back(8);		// Bit depth
+	header.push_back(2);		// RGB
+	header.push_back(0);		// Deflate
+	header.push_back(0);		// Adaptive filtering (every row uses filter 0)
+	header.push_back(0);		// No interlacing
+	WriteChunk(file, "IHDR", header);
+
+	// The raw scanlines, each starting with its filter type
+	size_t rowSize = 1 + 3 * (size_t)width;
+	std::vector<unsigned char> raw(rowSize * height);
+	for (unsigned int y = 0; y < height; y++)
+	{
+		const unsigned char* source = pixels + 4 * (size_t)width * (height - 1 - y);
+		unsigned char* row = raw.data() + rowSize * y;
+
+		row[0] = 0;
+		for (unsigned int x = 0; x < width; x++)
+		{
+			row[1 + 3 * x + 0] = source[4 * x + 0];
+			row[1 + 3 * x + 1] = source[4 * x + 1];
+			row[1 + 3 * x + 2] = source[4 * x + 2];
+		}
+	}
+
+	// zlib stream made of stored deflate blocks (at most 65535 bytes each)
+	const size_t maxBlock = 65535;
+	std::vector<unsigned char> data;
+	data.reserve(raw.size() + 5 * (raw.size() / maxBlock + 1) + 6);
+	data.push_back(0x78);
+	data.push_back(0x01);
+
+	uint32_t adlerA = 1, adlerB = 0;
+	size_t offset = 0;
+	do
+	{
+		size_t block = (raw.size() - offset < maxBlock) ? raw.size() - offset : maxBlock;
+		bool last = (offset + block == raw.size());
+
+		data.push_back(last ? 1 : 0);
+		data.push_back(block & 0xff);
+		data.push_back(block >> 8);
+		data.push_back(~block & 0xff);
+		data.push_back((~block >> 8) & 0xff);
+		data.insert(data.end(), raw.begin() + offset, raw.begin() + offset + block);
+
+		// Adler-32 with the modulo deferred as long as it can't overflow
+		for (size_t i = offset; i < offset + block; i += 5552)
+		{
+			size_t end = (i + 5552 < offset + block) ? i + 5552 : offset + block;
+			for (size_t k = i; k < end; k++)
+			{
+				adlerA += raw[k];
+				adlerB += adlerA;
+			}
+
+			adlerA %= 65521;
+			adlerB %= 65521;
+		}
+
+		offset += block;
+	} while (offset < raw.size());
+
+	PutBigEndian(data, (adlerB << 16) | adlerA);
+
+	WriteChunk(file, "IDAT", data);
+	WriteChunk(file, "IEND", {});
+
+	return (bool)file;
+}
+
+bool WriteImage(const std::string& path, unsigned int width, unsigned int height, const unsigned char* pixels)
+{
+	size_t dot = path.find_last_of('.');
+	std::string extension = (dot == std::string::npos) ? "" : path.substr(dot + 1);
+	for (char& c : extension)
+		c = (char)std::tolower((unsigned char)c);
+
+	if (extension == "png")
+		return WritePNG(path, width, height, pixels);
+
+	return WritePPM(path, width, height, pixels);
+}
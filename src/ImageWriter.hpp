@@ -0,0 +1,13 @@
+#pragma once
+
+#include <string>
+
+// Writes 8 bit RGBA pixels as they come out of glReadPixels (so the bottom row first) to an image file.
+// Alpha is dropped. PNGs are written with uncompressed deflate blocks, that's bigger than a real
+// encoder would make them but costs next to nothing, which is what matters for batch renders.
+
+bool WritePPM(const std::string& path, unsigned int width, unsigned int height, const unsigned char* pixels);
+bool WritePNG(const std::string& path, unsigned int width, unsigned int height, const unsigned char* pixels);
+
+// Picks the format from the file extension (.png, everything else is PPM)
+bool WriteImage(const std::string& path, unsigned int width, unsigned int height, const unsigned char* pixels);
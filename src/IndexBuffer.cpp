@@ -0,0 +1,77 @@
+#include "IndexBuffer.hpp"
+
+#include <glad/glad.h>
+
+std::map<std::pair<unsigned int, IndexEncoding>, std::weak_ptr<IndexBuffer>> IndexBuffer::sharedBuffers;
+IndexEncoding IndexBuffer::defaultEncoding = IndexEncoding::TriangleStrip;
+
+IndexBuffer::IndexBuffer(const GridIndices& indices) :
+	ebo(0), resolution(indices.GetResolution()), encoding(indices.GetEncoding()),
+	mode(indices.GetEncoding() == IndexEncoding::TriangleStrip ? GL_TRIANGLE_STRIP : GL_TRIANGLES),
+	type(indices.IsShort() ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT),
+	count(indices.GetCount()), byteSize(indices.GetByteSize())
+{
+	// Upload through the copy target so no VAO's element buffer binding gets changed
+	glGenBuffers(1, &ebo);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, ebo);
+	glBufferData(GL_COPY_WRITE_BUFFER, byteSize, indices.GetData(), GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+IndexBuffer::IndexBuffer(const std::vector<uint32_t>& triangles) :
+	ebo(0), resolution(0), encoding(IndexEncoding::TriangleList),
+	mode(GL_TRIANGLES), type(GL_UNSIGNED_INT),
+	count(triangles.size()), byteSize(triangles.size() * sizeof(uint32_t))
+{
+	glGenBuffers(1, &ebo);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, ebo);
+	glBufferData(GL_COPY_WRITE_BUFFER, byteSize, triangles.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+IndexBuffer::~IndexBuffer()
+{
+	glDeleteBuffers(1, &ebo);
+}
+
+void IndexBuffer::Bind()
+{
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+}
+
+void IndexBuffer::Draw()
+{
+	// The fixed restart index is the largest value of the index type, which is what GridIndices uses
+	if (encoding == IndexEncoding::TriangleStrip)
+		glEnable(GL_PRIMITIVE_RESTART_FIXED_INDEX);
+
+	glDrawElements(mode, count, type, 0);
+
+	if (encoding == IndexEncoding::TriangleStrip)
+		glDisable(GL_PRIMITIVE_RESTART_FIXED_INDEX);
+}
+
+void IndexBuffer::MultiDrawIndirect(unsigned int drawCount, size_t offset)
+{
+	if (encoding == IndexEncoding::TriangleStrip)
+		glEnable(GL_PRIMITIVE_RESTART_FIXED_INDEX);
+
+	glMultiDrawElementsIndirect(mode, type, (void*)offset, drawCount, 0);
+
+	if (encoding == IndexEncoding::TriangleStrip)
+		glDisable(GL_PRIMITIVE_RESTART_FIXED_INDEX);
+}
+
+std::shared_ptr<IndexBuffer> IndexBuffer::GetShared(unsigned int resolution, IndexEncoding encoding)
+{
+	std::weak_ptr<IndexBuffer>& slot = sharedBuffers[{ resolution, encoding }];
+
+	std::shared_ptr<IndexBuffer> buffer = slot.lock();
+	if (buffer == nullptr)
+	{
+		buffer = std::make_shared<IndexBuffer>(GridIndices(resolution, encoding));
+		slot = buffer;
+	}
+
+	return buffer;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "GridIndices.hpp"
+
+// Element buffer holding the GridIndices of one resolution.
+// Orbitals of equal resolution share one of these, see GetShared().
+// Sampled meshes bring their own triangle list instead, those buffers have resolution 0 (see SamplingBuffer).
+class IndexBuffer
+{
+public:
+	IndexBuffer(const GridIndices& indices);
+	IndexBuffer(const std::vector<uint32_t>& triangles);
+	~IndexBuffer();
+
+	IndexBuffer(const IndexBuffer&) = delete;
+	IndexBuffer& operator=(const IndexBuffer&) = delete;
+
+	unsigned int GetResolution() const { return resolution; }
+	IndexEncoding GetEncoding() const { return encoding; }
+	size_t GetByteSize() const { return byteSize; }
+	size_t GetCount() const { return count; }
+
+	// Binds the buffer to the currently bound VAO
+	void Bind();
+
+	// Draws with the currently bound VAO
+	void Draw();
+
+	// Same, but drawCount commands from the bound GL_DRAW_INDIRECT_BUFFER, starting offset bytes in
+	void MultiDrawIndirect(unsigned int drawCount, size_t offset = 0);
+
+	// The buffer for a resolution is created on first use and lives as long as someone uses it
+	static std::shared_ptr<IndexBuffer> GetShared(unsigned int resolution, IndexEncoding encoding);
+
+	// Which encoding new meshes are drawn with
+	static IndexEncoding GetDefaultEncoding() { return defaultEncoding; }
+	static void SetDefaultEncoding(IndexEncoding encoding) { defaultEncoding = encoding; }
+
+private:
+	unsigned int ebo;
+	unsigned int resolution;
+	IndexEncoding encoding;
+
+	unsigned int mode, type;
+	size_t count, byteSize;
+
+	static std::map<std::pair<unsigned int, IndexEncoding>, std::weak_ptr<IndexBuffer>> sharedBuffers;
+	static IndexEncoding defaultEncoding;
+};
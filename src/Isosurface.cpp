@@ -0,0 +1,295 @@
+#include "Isosurface.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+#include "ScalarVolume.hpp"
+#include "ThreadPool.hpp"
+
+// The corners of a cell are numbered by their offset, bit 0 is x, bit 1 is y and bit 2 is z.
+// Every tetrahedron runs from corner 0 to corner 7 along the cell's edges, one per order of the axes
+static const int tetrahedra[6][4] = {
+	{ 0, 1, 3, 7 }, { 0, 1, 5, 7 }, { 0, 2, 3, 7 },
+	{ 0, 2, 6, 7 }, { 0, 4, 5, 7 }, { 0, 4, 6, 7 }
+};
+
+// What one z layer contributes. The keys name the edges that start at the layer's grid points,
+// (y * size + x) * 8 + direction with the direction in the same bits as the corners, in ascending order
+struct IsosurfaceLayer
+{
+	std::vector<uint32_t> keys;
+	std::vector<float> positions, normals;
+	std::vector<uint32_t> indices;
+
+	uint32_t firstVertex;
+};
+
+bool Isosurface::Extract(const ScalarVolume& volume, float isoValue, float sign, ThreadPool* pool, const std::atomic<bool>* cancelled)
+{
+	unsigned int size = volume.size;
+	float spacing = volume.GetSpacing();
+	std::vector<IsosurfaceLayer> layers(size);
+
+	auto value = [&](unsigned int x, unsigned int y, unsigned int z) { return sign * volume.GetValue(x, y, z); };
+
+	// Of sign * value, by central differences (one sided at the border)
+	auto gradient = [&](unsigned int x, unsigned int y, unsigned int z, float* out)
+	{
+		unsigned int point[3] = { x, y, z };
+		for (int axis = 0; axis < 3; axis++)
+		{
+			unsigned int low[3] = { x, y, z }, high[3] = { x, y, z };
+			if (point[axis] > 0)
+				low[axis]--;
+			if (point[axis] + 1 < size)
+				high[axis]++;
+
+			out[axis] = (value(high[0], high[1], high[2]) - value(low[0], low[1], low[2])) / ((high[axis] - low[axis]) * spacing);
+		}
+	};
+
+	auto forEachLayer = [&](size_t count, const std::function<void(size_t)>& task)
+	{
+		auto checked = [&](size_t layer)
+		{
+			if (cancelled == nullptr || !*cancelled)
+				task(layer);
+		};
+
+		if (pool == nullptr)
+		{
+			for (size_t layer = 0; layer < count; layer++)
+				checked(layer);
+		}
+		else
+		{
+			pool->ParallelFor(count, checked);
+		}
+	};
+
+	// Which side every sample is on, and whether whole rows of x are on one side (0 or 1) or not (2).
+	// Edges and cells only cross where one of the 4 rows around them is mixed or two of them disagree,
+	// which rules out most of the grid without looking at single samples
+	std::vector<unsigned char> inside(volume.values.size());
+	std::vector<unsigned char> rowSides((size_t)size * size);
+	forEachLayer(size, [&](size_t z)
+	{
+		for (unsigned int y = 0; y < size; y++)
+		{
+			size_t first = volume.GetIndex(0, y, (unsigned int)z);
+			unsigned char sides = 0;
+			for (size_t i = first; i < first + size; i++)
+			{
+				inside[i] = sign * volume.values[i] > isoValue;
+				sides |= 1 << inside[i];
+			}
+
+			rowSides[z * size + y] = (sides == 3) ? 2 : (sides >> 1);
+		}
+	});
+
+	auto rowsStraddle = [&](unsigned int y, unsigned int z)
+	{
+		unsigned int y1 = std::min(y + 1, size - 1), z1 = std::min(z + 1, size - 1);
+		unsigned char side = rowSides[z * size + y];
+		return side == 2 || rowSides[z * size + y1] != side || rowSides[z1 * size + y] != side || rowSides[z1 * size + y1] != side;
+	};
+
+	// Pass 1, the vertices on every edge that crosses
+	forEachLayer(size, [&](size_t layerIndex)
+	{
+		unsigned int z = (unsigned int)layerIndex;
+		IsosurfaceLayer& layer = layers[z];
+
+		for (unsigned int y = 0; y < size; y++)
+		{
+			if (!rowsStraddle(y, z))
+				continue;
+
+			for (unsigned int x = 0; x < size; x++)
+			{
+				unsigned char side = inside[volume.GetIndex(x, y, z)];
+				float v0 = 0.0f;
+
+				float g0[3];
+				bool hasGradient = false;
+
+				for (uint32_t direction = 1; direction < 8; direction++)
+				{
+					unsigned int ex = x + (direction & 1), ey = y + ((direction >> 1) & 1), ez = z + ((direction >> 2) & 1);
+					if (ex >= size || ey >= size || ez >= size)
+						continue;
+
+					if (inside[volume.GetIndex(ex, ey, ez)] == side)
+						continue;
+
+					if (!hasGradient)
+					{
+						v0 = value(x, y, z);
+						gradient(x, y, z, g0);
+						hasGradient = true;
+					}
+
+					float v1 = value(ex, ey, ez);
+
+					float g1[3];
+					gradient(ex, ey, ez, g1);
+
+					// The signs differ, so v1 != v0
+					float t = (isoValue - v0) / (v1 - v0);
+					float start[3] = { volume.GetCoordinate(x), volume.GetCoordinate(y), volume.GetCoordinate(z) };
+					float end[3] = { volume.GetCoordinate(ex), volume.GetCoordinate(ey), volume.GetCoordinate(ez) };
+
+					// The value grows towards the inside, so the normal points against the gradient
+					float normal[3], length = 0.0f;
+					for (int axis = 0; axis < 3; axis++)
+					{
+						layer.positions.push_back(start[axis] + t * (end[axis] - start[axis]));
+						normal[axis] = -(g0[axis] + t * (g1[axis] - g0[axis]));
+						length += normal[axis] * normal[axis];
+					}
+
+					length = (length > 0.0f) ? 1.0f / std::sqrt(length) : 0.0f;
+					for (int axis = 0; axis < 3; axis++)
+						layer.normals.push_back(normal[axis] * length);
+
+					layer.keys.push_back((y * size + x) * 8 + direction);
+				}
+			}
+		}
+	});
+
+	if (cancelled != nullptr && *cancelled)
+		return false;
+
+	uint32_t vertexCount = 0;
+	for (IsosurfaceLayer& layer : layers)
+	{
+		layer.firstVertex = vertexCount;
+		vertexCount += (uint32_t)layer.keys.size();
+	}
+
+	// Pass 2, triangles from the cells that straddle the surface
+	forEachLayer(size - 1, [&](size_t layerIndex)
+	{
+		unsigned int z = (unsigned int)layerIndex;
+		IsosurfaceLayer& layer = layers[z];
+
+		for (unsigned int y = 0; y + 1 < size; y++)
+		{
+			if (!rowsStraddle(y, z))
+				continue;
+
+			for (unsigned int x = 0; x + 1 < size; x++)
+			{
+				unsigned int mask = 0;
+				for (unsigned int corner = 0; corner < 8; corner++)
+					mask |= inside[volume.GetIndex(x + (corner & 1), y + ((corner >> 1) & 1), z + ((corner >> 2) & 1))] << corner;
+
+				if (mask == 0 || mask == 255)
+					continue;
+
+				// The corners of a tetrahedron's edge are nested, the edge starts at their common bits
+				auto edgeVertex = [&](int a, int b)
+				{
+					uint32_t start = a & b, direction = a ^ b;
+					unsigned int gx = x + (start & 1), gy = y + ((start >> 1) & 1), gz = z + ((start >> 2) & 1);
+
+					const IsosurfaceLayer& owner = layers[gz];
+					uint32_t key = (gy * size + gx) * 8 + direction;
+					return owner.firstVertex + (uint32_t)(std::lower_bound(owner.keys.begin(), owner.keys.end(), key) - owner.keys.begin());
+				};
+
+				// Inside a tetrahedron the surface cuts the edges the same way wherever exactly it crosses them, so the
+				// winding is worked out with the edge midpoints (in half cells, so exactly) instead of the real vertices,
+				// which can sit right on a corner. The triangle has to face from the inside corners to the outside ones
+				auto emit = [&](const int (*edges)[2], int insideCorner, int outsideCorner)
+				{
+					int points[3][3];
+					for (int i = 0; i < 3; i++)
+					{
+						for (int axis = 0; axis < 3; axis++)
+							points[i][axis] = ((edges[i][0] >> axis) & 1) + ((edges[i][1] >> axis) & 1);
+					}
+
+					int facing = 0;
+					for (int axis = 0; axis < 3; axis++)
+					{
+						int u1 = points[1][(axis + 1) % 3] - points[0][(axis + 1) % 3], u2 = points[1][(axis + 2) % 3] - points[0][(axis + 2) % 3];
+						int v1 = points[2][(axis + 1) % 3] - points[0][(axis + 1) % 3], v2 = points[2][(axis + 2) % 3] - points[0][(axis + 2) % 3];
+						facing += (u1 * v2 - u2 * v1) * (((outsideCorner >> axis) & 1) - ((insideCorner >> axis) & 1));
+					}
+
+					uint32_t a = edgeVertex(edges[0][0], edges[0][1]);
+					uint32_t b = edgeVertex(edges[1][0], edges[1][1]);
+					uint32_t c = edgeVertex(edges[2][0], edges[2][1]);
+
+					layer.indices.push_back(a);
+					layer.indices.push_back((facing > 0) ? b : c);
+					layer.indices.push_back((facing > 0) ? c : b);
+				};
+
+				for (const int* tetrahedron : tetrahedra)
+				{
+					int insideCorners[4], outsideCorners[4];
+					int insideCount = 0, outsideCount = 0;
+					for (int i = 0; i < 4; i++)
+					{
+						if (mask & (1 << tetrahedron[i]))
+							insideCorners[insideCount++] = tetrahedron[i];
+						else
+							outsideCorners[outsideCount++] = tetrahedron[i];
+					}
+
+					if (insideCount == 0 || outsideCount == 0)
+						continue;
+
+					if (insideCount == 1 || outsideCount == 1)
+					{
+						// One corner cut off from the other three
+						int lone = (insideCount == 1) ? insideCorners[0] : outsideCorners[0];
+						const int* others = (insideCount == 1) ? outsideCorners : insideCorners;
+
+						const int edges[3][2] = { { lone, others[0] }, { lone, others[1] }, { lone, others[2] } };
+						emit(edges, insideCorners[0], outsideCorners[0]);
+					}
+					else
+					{
+						// Two and two, the cut is the quad ac, ad, bd, bc
+						int a = insideCorners[0], b = insideCorners[1], c = outsideCorners[0], d = outsideCorners[1];
+						const int first[3][2] = { { a, c }, { a, d }, { b, d } };
+						const int second[3][2] = { { a, c }, { b, d }, { b, c } };
+						emit(first, a, c);
+						emit(second, a, c);
+					}
+				}
+			}
+		}
+	});
+
+	if (cancelled != nullptr && *cancelled)
+		return false;
+
+	size_t indexCount = 0;
+	std::vector<size_t> firstIndex(size);
+	for (unsigned int z = 0; z < size; z++)
+	{
+		firstIndex[z] = indexCount;
+		indexCount += layers[z].indices.size();
+	}
+
+	positions.resize(3 * (size_t)vertexCount);
+	normals.resize(3 * (size_t)vertexCount);
+	indices.resize(indexCount);
+
+	forEachLayer(size, [&](size_t z)
+	{
+		const IsosurfaceLayer& layer = layers[z];
+		std::copy(layer.positions.begin(), layer.positions.end(), positions.begin() + 3 * (size_t)layer.firstVertex);
+		std::copy(layer.normals.begin(), layer.normals.end(), normals.begin() + 3 * (size_t)layer.firstVertex);
+		std::copy(layer.indices.begin(), layer.indices.end(), indices.begin() + firstIndex[z]);
+	});
+
+	return (cancelled == nullptr || !*cancelled);
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct ScalarVolume;
+class ThreadPool;
+
+// The surface where sign * value = isoValue in a ScalarVolume, with the inside (sign * value > isoValue) on the
+// back of the triangles. Extracted by marching tetrahedra: every cell is split into the 6 tetrahedra around its
+// main diagonal, which all cells cut the same way, so neighbours agree on the shared faces and there are no
+// ambiguous cases to resolve.
+//
+// Runs in two passes over the z layers, both spread over the pool:
+//	1. Every edge that crosses the surface gets its vertex, from the layer of the grid point the edge starts at.
+//	   An edge belongs to exactly one grid point, so every vertex exists once without any merging afterwards.
+//	2. Only cells whose corners straddle the surface look up their edge vertices and emit triangles.
+// Each layer fills its own arrays, they're concatenated once the counts are known.
+class Isosurface
+{
+public:
+	bool Extract(const ScalarVolume& volume, float isoValue, float sign = 1.0f, ThreadPool* pool = nullptr, const std::atomic<bool>* cancelled = nullptr);
+
+	size_t GetVertexCount() const { return positions.size() / 3; }
+	size_t GetTriangleCount() const { return indices.size() / 3; }
+
+	size_t GetByteSize() const { return (positions.size() + normals.size()) * sizeof(float) + indices.size() * sizeof(uint32_t); }
+
+public:
+	// xyz per vertex, the normals point out of the inside
+	std::vector<float> positions;
+	std::vector<float> normals;
+	std::vector<uint32_t> indices;
+};
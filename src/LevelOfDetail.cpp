@@ -0,0 +1,59 @@
+#include "LevelOfDetail.hpp"
+
+#define PI           3.14159265359
+
+#include <algorithm>
+#include <cmath>
+
+#include "Camera.hpp"
+
+float LevelOfDetail::pixelsPerCell = 2.0f;
+float LevelOfDetail::hysteresis = 0.25f;
+
+unsigned int LevelOfDetail::GetLevelCount(unsigned int resolution, int l)
+{
+	// Below about two samples per lobe the nodes end up in the wrong places
+	unsigned int minResolution = std::max(8u, 2u * (l + 1));
+
+	unsigned int count = 1;
+	while ((resolution >> count) >= minResolution)
+		count++;
+
+	return count;
+}
+
+unsigned int LevelOfDetail::GetResolution(unsigned int resolution, unsigned int level)
+{
+	return resolution >> level;
+}
+
+float LevelOfDetail::GetProjectedDiameter(Camera& camera, const glm::vec3& center, float radius, float viewportHeight)
+{
+	glm::vec4 viewCenter = camera.GetViewMatrix() * glm::vec4(center, 1.0f);
+	float distanceSquared = glm::dot(glm::vec3(viewCenter), glm::vec3(viewCenter));
+
+	// From the inside it covers the whole screen, and then some
+	if (distanceSquared <= radius * radius)
+		return INFINITY;
+
+	// The sphere's silhouette cone, scaled by the projection's focal length
+	float focalLength = camera.GetProjectionMatrix()[1][1];
+	return radius * focalLength / std::sqrt(distanceSquared - radius * radius) * viewportHeight;
+}
+
+unsigned int LevelOfDetail::SelectLevel(unsigned int resolution, int l, float projectedDiameter, unsigned int currentLevel)
+{
+	// The equator goes around about pi times the diameter
+	float wanted = (float)PI * projectedDiameter / pixelsPerCell;
+
+	unsigned int levelCount = GetLevelCount(resolution, l);
+	unsigned int level = std::min(currentLevel, levelCount - 1);
+
+	while (level > 0 && GetResolution(resolution, level) < wanted * (1.0f - hysteresis))
+		level--;
+
+	while (level + 1 < levelCount && GetResolution(resolution, level + 1) >= wanted * (1.0f + hysteresis))
+		level++;
+
+	return level;
+}
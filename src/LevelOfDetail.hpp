@@ -0,0 +1,29 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+class Camera;
+
+// The detail levels of an orbital: level 0 is the full resolution, every further level halves it
+// until that would drop below what the harmonic needs to keep its shape.
+//
+// Which level to draw follows from how large the orbital is on screen. A level stays selected until
+// the wanted resolution is clearly (by the hysteresis factor) outside of what it covers, so an orbital
+// right at the border between two levels doesn't pop back and forth every frame.
+class LevelOfDetail
+{
+public:
+	static unsigned int GetLevelCount(unsigned int resolution, int l);
+	static unsigned int GetResolution(unsigned int resolution, unsigned int level);
+
+	// Diameter in pixels of a bounding sphere in world space
+	static float GetProjectedDiameter(Camera& camera, const glm::vec3& center, float radius, float viewportHeight);
+
+	// Starts from the current level and only moves as far as needed
+	static unsigned int SelectLevel(unsigned int resolution, int l, float projectedDiameter, unsigned int currentLevel);
+
+public:
+	// How many pixels one grid cell should at least span along the equator
+	static float pixelsPerCell;
+	static float hysteresis;
+};
@@ -0,0 +1,330 @@
+#include "MeshArchive.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <tuple>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "ThreadPool.hpp"
+
+struct MeshArchive::Header
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t entryCount;
+	uint32_t alignment;
+	uint32_t reserved;
+	uint64_t fileSize;
+};
+
+struct MeshArchive::Entry
+{
+	int32_t l, m;
+	uint32_t resolution;
+	uint32_t format;
+	uint64_t offset;
+	uint64_t byteSize;
+};
+
+static const char archiveMagic[8] = { 'O', 'R', 'B', 'M', 'E', 'S', 'H', '\0' };
+
+static size_t GetGridByteSize(unsigned int resolution, VertexFormat format)
+{
+	return (size_t)(resolution + 1) * resolution * ((format == VertexFormat::Half) ? sizeof(uint16_t) : sizeof(float));
+}
+
+static auto GetOrder(int l, int m, unsigned int resolution, unsigned int format)
+{
+	return std::make_tuple(l, m, resolution, format);
+}
+
+MeshArchive::MeshArchive() :
+	data(nullptr), fileSize(0), entryCount(0)
+#ifdef _WIN32
+	, file(nullptr), mapping(nullptr)
+#endif
+{
+}
+
+MeshArchive::~MeshArchive()
+{
+	Close();
+}
+
+bool MeshArchive::Open(const std::string& path)
+{
+	Close();
+
+#ifdef _WIN32
+	HANDLE fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+	{
+		std::cerr << "Failed to open " << path << std::endl;
+		return false;
+	}
+
+	LARGE_INTEGER size;
+	HANDLE mappingHandle = nullptr;
+	if (GetFileSizeEx(fileHandle, &size) && size.QuadPart > 0)
+		mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+	const void* view = (mappingHandle != nullptr) ? MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (view == nullptr)
+	{
+		std::cerr << "Failed to map " << path << std::endl;
+		if (mappingHandle != nullptr)
+			CloseHandle(mappingHandle);
+		CloseHandle(fileHandle);
+		return false;
+	}
+
+	file = fileHandle;
+	mapping = mappingHandle;
+	fileSize = (size_t)size.QuadPart;
+#else
+	int descriptor = open(path.c_str(), O_RDONLY);
+	if (descriptor < 0)
+	{
+		std::cerr << "Failed to open " << path << std::endl;
+		return false;
+	}
+
+	struct stat status;
+	void* view = MAP_FAILED;
+	if (fstat(descriptor, &status) == 0 && status.st_size > 0)
+		view = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_SHARED, descriptor, 0);
+
+	// The mapping keeps the file alive by itself
+	close(descriptor);
+
+	if (view == MAP_FAILED)
+	{
+		std::cerr << "Failed to map " << path << std::endl;
+		return false;
+	}
+
+	fileSize = (size_t)status.st_size;
+#endif
+
+	data = (const unsigned char*)view;
+
+	// Only the header and the index are checked, the radii are never read here
+	Header header;
+	if (fileSize < sizeof(Header))
+	{
+		std::cerr << path << " is not a mesh archive" << std::endl;
+		Close();
+		return false;
+	}
+
+	std::memcpy(&header, data, sizeof(Header));
+	if (std::memcmp(header.magic, archiveMagic, sizeof(archiveMagic)) != 0)
+	{
+		std::cerr << path << " is not a mesh archive" << std::endl;
+		Close();
+		return false;
+	}
+
+	if (header.version != version)
+	{
+		std::cerr << path << " has version " << header.version << ", expected " << version << std::endl;
+		Close();
+		return false;
+	}
+
+	if (header.fileSize != fileSize || header.alignment == 0 || sizeof(Header) + (size_t)header.entryCount * sizeof(Entry) > fileSize)
+	{
+		std::cerr << path << " is truncated or corrupt" << std::endl;
+		Close();
+		return false;
+	}
+
+	entryCount = header.entryCount;
+	const Entry* entries = GetEntries();
+	for (size_t i = 0; i < entryCount; i++)
+	{
+		const Entry& entry = entries[i];
+		bool valid = entry.format <= (uint32_t)VertexFormat::Half && entry.offset % header.alignment == 0 &&
+			entry.offset <= fileSize && entry.byteSize <= fileSize - entry.offset &&
+			entry.byteSize == GetGridByteSize(entry.resolution, (VertexFormat)entry.format);
+
+		// Find() relies on the order
+		if (i > 0)
+		{
+			const Entry& previous = entries[i - 1];
+			valid &= GetOrder(previous.l, previous.m, previous.resolution, previous.format) < GetOrder(entry.l, entry.m, entry.resolution, entry.format);
+		}
+
+		if (!valid)
+		{
+			std::cerr << path << " is truncated or corrupt" << std::endl;
+			Close();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void MeshArchive::Close()
+{
+	if (data == nullptr)
+		return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(data);
+	CloseHandle((HANDLE)mapping);
+	CloseHandle((HANDLE)file);
+	file = nullptr;
+	mapping = nullptr;
+#else
+	munmap((void*)data, fileSize);
+#endif
+
+	data = nullptr;
+	fileSize = 0;
+	entryCount = 0;
+}
+
+const void* MeshArchive::Find(int l, int m, unsigned int resolution, VertexFormat format, size_t& byteSize) const
+{
+	if (data == nullptr)
+		return nullptr;
+
+	const Entry* entries = GetEntries();
+	auto key = GetOrder(l, m, resolution, (uint32_t)format);
+	const Entry* entry = std::lower_bound(entries, entries + entryCount, key, [](const Entry& entry, const decltype(key)& key)
+	{
+		return GetOrder(entry.l, entry.m, entry.resolution, entry.format) < key;
+	});
+
+	if (entry == entries + entryCount || GetOrder(entry->l, entry->m, entry->resolution, entry->format) != key)
+		return nullptr;
+
+	byteSize = (size_t)entry->byteSize;
+	return data + entry->offset;
+}
+
+const MeshArchive::Entry* MeshArchive::GetEntries() const
+{
+	// The header is a multiple of 8 bytes and the mapping starts on a page, so the entries are aligned
+	return (const Entry*)(data + sizeof(Header));
+}
+
+bool MeshArchive::Write(const std::string& path, std::vector<Key> keys, ThreadPool* pool)
+{
+	// Sorted without duplicates, that's the order of the index
+	auto order = [](const Key& key) { return GetOrder(key.l, key.m, key.resolution, (uint32_t)key.format); };
+	std::sort(keys.begin(), keys.end(), [&](const Key& a, const Key& b) { return order(a) < order(b); });
+	keys.erase(std::unique(keys.begin(), keys.end(), [&](const Key& a, const Key& b) { return order(a) == order(b); }), keys.end());
+
+	for (const Key& key : keys)
+	{
+		if (key.l < 0 || std::abs(key.m) > key.l || key.resolution < 2)
+		{
+			std::cerr << "Invalid mesh l = " << key.l << ", m = " << key.m << ", resolution = " << key.resolution << std::endl;
+			return false;
+		}
+	}
+
+	// Everything is laid out before anything is generated, so each mesh knows where it goes
+	std::vector<Entry> entries(keys.size());
+	uint64_t offset = sizeof(Header) + keys.size() * sizeof(Entry);
+	for (size_t i = 0; i < keys.size(); i++)
+	{
+		offset = (offset + alignment - 1) / alignment * alignment;
+		entries[i] = { keys[i].l, keys[i].m, keys[i].resolution, (uint32_t)keys[i].format, offset, GetGridByteSize(keys[i].resolution, keys[i].format) };
+		offset += entries[i].byteSize;
+	}
+
+	Header header = {};
+	std::memcpy(header.magic, archiveMagic, sizeof(archiveMagic));
+	header.version = version;
+	header.entryCount = (uint32_t)entries.size();
+	header.alignment = alignment;
+	header.fileSize = offset;
+
+	std::ofstream file(path, std::ios::binary);
+	if (!file)
+	{
+		std::cerr << "Failed to open " << path << " for writing" << std::endl;
+		return false;
+	}
+
+	file.write((const char*)&header, sizeof(Header));
+	file.write((const char*)entries.data(), entries.size() * sizeof(Entry));
+
+	// The padding in front of the first mesh, the others are padded as they're written
+	std::mutex fileMutex;
+	uint64_t written = sizeof(Header) + entries.size() * sizeof(Entry);
+	std::vector<char> padding(alignment, 0);
+
+	// The meshes finish in any order, but are written in the order of the index. Finished ones wait for their turn
+	std::vector<std::unique_ptr<OrbitalMesh>> finished(keys.size());
+	size_t next = 0;
+
+	// A slow mesh holds up writing everything behind it, so a mesh isn't started until it's less than window
+	// meshes behind the next one to be written. Indices are handed out in order, so the next one is always
+	// already being worked on and never waits
+	const size_t window = 2 * (size_t)((pool != nullptr) ? pool->GetThreadCount() + 1 : 1);
+	std::condition_variable writtenChanged;
+
+	auto generate = [&](size_t i)
+	{
+		{
+			std::unique_lock<std::mutex> lock(fileMutex);
+			writtenChanged.wait(lock, [&]() { return i < next + window; });
+		}
+
+		std::unique_ptr<OrbitalMesh> mesh = std::make_unique<OrbitalMesh>(keys[i].l, keys[i].m, keys[i].resolution, keys[i].format);
+		mesh->Generate();
+
+		std::lock_guard<std::mutex> lock(fileMutex);
+		finished[i] = std::move(mesh);
+
+		while (next < keys.size() && finished[next] != nullptr)
+		{
+			file.write(padding.data(), (std::streamsize)(entries[next].offset - written));
+			file.write((const char*)finished[next]->GetVertexData(), (std::streamsize)entries[next].byteSize);
+			written = entries[next].offset + entries[next].byteSize;
+
+			finished[next].reset();
+			next++;
+		}
+
+		writtenChanged.notify_all();
+	};
+
+	if (pool == nullptr)
+	{
+		for (size_t i = 0; i < keys.size(); i++)
+			generate(i);
+	}
+	else
+	{
+		pool->ParallelFor(keys.size(), generate);
+	}
+
+	file.close();
+	if (file.fail())
+	{
+		std::cerr << "Failed to write " << path << std::endl;
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "OrbitalMesh.hpp"
+
+class ThreadPool;
+
+// A file of precomputed grid meshes that is memory mapped instead of read. It starts with a header and
+// an index of every mesh sorted by (l, m, resolution, format), then come the radii of each mesh, every
+// one of them starting on a page of its own. Opening the archive only checks the header and the index,
+// the radii are used right where they're mapped (and only paged in when something touches them).
+//
+// File layout, little endian:
+//   Header    magic "ORBMESH\0", version, entry count, alignment, file size
+//   Entry[]   l, m, resolution, format, offset, byte size
+//   ...       radii, aligned to alignment
+//
+// Only grid meshes are stored. Their vertices follow from the resolution, the radii are all there is to them.
+class MeshArchive
+{
+public:
+	struct Key
+	{
+		int l, m;
+		unsigned int resolution;
+		VertexFormat format;
+	};
+
+public:
+	MeshArchive();
+	~MeshArchive();
+
+	MeshArchive(const MeshArchive&) = delete;
+	MeshArchive& operator=(const MeshArchive&) = delete;
+
+	bool Open(const std::string& path);
+	void Close();
+	bool IsOpen() const { return data != nullptr; }
+
+	// The mapped radii of the mesh, nullptr if it isn't in the archive
+	const void* Find(int l, int m, unsigned int resolution, VertexFormat format, size_t& byteSize) const;
+
+	size_t GetEntryCount() const { return entryCount; }
+	size_t GetFileSize() const { return fileSize; }
+
+	// Generates all the meshes (one pool task each) and writes them into a new archive. Each mesh is written
+	// as soon as the ones in front of it are, and no more than two per thread are generated or waiting at once
+	static bool Write(const std::string& path, std::vector<Key> keys, ThreadPool* pool = nullptr);
+
+	static const uint32_t version = 1;
+	static const uint32_t alignment = 4096;
+
+private:
+	struct Header;
+	struct Entry;
+
+	const Entry* GetEntries() const;
+
+private:
+	const unsigned char* data;
+	size_t fileSize;
+	size_t entryCount;
+
+#ifdef _WIN32
+	void* file;
+	void* mapping;
+#endif
+};
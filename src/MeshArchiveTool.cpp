@@ -0,0 +1,64 @@
+// Precomputes grid meshes into an archive that the program maps at startup (see MeshArchive), so the
+// orbitals in it never have to be generated. Every (l, m) with l <= max l is stored at every resolution given.
+//
+//		orbitals_archive [--half] <output> <max l> <resolution> [resolution...]
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "MeshArchive.hpp"
+#include "ThreadPool.hpp"
+
+int main(int argc, char** argv)
+{
+	VertexFormat format = VertexFormat::Float;
+	std::vector<const char*> arguments;
+	for (int i = 1; i < argc; i++)
+	{
+		if (std::strcmp(argv[i], "--half") == 0)
+			format = VertexFormat::Half;
+		else
+			arguments.push_back(argv[i]);
+	}
+
+	if (arguments.size() < 3)
+	{
+		std::cerr << "Usage: orbitals_archive [--half] <output> <max l> <resolution> [resolution...]" << std::endl;
+		return -1;
+	}
+
+	int maxL = std::atoi(arguments[1]);
+	if (maxL < 0)
+	{
+		std::cerr << "Invalid max l" << std::endl;
+		return -1;
+	}
+
+	std::vector<MeshArchive::Key> keys;
+	for (size_t i = 2; i < arguments.size(); i++)
+	{
+		int resolution = std::atoi(arguments[i]);
+		if (resolution < 2)
+		{
+			std::cerr << "Invalid resolution " << arguments[i] << std::endl;
+			return -1;
+		}
+
+		for (int l = 0; l <= maxL; l++)
+		{
+			for (int m = -l; m <= l; m++)
+				keys.push_back({ l, m, (unsigned int)resolution, format });
+		}
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	if (!MeshArchive::Write(arguments[0], keys, &ThreadPool::GetDefault()))
+		return -1;
+
+	float seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "Wrote " << keys.size() << " meshes to " << arguments[0] << " in " << seconds << " s" << std::endl;
+	return 0;
+}
@@ -0,0 +1,94 @@
+#include "MeshCache.hpp"
+
+#include <functional>
+
+MeshCache::MeshCache(size_t budget) :
+	budget(budget), size(0), hits(0), misses(0), evictions(0)
+{
+}
+
+bool MeshCache::Find(int l, int m, unsigned int resolution, VertexFormat format, MeshType type, Entry& entry, bool count)
+{
+	auto it = lookup.find({ l, m, resolution, format, type });
+	if (it == lookup.end())
+	{
+		if (count)
+			misses++;
+
+		return false;
+	}
+
+	if (count)
+		hits++;
+
+	entries.splice(entries.begin(), entries, it->second);
+	entry = it->second->entry;
+	return true;
+}
+
+void MeshCache::Insert(const Entry& entry)
+{
+	Key key = { entry.mesh->l, entry.mesh->m, entry.mesh->resolution, entry.mesh->format, entry.mesh->type };
+
+	// Once in main memory and once on the GPU
+	Insert(key, entry, 2 * entry.mesh->GetByteSize());
+}
+
+void MeshCache::Insert(int l, int m, unsigned int resolution, VertexFormat format, MeshType type, size_t byteSize, const std::shared_ptr<GpuMesh>& gpuMesh)
+{
+	Insert({ l, m, resolution, format, type }, { nullptr, gpuMesh }, byteSize);
+}
+
+void MeshCache::Insert(const Key& key, const Entry& entry, size_t entrySize)
+{
+	if (entrySize > budget)
+		return;
+
+	auto it = lookup.find(key);
+	if (it != lookup.end())
+	{
+		size -= it->second->size;
+		entries.erase(it->second);
+		lookup.erase(it);
+	}
+
+	entries.push_front({ key, entry, entrySize });
+	lookup[key] = entries.begin();
+	size += entrySize;
+
+	Evict();
+}
+
+void MeshCache::Clear()
+{
+	entries.clear();
+	lookup.clear();
+	size = 0;
+}
+
+void MeshCache::SetBudget(size_t budget)
+{
+	this->budget = budget;
+	Evict();
+}
+
+void MeshCache::Evict()
+{
+	while (size > budget && !entries.empty())
+	{
+		size -= entries.back().size;
+		lookup.erase(entries.back().key);
+		entries.pop_back();
+		evictions++;
+	}
+}
+
+size_t MeshCache::KeyHash::operator()(const Key& key) const
+{
+	size_t hash = std::hash<int>()(key.l);
+	hash = hash * 31 + std::hash<int>()(key.m);
+	hash = hash * 31 + std::hash<unsigned int>()(key.resolution);
+	hash = hash * 31 + std::hash<int>()((int)key.format);
+	hash = hash * 31 + std::hash<int>()((int)key.type);
+	return hash;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <unordered_map>
+
+#include "OrbitalMesh.hpp"
+
+class GpuMesh;
+
+// Keeps recently generated orbital meshes around, both the CPU arrays and the GPU buffers.
+// Once the total size goes over the budget the least recently used meshes are dropped.
+// (Meshes that are still in use elsewhere stay alive through their shared_ptr, they just stop counting.)
+class MeshCache
+{
+public:
+	// The mesh is empty for meshes that only live on the GPU
+	struct Entry
+	{
+		std::shared_ptr<const OrbitalMesh> mesh;
+		std::shared_ptr<GpuMesh> gpuMesh;
+	};
+
+public:
+	MeshCache(size_t budget);
+
+	// Counts as a hit or a miss unless count is false (for lookups that follow up on a counted one),
+	// and marks the entry as most recently used
+	bool Find(int l, int m, unsigned int resolution, VertexFormat format, MeshType type, Entry& entry, bool count = true);
+	void Insert(const Entry& entry);
+
+	// For meshes uploaded without an OrbitalMesh, like the ones mapped from a MeshArchive. Only the GPU copy counts
+	void Insert(int l, int m, unsigned int resolution, VertexFormat format, MeshType type, size_t byteSize, const std::shared_ptr<GpuMesh>& gpuMesh);
+	void Clear();
+
+	void SetBudget(size_t budget);
+	size_t GetBudget() const { return budget; }
+	size_t GetSize() const { return size; }
+	size_t GetEntryCount() const { return entries.size(); }
+
+	unsigned int GetHits() const { return hits; }
+	unsigned int GetMisses() const { return misses; }
+	unsigned int GetEvictions() const { return evictions; }
+
+private:
+	struct Key
+	{
+		int l, m;
+		unsigned int resolution;
+		VertexFormat format;
+		MeshType type;
+
+		bool operator==(const Key& other) const { return l == other.l && m == other.m && resolution == other.resolution && format == other.format && type == other.type; }
+	};
+
+	struct KeyHash
+	{
+		size_t operator()(const Key& key) const;
+	};
+
+	struct Node
+	{
+		Key key;
+		Entry entry;
+		size_t size;
+	};
+
+	void Insert(const Key& key, const Entry& entry, size_t entrySize);
+	void Evict();
+
+private:
+	size_t budget, size;
+	unsigned int hits, misses, evictions;
+
+	// Most recently used first
+	std::list<Node> entries;
+	std::unordered_map<Key, std::list<Node>::iterator, KeyHash> lookup;
+};
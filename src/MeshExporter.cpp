@@ -0,0 +1,514 @@
+#include "MeshExporter.hpp"
+
+#define PI           3.14159265359
+#define TWO_PI       6.28318530718
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "OrbitalMesh.hpp"
+#include "SphereSampling.hpp"
+#include "ThreadPool.hpp"
+
+// Hands out room in a buffer of chunkSize bytes and writes it to the file whenever it runs out.
+// Everything is written in the machine's byte order, all formats here are little endian like the
+// machines this runs on
+class ChunkedFile
+{
+public:
+	ChunkedFile(const std::string& path, size_t chunkSize) :
+		file(path, std::ios::binary), used(0)
+	{
+		buffer.resize(std::max(chunkSize, (size_t)4096));
+	}
+
+	bool IsOpen() const { return (bool)file; }
+
+	// The next size bytes to fill, size has to fit into a chunk
+	unsigned char* Reserve(size_t size)
+	{
+		if (used + size > buffer.size())
+			Flush();
+
+		unsigned char* out = buffer.data() + used;
+		used += size;
+		return out;
+	}
+
+	void Write(const void* data, size_t size)
+	{
+		std::memcpy(Reserve(size), data, size);
+	}
+
+	template<typename T>
+	void Put(T value)
+	{
+		Write(&value, sizeof(T));
+	}
+
+	bool Finish()
+	{
+		Flush();
+		file.close();
+		return !file.fail();
+	}
+
+private:
+	void Flush()
+	{
+		file.write((const char*)buffer.data(), used);
+		used = 0;
+	}
+
+	std::ofstream file;
+	std::vector<unsigned char> buffer;
+	size_t used;
+};
+
+// Positions and triangles of a mesh as they're needed, from the radii and the grid or sampling.
+//
+// All vertices of the grid's first and last ring sit on a pole. They're welded into one vertex per pole and the
+// triangles that collapse with them are dropped, so the exported surface is closed. The welded vertices are
+// numbered pole, rings 1 to resolution - 1, pole
+class MeshSource
+{
+public:
+	MeshSource(const OrbitalMesh& mesh) :
+		mesh(mesh)
+	{
+		if (mesh.IsSampled())
+		{
+			indices = mesh.sampling->indices.data();
+			indexCount = mesh.sampling->indices.size();
+			vertexCount = mesh.GetVertexCount();
+		}
+		else
+		{
+			// The directions of the grid follow from sin and cos per ring and column, like in the orbital shader
+			unsigned int resolution = mesh.resolution;
+			ringSin.resize(resolution + 1);
+			ringCos.resize(resolution + 1);
+			for (unsigned int ring = 0; ring <= resolution; ring++)
+			{
+				ringSin[ring] = (float)std::sin(ring * PI / resolution);
+				ringCos[ring] = (float)std::cos(ring * PI / resolution);
+			}
+
+			columnSin.resize(resolution);
+			columnCos.resize(resolution);
+			for (unsigned int column = 0; column < resolution; column++)
+			{
+				columnSin[column] = (float)std::sin(column * TWO_PI / resolution);
+				columnCos[column] = (float)std::cos(column * TWO_PI / resolution);
+			}
+
+			vertexCount = (size_t)(resolution - 1) * resolution + 2;
+		}
+
+		triangleCount = 0;
+		ForEachTriangle([&](const uint32_t*) { triangleCount++; });
+	}
+
+	size_t GetVertexCount() const { return vertexCount; }
+	size_t GetTriangleCount() const { return triangleCount; }
+
+	bool IsNegative(size_t vertex) const { return mesh.GetRadius(GetMeshVertex(vertex)) < 0.0f; }
+
+	void GetPosition(size_t vertex, float* out) const
+	{
+		size_t meshVertex = GetMeshVertex(vertex);
+		float radius = std::abs(mesh.GetRadius(meshVertex));
+		if (mesh.IsSampled())
+		{
+			const float* direction = mesh.sampling->directions.data() + 3 * meshVertex;
+			out[0] = radius * direction[0];
+			out[1] = radius * direction[1];
+			out[2] = radius * direction[2];
+			return;
+		}
+
+		size_t ring = meshVertex / mesh.resolution, column = meshVertex % mesh.resolution;
+		out[0] = radius * ringSin[ring] * columnCos[column];
+		out[1] = radius * ringSin[ring] * columnSin[column];
+		out[2] = radius * ringCos[ring];
+	}
+
+	// Every triangle that isn't degenerate, facing outwards, in the numbering of the exported vertices
+	template<typename Function>
+	void ForEachTriangle(Function function) const
+	{
+		auto emit = [&](uint32_t a, uint32_t b, uint32_t c)
+		{
+			uint32_t triangle[3] = { a, b, c };
+			if (a != b && b != c && c != a)
+				function(triangle);
+		};
+
+		if (indices != nullptr)
+		{
+			for (size_t first = 0; first < indexCount; first += 3)
+				emit(indices[first + 0], indices[first + 1], indices[first + 2]);
+
+			return;
+		}
+
+		// The two triangles of every grid cell, like GridIndices' triangle list but the other way around
+		uint32_t resolution = mesh.resolution;
+		for (uint32_t ring = 0; ring < resolution; ring++)
+		{
+			for (uint32_t column = 0; column < resolution; column++)
+			{
+				uint32_t next = (column + 1) % resolution;
+				uint32_t topLeft = GetExportedVertex(resolution * ring + column), topRight = GetExportedVertex(resolution * ring + next);
+				uint32_t bottomLeft = GetExportedVertex(resolution * (ring + 1) + column), bottomRight = GetExportedVertex(resolution * (ring + 1) + next);
+
+				emit(topLeft, bottomRight, topRight);
+				emit(topLeft, bottomLeft, bottomRight);
+			}
+		}
+	}
+
+private:
+	size_t GetMeshVertex(size_t vertex) const
+	{
+		if (mesh.IsSampled() || vertex == 0)
+			return vertex;
+
+		// The last exported vertex is the first of the last ring
+		return vertex + mesh.resolution - 1;
+	}
+
+	uint32_t GetExportedVertex(uint32_t meshVertex) const
+	{
+		uint32_t resolution = mesh.resolution;
+		uint32_t ring = meshVertex / resolution;
+		if (ring == 0)
+			return 0;
+		if (ring == resolution)
+			return (uint32_t)vertexCount - 1;
+
+		return meshVertex - resolution + 1;
+	}
+
+private:
+	const OrbitalMesh& mesh;
+
+	const uint32_t* indices = nullptr;
+	size_t indexCount = 0;
+	size_t vertexCount, triangleCount;
+
+	std::vector<float> ringSin, ringCos, columnSin, columnCos;
+};
+
+MeshExporter::MeshExporter(MeshFileFormat format) :
+	format(format), positiveColor{ 1.0f, 1.0f, 0.5f }, negativeColor{ 0.5f, 1.0f, 1.0f }, chunkSize(1 << 20)
+{
+}
+
+bool MeshExporter::Write(const OrbitalMesh& mesh, const std::string& path) const
+{
+	switch (format)
+	{
+	case MeshFileFormat::Ply:
+		return WritePly(mesh, path);
+	case MeshFileFormat::Glb:
+		return WriteGlb(mesh, path);
+	default:
+		return WriteStl(mesh, path);
+	}
+}
+
+bool MeshExporter::WriteAll(int maxL, unsigned int resolution, const std::string& directory, ThreadPool* pool) const
+{
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+	if (error)
+	{
+		std::cerr << "Failed to create " << directory << ": " << error.message() << std::endl;
+		return false;
+	}
+
+	// Orbital i is (l, m) with i = l^2 + l + m
+	std::atomic<bool> succeeded{ true };
+	auto exportOrbital = [&](size_t i)
+	{
+		int l = (int)std::sqrt((double)i);
+		while (l * l > (int)i)
+			l--;
+		while ((l + 1) * (l + 1) <= (int)i)
+			l++;
+
+		int m = (int)i - l * l - l;
+
+		OrbitalMesh mesh(l, m, resolution);
+		mesh.Generate();
+
+		std::string path = directory + "/orbital_" + std::to_string(l) + "_" + std::to_string(m) + "." + GetExtension();
+		if (!Write(mesh, path))
+			succeeded = false;
+	};
+
+	size_t count = (size_t)(maxL + 1) * (maxL + 1);
+	if (pool == nullptr)
+	{
+		for (size_t i = 0; i < count; i++)
+			exportOrbital(i);
+	}
+	else
+	{
+		pool->ParallelFor(count, exportOrbital);
+	}
+
+	return succeeded;
+}
+
+const char* MeshExporter::GetExtension() const
+{
+	switch (format)
+	{
+	case MeshFileFormat::Ply:
+		return "ply";
+	case MeshFileFormat::Glb:
+		return "glb";
+	default:
+		return "stl";
+	}
+}
+
+bool MeshExporter::FormatFromPath(const std::string& path, MeshFileFormat& format)
+{
+	std::string extension = std::filesystem::path(path).extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+
+	if (extension == ".ply")
+		format = MeshFileFormat::Ply;
+	else if (extension == ".glb")
+		format = MeshFileFormat::Glb;
+	else if (extension == ".stl")
+		format = MeshFileFormat::Stl;
+	else
+		return false;
+
+	return true;
+}
+
+bool MeshExporter::WritePly(const OrbitalMesh& mesh, const std::string& path) const
+{
+	ChunkedFile file(path, chunkSize);
+	if (!file.IsOpen())
+	{
+		std::cerr << "Failed to open " << path << " for writing" << std::endl;
+		return false;
+	}
+
+	MeshSource source(mesh);
+
+	std::ostringstream header;
+	header << "ply\nformat binary_little_endian 1.0\n";
+	header << "comment orbital l = " << mesh.l << ", m = " << mesh.m << "\n";
+	header << "element vertex " << source.GetVertexCount() << "\n";
+	header << "property float x\nproperty float y\nproperty float z\n";
+	header << "property uchar red\nproperty uchar green\nproperty uchar blue\n";
+	header << "element face " << source.GetTriangleCount() << "\n";
+	header << "property list uchar uint vertex_indices\nend_header\n";
+
+	std::string text = header.str();
+	file.Write(text.data(), text.size());
+
+	unsigned char colors[2][3];
+	for (int i = 0; i < 3; i++)
+	{
+		colors[0][i] = (unsigned char)std::lround(255.0f * std::clamp(positiveColor[i], 0.0f, 1.0f));
+		colors[1][i] = (unsigned char)std::lround(255.0f * std::clamp(negativeColor[i], 0.0f, 1.0f));
+	}
+
+	// The records aren't aligned, so everything is copied in bytewise
+	for (size_t vertex = 0; vertex < source.GetVertexCount(); vertex++)
+	{
+		float position[3];
+		source.GetPosition(vertex, position);
+
+		unsigned char* out = file.Reserve(15);
+		std::memcpy(out, position, 12);
+		std::memcpy(out + 12, colors[source.IsNegative(vertex)], 3);
+	}
+
+	source.ForEachTriangle([&](const uint32_t* indices)
+	{
+		unsigned char* out = file.Reserve(13);
+		out[0] = 3;
+		std::memcpy(out + 1, indices, 12);
+	});
+
+	if (!file.Finish())
+	{
+		std::cerr << "Failed to write " << path << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+bool MeshExporter::WriteGlb(const OrbitalMesh& mesh, const std::string& path) const
+{
+	ChunkedFile file(path, chunkSize);
+	if (!file.IsOpen())
+	{
+		std::cerr << "Failed to open " << path << " for writing" << std::endl;
+		return false;
+	}
+
+	MeshSource source(mesh);
+	size_t vertexCount = source.GetVertexCount(), indexCount = 3 * source.GetTriangleCount();
+
+	// glTF wants the bounds of the positions up front, that's one more pass over the radii
+	float low[3] = { 0.0f, 0.0f, 0.0f }, high[3] = { 0.0f, 0.0f, 0.0f };
+	for (size_t vertex = 0; vertex < vertexCount; vertex++)
+	{
+		float position[3];
+		source.GetPosition(vertex, position);
+		for (int axis = 0; axis < 3; axis++)
+		{
+			low[axis] = (vertex == 0) ? position[axis] : std::min(low[axis], position[axis]);
+			high[axis] = (vertex == 0) ? position[axis] : std::max(high[axis], position[axis]);
+		}
+	}
+
+	// Positions, then RGBA colors (4 bytes so every element stays aligned), then the indices
+	size_t positionBytes = 12 * vertexCount, colorBytes = 4 * vertexCount, indexBytes = 4 * indexCount;
+	size_t binaryBytes = positionBytes + colorBytes + indexBytes;
+
+	std::ostringstream json;
+	json.precision(9);
+	json << "{\"asset\":{\"version\":\"2.0\",\"generator\":\"orbitals\"},\"scene\":0,\"scenes\":[{\"nodes\":[0]}],";
+	json << "\"nodes\":[{\"mesh\":0,\"name\":\"orbital " << mesh.l << " " << mesh.m << "\"}],";
+	json << "\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"COLOR_0\":1},\"indices\":2,\"mode\":4}]}],";
+	json << "\"buffers\":[{\"byteLength\":" << binaryBytes << "}],";
+	json << "\"bufferViews\":[";
+	json << "{\"buffer\":0,\"byteOffset\":0,\"byteLength\":" << positionBytes << ",\"target\":34962},";
+	json << "{\"buffer\":0,\"byteOffset\":" << positionBytes << ",\"byteLength\":" << colorBytes << ",\"target\":34962},";
+	json << "{\"buffer\":0,\"byteOffset\":" << positionBytes + colorBytes << ",\"byteLength\":" << indexBytes << ",\"target\":34963}],";
+	json << "\"accessors\":[";
+	json << "{\"bufferView\":0,\"componentType\":5126,\"count\":" << vertexCount << ",\"type\":\"VEC3\",";
+	json << "\"min\":[" << low[0] << "," << low[1] << "," << low[2] << "],\"max\":[" << high[0] << "," << high[1] << "," << high[2] << "]},";
+	json << "{\"bufferView\":1,\"componentType\":5121,\"normalized\":true,\"count\":" << vertexCount << ",\"type\":\"VEC4\"},";
+	json << "{\"bufferView\":2,\"componentType\":5125,\"count\":" << indexCount << ",\"type\":\"SCALAR\"}]}";
+
+	// Chunks are padded to 4 bytes, the JSON with spaces
+	std::string text = json.str();
+	text.append((4 - text.size() % 4) % 4, ' ');
+
+	size_t totalBytes = 12 + 8 + text.size() + 8 + binaryBytes;
+	if (totalBytes > UINT32_MAX)
+	{
+		std::cerr << "The mesh is too big for a .glb file" << std::endl;
+		return false;
+	}
+
+	file.Put<uint32_t>(0x46546C67);		// "glTF"
+	file.Put<uint32_t>(2);
+	file.Put<uint32_t>((uint32_t)totalBytes);
+
+	file.Put<uint32_t>((uint32_t)text.size());
+	file.Put<uint32_t>(0x4E4F534A);		// "JSON"
+	file.Write(text.data(), text.size());
+
+	file.Put<uint32_t>((uint32_t)binaryBytes);
+	file.Put<uint32_t>(0x004E4942);		// "BIN"
+
+	for (size_t vertex = 0; vertex < vertexCount; vertex++)
+	{
+		float position[3];
+		source.GetPosition(vertex, position);
+		file.Write(position, 12);
+	}
+
+	unsigned char colors[2][4];
+	for (int i = 0; i < 3; i++)
+	{
+		colors[0][i] = (unsigned char)std::lround(255.0f * std::clamp(positiveColor[i], 0.0f, 1.0f));
+		colors[1][i] = (unsigned char)std::lround(255.0f * std::clamp(negativeColor[i], 0.0f, 1.0f));
+	}
+	colors[0][3] = colors[1][3] = 255;
+
+	for (size_t vertex = 0; vertex < vertexCount; vertex++)
+		file.Write(colors[source.IsNegative(vertex)], 4);
+
+	source.ForEachTriangle([&](const uint32_t* indices) { file.Write(indices, 12); });
+
+	if (!file.Finish())
+	{
+		std::cerr << "Failed to write " << path << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+bool MeshExporter::WriteStl(const OrbitalMesh& mesh, const std::string& path) const
+{
+	ChunkedFile file(path, chunkSize);
+	if (!file.IsOpen())
+	{
+		std::cerr << "Failed to open " << path << " for writing" << std::endl;
+		return false;
+	}
+
+	MeshSource source(mesh);
+	if (source.GetTriangleCount() > UINT32_MAX)
+	{
+		std::cerr << "The mesh is too big for an .stl file" << std::endl;
+		return false;
+	}
+
+	// The 80 byte header must not start with "solid", that would make it ASCII STL
+	char header[80] = { 0 };
+	std::snprintf(header, sizeof(header), "orbital l = %d, m = %d", mesh.l, mesh.m);
+	file.Write(header, sizeof(header));
+	file.Put<uint32_t>((uint32_t)source.GetTriangleCount());
+
+	source.ForEachTriangle([&](const uint32_t* indices)
+	{
+		float corners[9];
+		for (int i = 0; i < 3; i++)
+			source.GetPosition(indices[i], corners + 3 * i);
+
+		float u[3], v[3], normal[3];
+		for (int axis = 0; axis < 3; axis++)
+		{
+			u[axis] = corners[3 + axis] - corners[axis];
+			v[axis] = corners[6 + axis] - corners[axis];
+		}
+
+		normal[0] = u[1] * v[2] - u[2] * v[1];
+		normal[1] = u[2] * v[0] - u[0] * v[2];
+		normal[2] = u[0] * v[1] - u[1] * v[0];
+
+		float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		for (int axis = 0; axis < 3; axis++)
+			normal[axis] = (length > 0.0f) ? normal[axis] / length : 0.0f;
+
+		// Normal, the three corners and an unused attribute. 50 bytes, so the records aren't aligned
+		unsigned char* out = file.Reserve(50);
+		std::memcpy(out, normal, 12);
+		std::memcpy(out + 12, corners, 36);
+		out[48] = out[49] = 0;
+	});
+
+	if (!file.Finish())
+	{
+		std::cerr << "Failed to write " << path << std::endl;
+		return false;
+	}
+
+	return true;
+}
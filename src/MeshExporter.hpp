@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+class OrbitalMesh;
+class ThreadPool;
+
+enum class MeshFileFormat
+{
+	Ply,		// Binary little endian PLY with vertex colors
+	Glb,		// glTF 2.0 binary, vertex colors as COLOR_0
+	Stl			// Binary STL, no colors
+};
+
+// Writes an OrbitalMesh into a mesh file. The positions (|radius| * direction) and sign colors are worked out
+// vertex by vertex straight from the mesh's radii and its grid or sampling, and go through a fixed size buffer
+// that is flushed to the file whenever it's full. The indices are copied from the sampling, or
+// made up cell by cell for the grid, the same way. Nothing the size of the mesh is ever built on the side, so a big mesh costs about
+// as much as writing its bytes.
+//
+// The grid is wound clockwise seen from outside, every exported triangle is turned to face outwards. The grid's
+// pole rings are welded into a single vertex per pole and the triangles that collapse with them are left out,
+// so the exported surface is closed.
+class MeshExporter
+{
+public:
+	MeshExporter(MeshFileFormat format);
+
+	bool Write(const OrbitalMesh& mesh, const std::string& path) const;
+
+	// Generates every orbital with l <= maxL at the resolution and writes it to directory/orbital_<l>_<m>.<extension>.
+	// Each orbital is generated and written by one task of the pool, so the files are written in parallel
+	bool WriteAll(int maxL, unsigned int resolution, const std::string& directory, ThreadPool* pool = nullptr) const;
+
+	const char* GetExtension() const;
+
+	// Picks the format from the extension of the path (.ply, .glb or .stl), false if it's none of them
+	static bool FormatFromPath(const std::string& path, MeshFileFormat& format);
+
+public:
+	MeshFileFormat format;
+
+	// RGB in [0, 1], like the orbital's colors
+	float positiveColor[3], negativeColor[3];
+
+	// Bytes collected before each write
+	size_t chunkSize;
+
+private:
+	bool WritePly(const OrbitalMesh& mesh, const std::string& path) const;
+	bool WriteGlb(const OrbitalMesh& mesh, const std::string& path) const;
+	bool WriteStl(const OrbitalMesh& mesh, const std::string& path) const;
+};
@@ -33,6 +33,13 @@ void Model::Draw()
 	glBindVertexArray(0);
 }
 
+void Model::DrawInstanced(unsigned int instanceCount)
+{
+	glBindVertexArray(vao);
+	glDrawElementsInstanced(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0, instanceCount);
+	glBindVertexArray(0);
+}
+
 void Model::CreateVAO()
 {
 	glGenVertexArrays(1, &vao);
@@ -12,6 +12,7 @@ public:
 	virtual ~Model();
 
 	void Draw();
+	void DrawInstanced(unsigned int instanceCount);
 
 protected:
 	void CreateVAO();
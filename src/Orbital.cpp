@@ -1,28 +1,32 @@
 #include "Orbital.hpp"
 
-#define TWO_PI       6.28318530718
-#define PI           3.14159265359
+#define FOUR_PI      12.5663706144
 
+#include <algorithm>
 #include <cmath>
-#include <complex>
-#include <functional>
 
 #include <glad/glad.h>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
 #include "Shader.hpp"
-#include "Camera.hpp"
+#include "GpuMesh.hpp"
+#include "ExpansionGrid.hpp"
+#include "IndexBuffer.hpp"
+#include "LevelOfDetail.hpp"
+#include "MeshArchive.hpp"
+#include "MeshCache.hpp"
+#include "OrbitalMesh.hpp"
+#include "StreamingMesh.hpp"
+#include "ThreadPool.hpp"
 
 // Write some shaders to display the orbitals (too lazy to put them in files)
 Shader* Orbital::defaultShader = nullptr; 
 
-std::complex<double> SphericalHarmonic(unsigned int l, unsigned int m, float theta, float phi);
-unsigned int Fac(unsigned int n);
-
-Orbital::Orbital(int l, int m) :
+Orbital::Orbital(int l, int m, MeshCache* cache, const MeshArchive* archive) :
 	l(l), m(m), positiveColor({ 1.0f, 1.0f, 0.5f }), negativeColor({ 0.5f, 1.0f, 1.0f }),
-	resolution(70)
+	resolution(70), vertexFormat(VertexFormat::Float), meshType(MeshType::Grid), superposition(false),
+	animate(false), energyScale(0.2f), rotationSpeed(0.0f), levelOfDetail(true), modelMatrix(1.0f), backPending(false), level(0), cache(cache), archive(archive), animationTime(0.0)
 {
 	if (defaultShader == nullptr)
 	{
@@ -30,22 +34,44 @@ Orbital::Orbital(int l, int m) :
 			R"(
 			#version 460 core
 
-			layout(location = 0) in vec3 position;
-			layout(location = 1) in uint sign;		// 1 = positive, 0 = negative
+			layout(location = 0) in float radius;		// Signed, the sign picks the color
+			layout(location = 1) in vec3 sampledDirection;	// Only for sampled meshes
 
 			out vec3 outColor;
 
+			layout(std140, binding = 0) uniform Camera
+			{
+				mat4 view;
+				mat4 projection;
+				mat4 viewProjection;
+				vec4 cameraPosition;
+			};
+
 			uniform mat4 model;
-			uniform mat4 view;
-			uniform mat4 projection;
 
 			uniform vec3 positiveColor;
 			uniform vec3 negativeColor;
 
+			// The vertices are laid out ring by ring, resolution per ring. 0 for sampled meshes
+			uniform uint resolution;
+
+			const float PI = 3.14159265359f;
+
 			void main()
 			{
-				outColor = (sign > 0) ? positiveColor : negativeColor;
-				gl_Position = projection * view * model * vec4(position, 1.0f);
+				vec3 direction = sampledDirection;
+				if (resolution != 0u)
+				{
+					uint ring = uint(gl_VertexID) / resolution;
+					uint column = uint(gl_VertexID) % resolution;
+
+					float theta = float(ring) * PI / float(resolution);
+					float phi = float(column) * 2.0f * PI / float(resolution);
+					direction = vec3(sin(theta) * cos(phi), sin(theta) * sin(phi), cos(theta));
+				}
+
+				outColor = (radius >= 0.0f) ? positiveColor : negativeColor;
+				gl_Position = viewProjection * model * vec4(abs(radius) * direction, 1.0f);
 			}	
 		)",
 
@@ -63,22 +89,25 @@ Orbital::Orbital(int l, int m) :
 		);
 	}
 
-	CreateVAO();
 	UpdateModel();
 
 	// modelMatrix = glm::rotate(modelMatrix, glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
 	modelMatrix = glm::scale(modelMatrix, glm::vec3(3.0f));
 }
 
-void Orbital::BindDefaultShader(Camera& camera)
+Orbital::~Orbital()
+{
+}
+
+void Orbital::BindDefaultShader()
 {
 	defaultShader->Bind();
 	defaultShader->SetMatrix("model", glm::value_ptr(modelMatrix));
-	defaultShader->SetMatrix("view", glm::value_ptr(camera.GetViewMatrix()));
-	defaultShader->SetMatrix("projection", glm::value_ptr(camera.GetProjectionMatrix()));
 
 	defaultShader->SetVector3("positiveColor", glm::value_ptr(positiveColor));
 	defaultShader->SetVector3("negativeColor", glm::value_ptr(negativeColor));
+
+	defaultShader->SetUnsignedInt("resolution", IsAnimating() ? streamingMesh->GetResolution() : GetDrawnMesh()->GetResolution());
 }
 
 float* Orbital::GetPositiveColorVPtr()
@@ -91,75 +120,316 @@ float* Orbital::GetNegativeColorVPtr()
 	return glm::value_ptr(negativeColor);
 }
 
+void Orbital::Draw()
+{
+	if (IsAnimating())
+	{
+		streamingMesh->SetEncoding(IndexBuffer::GetDefaultEncoding());
+		streamingMesh->Draw();
+		return;
+	}
+
+	GpuMesh* mesh = GetDrawnMesh();
+	mesh->SetEncoding(IndexBuffer::GetDefaultEncoding());
+	mesh->Draw();
+}
+
 void Orbital::UpdateModel()
 {
-	vertices.clear();
-	indices.clear();
+	CancelUpdate();
 
-	for (int ring = 0; ring <= resolution; ring++)
+	MeshParameters parameters = GetParameters();
+	std::shared_ptr<GpuMesh> gpuMesh;
+	if (!FindCached(parameters, gpuMesh))
 	{
-		for (int vertex = 0; vertex < resolution; vertex++)
+		std::shared_ptr<OrbitalMesh> mesh = (parameters.expansion != nullptr) ?
+			std::make_shared<OrbitalMesh>(parameters.expansion, resolution, vertexFormat) :
+			std::make_shared<OrbitalMesh>(l, m, resolution, vertexFormat, meshType);
+
+		mesh->basis = expansionBasis;
+		mesh->Generate(&ThreadPool::GetDefault());
+
+		SetMesh(mesh);
+		return;
+	}
+
+	SetFront(gpuMesh, parameters);
+}
+
+void Orbital::SetMesh(const std::shared_ptr<const OrbitalMesh>& mesh)
+{
+	CancelUpdate();
+
+	superposition = (mesh->expansion != nullptr);
+	if (superposition)
+	{
+		expansion = *mesh->expansion;
+		expansionBasis = mesh->basis;
+	}
+	else
+	{
+		l = mesh->l;
+		m = mesh->m;
+	}
+
+	resolution = mesh->resolution;
+	vertexFormat = mesh->format;
+	meshType = mesh->type;
+
+	std::shared_ptr<GpuMesh> gpuMesh = std::make_shared<GpuMesh>();
+	gpuMesh->Upload(*mesh);
+
+	InsertCached(mesh, gpuMesh);
+	SetFront(gpuMesh, { mesh->l, mesh->m, resolution, vertexFormat, meshType, mesh->expansion });
+}
+
+void Orbital::RequestUpdate()
+{
+	CancelUpdate();
+	backParameters = GetParameters();
+
+	// A cached mesh only has to be bound
+	std::shared_ptr<GpuMesh> gpuMesh;
+	if (FindCached(backParameters, gpuMesh))
+	{
+		back = gpuMesh;
+		backPending = true;
+		Poll();
+		return;
+	}
+
+	StartJob(job, backParameters);
+}
+
+void Orbital::CancelUpdate()
+{
+	// A back mesh still waiting for its upload belongs to the old settings too
+	job.Cancel();
+	back = nullptr;
+	backPending = false;
+}
+
+bool Orbital::IsUpdating() const
+{
+	return job.IsRunning() || backPending;
+}
+
+void Orbital::Poll()
+{
+	std::unique_ptr<OrbitalMesh> generated;
+	if (job.Poll(generated))
+	{
+		std::shared_ptr<OrbitalMesh> mesh = std::move(generated);
+		if (mesh != nullptr)
 		{
-			float phi = vertex * TWO_PI / resolution;
-			float theta = ring * PI / resolution;
+			back = std::make_shared<GpuMesh>();
+			back->Upload(*mesh);
+			backPending = true;
 
-			std::complex value = SphericalHarmonic(l, std::abs(m), theta, phi);
-			
-			double distance = 0.0f;
-			if(m < 0)
-				distance = std::abs(std::imag(value));
-			else 
-				distance = std::abs(std::real(value));
-
-			vertices.push_back(distance * std::cos(phi) * std::sin(theta));
-			vertices.push_back(distance * std::sin(phi) * std::sin(theta));
-			vertices.push_back(distance * std::cos(theta));
-
-			if (m < 0)
-				vertices.push_back(std::imag(value) >= 0);
-			else
-				vertices.push_back(std::real(value) >= 0);
-			
+			if (mesh->basis != nullptr)
+				expansionBasis = mesh->basis;
+
+			InsertCached(mesh, back);
 		}
 	}
 
-	for (int ring = 0; ring < resolution; ring++)
+	if (backPending && back->IsReady())
 	{
-		for (int vertex = 0; vertex < resolution; vertex++)
-		{
-			indices.push_back(resolution * ring + vertex);
-			indices.push_back(resolution * ring + ((vertex + 1) % resolution));
-			indices.push_back(resolution * (ring + 1) + ((vertex + 1) % resolution));
+		SetFront(back, backParameters);
+		back = nullptr;
+		backPending = false;
+	}
+
+	for (DetailLevel& detail : levels)
+	{
+		if (!detail.job.Poll(generated))
+			continue;
 
-			indices.push_back(resolution * ring + vertex);
-			indices.push_back(resolution * (ring + 1) + ((vertex + 1) % resolution));
-			indices.push_back(resolution * (ring + 1) + vertex);
+		std::shared_ptr<OrbitalMesh> mesh = std::move(generated);
+		if (mesh != nullptr)
+		{
+			detail.mesh = std::make_shared<GpuMesh>();
+			detail.mesh->Upload(*mesh);
+			InsertCached(mesh, detail.mesh);
 		}
 	}
+}
+
+void Orbital::SelectLevel(Camera& camera, float viewportHeight)
+{
+	if (!levelOfDetail)
+	{
+		level = 0;
+		return;
+	}
+
+	// The largest lobe has |Y| = sqrt((2l + 1) / 4pi) at most, then it's up to the model matrix
+	// (l is the maxL of a superposition, which can reach a bit further than that)
+	float scale = std::max({ glm::length(glm::vec3(modelMatrix[0])), glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2])) });
+	float radius = (float)std::sqrt((2.0 * frontParameters.l + 1.0) / FOUR_PI) * scale;
 
-	UpdateBufferData();
+	float diameter = LevelOfDetail::GetProjectedDiameter(camera, glm::vec3(modelMatrix[3]), radius, viewportHeight);
+	level = LevelOfDetail::SelectLevel(frontParameters.resolution, frontParameters.l, diameter, level);
+	RequestLevel(level);
 }
 
-void Orbital::DefineVAOLayout()
+unsigned int Orbital::GetLevelResolution() const
 {
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float) + 1 * sizeof(unsigned int), (void*)0);
-	glEnableVertexAttribArray(0);
+	return LevelOfDetail::GetResolution(frontParameters.resolution, level);
+}
 
-	glVertexAttribIPointer(1, 1, GL_UNSIGNED_INT, 3 * sizeof(float) + 1 * sizeof(unsigned int), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
+Orbital::MeshParameters Orbital::GetParameters() const
+{
+	if (superposition)
+	{
+		std::shared_ptr<const HarmonicExpansion> copy = std::make_shared<HarmonicExpansion>(expansion);
+		return { copy->GetMaxL(), 0, resolution, vertexFormat, MeshType::Grid, copy };
+	}
+
+	return { l, m, resolution, vertexFormat, meshType, nullptr };
 }
 
-std::complex<double> SphericalHarmonic(unsigned int l, unsigned int m, float theta, float phi)
+bool Orbital::FindCached(const MeshParameters& parameters, std::shared_ptr<GpuMesh>& gpuMesh, bool count) const
 {
-	float N = std::sqrt((2 * l + 1) / 2.0f * Fac(l - m) / Fac(l + m));
-	return std::complex(1.0 / std::sqrt(TWO_PI) * N * std::assoc_legendre(l, m, std::cos(theta)), 0.0) * std::exp(std::complex(0.0, m * (double)phi));
+	if (parameters.expansion != nullptr)
+		return false;
+
+	MeshCache::Entry entry;
+	if (cache != nullptr && cache->Find(parameters.l, parameters.m, parameters.resolution, parameters.format, parameters.type, entry, count))
+	{
+		gpuMesh = entry.gpuMesh;
+		return true;
+	}
+
+	// The mapped radii go to the GPU as they are, touching them is all the loading there is
+	size_t byteSize;
+	const void* radii = (archive != nullptr && parameters.type == MeshType::Grid) ?
+		archive->Find(parameters.l, parameters.m, parameters.resolution, parameters.format, byteSize) : nullptr;
+	if (radii == nullptr)
+		return false;
+
+	gpuMesh = std::make_shared<GpuMesh>();
+	gpuMesh->Upload(radii, byteSize, parameters.format, parameters.resolution);
+
+	if (cache != nullptr)
+		cache->Insert(parameters.l, parameters.m, parameters.resolution, parameters.format, parameters.type, byteSize, gpuMesh);
+
+	return true;
+}
+
+void Orbital::InsertCached(const std::shared_ptr<const OrbitalMesh>& mesh, const std::shared_ptr<GpuMesh>& gpuMesh)
+{
+	if (cache != nullptr && mesh->expansion == nullptr)
+		cache->Insert({ mesh, gpuMesh });
 }
 
-unsigned int Fac(unsigned int n)
+void Orbital::Animate(float frametime)
 {
-	unsigned int prod = 1;
-	for (int i = 2; i <= n; i++)
-		prod *= i;
+	if (!animate || frontParameters.expansion == nullptr)
+	{
+		streamingMesh.reset();
+		return;
+	}
+
+	animationTime += frametime;
+
+	// Animates whatever superposition is on display, not what's being edited
+	const HarmonicExpansion& source = *frontParameters.expansion;
+	unsigned int resolution = frontParameters.resolution;
+
+	if (streamingMesh == nullptr || streamingMesh->GetResolution() != resolution)
+		streamingMesh = std::make_unique<StreamingMesh>(resolution);
+
+	if (expansionBasis == nullptr || expansionBasis->GetMaxL() != source.GetMaxL() || expansionBasis->GetResolution() != resolution)
+		expansionBasis = ExpansionBasis::GetShared(source.GetMaxL(), resolution);
+
+	// Copying into the same expansion every frame reuses its storage
+	animatedExpansion = source;
+	animatedExpansion.Evolve(animationTime, energyScale);
+	animatedExpansion.RotateZ(animationTime * rotationSpeed);
+
+	// Without a mapping there's nothing to animate into, the still mesh is drawn instead
+	float* radii = streamingMesh->Map();
+	if (radii == nullptr)
+	{
+		animate = false;
+		streamingMesh.reset();
+		return;
+	}
+
+	ExpansionGrid grid(*expansionBasis, animatedExpansion);
+
+	// Straight into the mapped buffer, the bands write disjoint ranges
+	ThreadPool& pool = ThreadPool::GetDefault();
+	unsigned int ringCount = grid.GetRingCount();
+	unsigned int ringsPerBand = (ringCount + pool.GetThreadCount()) / (pool.GetThreadCount() + 1);
+	size_t bandCount = (ringCount + ringsPerBand - 1) / ringsPerBand;
+
+	pool.ParallelFor(bandCount, [&](size_t band)
+	{
+		unsigned int firstRing = band * ringsPerBand;
+		unsigned int lastRing = std::min(firstRing + ringsPerBand, ringCount);
+		grid.FillValues(firstRing, lastRing, radii + (size_t)firstRing * resolution, [](double value) { return (float)value; });
+	});
+}
+
+bool Orbital::IsAnimating() const
+{
+	return streamingMesh != nullptr;
+}
+
+void Orbital::StartJob(BackgroundJob<std::unique_ptr<OrbitalMesh>>& job, const MeshParameters& parameters)
+{
+	std::shared_ptr<const ExpansionBasis> basis = expansionBasis;
+	job.Start([parameters, basis](const std::atomic<bool>* cancelled)
+	{
+		std::unique_ptr<OrbitalMesh> mesh = (parameters.expansion != nullptr) ?
+			std::make_unique<OrbitalMesh>(parameters.expansion, parameters.resolution, parameters.format) :
+			std::make_unique<OrbitalMesh>(parameters.l, parameters.m, parameters.resolution, parameters.format, parameters.type);
+
+		// Only reused if it fits
+		mesh->basis = basis;
+		if (!mesh->Generate(&ThreadPool::GetDefault(), cancelled))
+			mesh.reset();
+
+		return mesh;
+	});
+}
+
+void Orbital::SetFront(const std::shared_ptr<GpuMesh>& mesh, const MeshParameters& parameters)
+{
+	front = mesh;
+	frontParameters = parameters;
+
+	// The old levels belong to a different harmonic (or resolution), clearing them cancels their jobs
+	levels.clear();
+	levels.resize(LevelOfDetail::GetLevelCount(parameters.resolution, parameters.l));
+	level = std::min<unsigned int>(level, (unsigned int)levels.size() - 1);
+}
+
+void Orbital::RequestLevel(unsigned int level)
+{
+	DetailLevel& detail = levels[level];
+	if (level == 0 || detail.mesh != nullptr || detail.job.IsRunning())
+		return;
+
+	MeshParameters parameters = frontParameters;
+	parameters.resolution = LevelOfDetail::GetResolution(frontParameters.resolution, level);
+
+	if (FindCached(parameters, detail.mesh, false))
+		return;
+
+	StartJob(detail.job, parameters);
+}
+
+GpuMesh* Orbital::GetDrawnMesh()
+{
+	// The closest level that has arrived, the front mesh always has
+	for (unsigned int i = level; i > 0; i--)
+	{
+		if (levels[i].mesh != nullptr && levels[i].mesh->IsReady())
+			return levels[i].mesh.get();
+	}
 
-	return prod;
+	return front.get();
 }
@@ -1,28 +1,136 @@
 #pragma once
 
-#include "Model.hpp"
+#include <memory>
+#include <vector>
+
+#include <glm/matrix.hpp>
+
+#include "BackgroundJob.hpp"
+#include "HarmonicExpansion.hpp"
+#include "OrbitalMesh.hpp"
 
 class Shader;
+class GpuMesh;
+class MeshCache;
+class MeshArchive;
 class Camera;
+class ExpansionBasis;
+class StreamingMesh;
 
-class Orbital : public Model
+class Orbital
 {
 public:
-	Orbital(int l, int m);
+	// Grid meshes that aren't in the cache are taken from the archive if it has them, instead of being generated
+	Orbital(int l, int m, MeshCache* cache = nullptr, const MeshArchive* archive = nullptr);
+	~Orbital();
+
+	// The camera comes from the CameraUniformBuffer
+	void BindDefaultShader();
+	void Draw();
 
-	void BindDefaultShader(Camera& camera);
 	float* GetPositiveColorVPtr();
 	float* GetNegativeColorVPtr();
+
+	// Regenerates the mesh right away and blocks until it's done
 	void UpdateModel();
 
-private:
-	void DefineVAOLayout() final override;
+	// Uploads and displays a mesh that was generated elsewhere, takes over its l, m (or expansion), resolution, format and type
+	void SetMesh(const std::shared_ptr<const OrbitalMesh>& mesh);
+
+	// Regenerates the mesh in the background (unless it's in the cache). The current mesh
+	// keeps being drawn until the new one has been generated and uploaded
+	void RequestUpdate();
+	void CancelUpdate();
+	bool IsUpdating() const;
+
+	// Has to be called once per frame, picks up finished meshes and swaps them in
+	void Poll();
+
+	// Picks the detail level to draw from the orbital's size on screen, before BindDefaultShader().
+	// Coarser levels are generated in the background the first time they're picked, until then
+	// the closest finer level that's there gets drawn
+	void SelectLevel(Camera& camera, float viewportHeight);
+	unsigned int GetLevel() const { return level; }
+	unsigned int GetLevelCount() const { return (unsigned int)levels.size(); }
+	unsigned int GetLevelResolution() const;
+
+	// Advances the animation of the displayed superposition and writes this frame's radii,
+	// before BindDefaultShader(). Does nothing unless animate is set
+	void Animate(float frametime);
+	bool IsAnimating() const;
 
 public:
 	glm::vec3 positiveColor, negativeColor;
 	int l, m;
 	unsigned int resolution;
+	VertexFormat vertexFormat;
+	MeshType meshType;
+
+	// Shows the expansion instead of (l, m). Only on the grid, meshType is ignored meanwhile
+	bool superposition;
+	HarmonicExpansion expansion;
+
+	// Every l of the superposition turns with the stationary phase e^(-i E_l t), E_l = energyScale * l(l + 1),
+	// and the whole thing spins about z with rotationSpeed (radians per second). Animations are always drawn
+	// at the full resolution, the radii are recomputed from the cached basis every frame
+	bool animate;
+	float energyScale, rotationSpeed;
+
+	bool levelOfDetail;
 
 private:
+	// What the front mesh was generated from, its detail levels are generated from the same
+	struct MeshParameters
+	{
+		int l, m;
+		unsigned int resolution;
+		VertexFormat format;
+		MeshType type;
+
+		std::shared_ptr<const HarmonicExpansion> expansion;
+	};
+
+	// Level 0 is the front mesh itself, so the first entry stays empty
+	struct DetailLevel
+	{
+		std::shared_ptr<GpuMesh> mesh;
+		BackgroundJob<std::unique_ptr<OrbitalMesh>> job;
+	};
+
+	MeshParameters GetParameters() const;
+
+	// Superpositions change too often to be worth caching. Whatever isn't cached is uploaded straight from the archive if
+	// it's there, and cached from then on
+	// Detail levels don't count towards the cache's hits and misses, the front mesh already did
+	bool FindCached(const MeshParameters& parameters, std::shared_ptr<GpuMesh>& gpuMesh, bool count = true) const;
+	void InsertCached(const std::shared_ptr<const OrbitalMesh>& mesh, const std::shared_ptr<GpuMesh>& gpuMesh);
+
+	void StartJob(BackgroundJob<std::unique_ptr<OrbitalMesh>>& job, const MeshParameters& parameters);
+	void SetFront(const std::shared_ptr<GpuMesh>& mesh, const MeshParameters& parameters);
+	void RequestLevel(unsigned int level);
+	GpuMesh* GetDrawnMesh();
+
+	glm::mat4 modelMatrix;
+
+	// The front mesh is drawn, the back mesh is swapped in as soon as its upload is done
+	std::shared_ptr<GpuMesh> front, back;
+	MeshParameters frontParameters, backParameters;
+	bool backPending;
+
+	std::vector<DetailLevel> levels;
+	unsigned int level;
+
+	MeshCache* cache;
+	const MeshArchive* archive;
+
+	// The basis of the last superposition, so changing its coefficients only redoes the sums
+	std::shared_ptr<const ExpansionBasis> expansionBasis;
+
+	std::unique_ptr<StreamingMesh> streamingMesh;
+	HarmonicExpansion animatedExpansion;
+	double animationTime;
+
+	BackgroundJob<std::unique_ptr<OrbitalMesh>> job;
+
 	static Shader* defaultShader;
-};
\ No newline at end of file
+};
@@ -0,0 +1,301 @@
+#include "OrbitalGallery.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "Shader.hpp"
+#include "IndexBuffer.hpp"
+#include "LevelOfDetail.hpp"
+#include "MeshArchive.hpp"
+#include "OrbitalMesh.hpp"
+#include "ThreadPool.hpp"
+
+// Same layout as the glMultiDrawElementsIndirect spec wants it
+struct DrawElementsIndirectCommand
+{
+	unsigned int count;
+	unsigned int instanceCount;
+	unsigned int firstIndex;
+	int baseVertex;
+	unsigned int baseInstance;
+};
+
+Shader* OrbitalGallery::defaultShader = nullptr;
+
+OrbitalGallery::OrbitalGallery(int maxL, unsigned int resolution) :
+	maxL(maxL), resolution(resolution), spacing(2.5f), levelOfDetail(true), archive(nullptr),
+	transformSsbo(0), indirectBuffer(0), drawCount(0), builtMaxL(0), boundingRadius(0.0f)
+{
+	if (defaultShader == nullptr)
+	{
+		defaultShader = new Shader(
+			R"(
+			#version 460 core
+
+			layout(location = 0) in float radius;
+
+			out vec3 outColor;
+
+			layout(std140, binding = 0) uniform Camera
+			{
+				mat4 view;
+				mat4 projection;
+				mat4 viewProjection;
+				vec4 cameraPosition;
+			};
+
+			// One per orbital, the draw commands pass the orbital's index as their base instance
+			layout(std430, binding = 1) readonly buffer Transforms
+			{
+				mat4 transforms[];
+			};
+
+			uniform vec3 positiveColor;
+			uniform vec3 negativeColor;
+			uniform uint resolution;
+
+			const float PI = 3.14159265359f;
+
+			void main()
+			{
+				// gl_VertexID includes the base vertex, i.e. where this orbital starts in the shared buffer
+				uint vertex = uint(gl_VertexID - gl_BaseVertex);
+				uint ring = vertex / resolution;
+				uint column = vertex % resolution;
+
+				float theta = float(ring) * PI / float(resolution);
+				float phi = float(column) * 2.0f * PI / float(resolution);
+				vec3 direction = vec3(sin(theta) * cos(phi), sin(theta) * sin(phi), cos(theta));
+
+				outColor = (radius >= 0.0f) ? positiveColor : negativeColor;
+				gl_Position = viewProjection * transforms[gl_BaseInstance] * vec4(abs(radius) * direction, 1.0f);
+			}	
+		)",
+
+			R"(
+			#version 460 core
+			
+			in vec3 outColor;
+			out vec4 FragColor;
+
+			void main()
+			{	
+				FragColor = vec4(outColor, 1.0f);
+			}
+		)"
+		);
+	}
+
+	glGenBuffers(1, &transformSsbo);
+	glGenBuffers(1, &indirectBuffer);
+
+	UpdateModels();
+}
+
+OrbitalGallery::~OrbitalGallery()
+{
+	ReleaseLevels();
+
+	glDeleteBuffers(1, &indirectBuffer);
+	glDeleteBuffers(1, &transformSsbo);
+}
+
+bool OrbitalGallery::IsShaderReady() const
+{
+	return defaultShader->IsReady();
+}
+
+void OrbitalGallery::BindDefaultShader(const glm::vec3& positiveColor, const glm::vec3& negativeColor)
+{
+	defaultShader->Bind();
+	defaultShader->SetVector3("positiveColor", glm::value_ptr(positiveColor));
+	defaultShader->SetVector3("negativeColor", glm::value_ptr(negativeColor));
+}
+
+void OrbitalGallery::Draw()
+{
+	if (drawCount == 0)
+		return;
+
+	// The commands are grouped by level, each group is one multi draw
+	std::vector<DrawElementsIndirectCommand> commands;
+	commands.reserve(drawCount);
+	std::vector<size_t> firstCommand(levels.size() + 1, 0);
+	for (unsigned int level = 0; level < levels.size(); level++)
+	{
+		firstCommand[level] = commands.size();
+
+		DetailLevel& detail = levels[level];
+		if (detail.vao == 0)
+			continue;
+
+		if (detail.indexBuffer->GetEncoding() != IndexBuffer::GetDefaultEncoding())
+			SetEncoding(detail, IndexBuffer::GetDefaultEncoding());
+
+		size_t vertexCount = (size_t)(detail.resolution + 1) * detail.resolution;
+		for (unsigned int i = 0; i < drawCount; i++)
+		{
+			if (orbitalLevels[i] == level)
+				commands.push_back({ (unsigned int)detail.indexBuffer->GetCount(), 1, 0, (int)(i * vertexCount), i });
+		}
+	}
+	firstCommand[levels.size()] = commands.size();
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data(), GL_STREAM_DRAW);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, transformSsbo);
+
+	for (unsigned int level = 0; level < levels.size(); level++)
+	{
+		unsigned int count = (unsigned int)(firstCommand[level + 1] - firstCommand[level]);
+		if (count == 0)
+			continue;
+
+		defaultShader->SetUnsignedInt("resolution", levels[level].resolution);
+
+		glBindVertexArray(levels[level].vao);
+		levels[level].indexBuffer->MultiDrawIndirect(count, firstCommand[level] * sizeof(DrawElementsIndirectCommand));
+	}
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+void OrbitalGallery::SelectLevels(Camera& camera, float viewportHeight)
+{
+	for (unsigned int i = 0; i < drawCount; i++)
+	{
+		// Every orbital of a level shares its resolution, which has to suit the largest l of them all
+		unsigned int level = 0;
+		if (levelOfDetail)
+		{
+			float diameter = LevelOfDetail::GetProjectedDiameter(camera, centers[i], boundingRadius, viewportHeight);
+			level = LevelOfDetail::SelectLevel(levels[0].resolution, builtMaxL, diameter, orbitalLevels[i]);
+		}
+
+		if (levels[level].vao == 0)
+			BuildLevel(level, nullptr);
+
+		orbitalLevels[i] = level;
+	}
+}
+
+unsigned int OrbitalGallery::GetOrbitalsAtLevel(unsigned int level) const
+{
+	return (unsigned int)std::count(orbitalLevels.begin(), orbitalLevels.end(), level);
+}
+
+void OrbitalGallery::UpdateModels()
+{
+	ReleaseLevels();
+
+	builtMaxL = maxL;
+	drawCount = GetOrbitalCount();
+	levels.resize(LevelOfDetail::GetLevelCount(resolution, maxL), { 0, 0, 0, nullptr });
+	orbitalLevels.assign(drawCount, 0);
+
+	std::vector<float> maxRadius;
+	BuildLevel(0, &maxRadius);
+
+	// Every orbital is scaled to fill its cell, higher l would get bigger and bigger otherwise
+	boundingRadius = 0.45f * spacing;
+	centers.resize(drawCount);
+	std::vector<glm::mat4> transforms(drawCount);
+	for (unsigned int i = 0; i < drawCount; i++)
+	{
+		int l = (int)std::sqrt((double)i);
+		int m = (int)i - l * l - l;
+
+		centers[i] = glm::vec3(m * spacing, -l * spacing, 0.0f);
+		float scale = (maxRadius[i] > 0.0f) ? boundingRadius / maxRadius[i] : 1.0f;
+		transforms[i] = glm::scale(glm::translate(glm::mat4(1.0f), centers[i]), glm::vec3(scale));
+	}
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, transformSsbo);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, transforms.size() * sizeof(glm::mat4), transforms.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void OrbitalGallery::BuildLevel(unsigned int level, std::vector<float>* maxRadius)
+{
+	DetailLevel& detail = levels[level];
+	detail.resolution = (level == 0) ? resolution : LevelOfDetail::GetResolution(levels[0].resolution, level);
+
+	unsigned int levelResolution = detail.resolution;
+	size_t vertexCount = (size_t)(levelResolution + 1) * levelResolution;
+
+	// Orbital i is (l, m) with i = l^2 + l + m, so every row is one l
+	std::vector<float> radii(drawCount * vertexCount);
+	if (maxRadius != nullptr)
+		maxRadius->resize(drawCount);
+
+	ThreadPool::GetDefault().ParallelFor(drawCount, [&](size_t i)
+	{
+		int l = (int)std::sqrt((double)i);
+		int m = (int)i - l * l - l;
+
+		float* out = radii.data() + i * vertexCount;
+
+		size_t byteSize;
+		const void* archived = (archive != nullptr) ? archive->Find(l, m, levelResolution, VertexFormat::Float, byteSize) : nullptr;
+		if (archived != nullptr)
+		{
+			std::copy_n((const float*)archived, vertexCount, out);
+		}
+		else
+		{
+			OrbitalMesh mesh(l, m, levelResolution);
+			mesh.Generate();
+
+			std::copy(mesh.radii.begin(), mesh.radii.end(), out);
+		}
+
+		if (maxRadius != nullptr)
+		{
+			(*maxRadius)[i] = 0.0f;
+			for (size_t vertex = 0; vertex < vertexCount; vertex++)
+				(*maxRadius)[i] = std::max((*maxRadius)[i], std::abs(out[vertex]));
+		}
+	});
+
+	glGenVertexArrays(1, &detail.vao);
+	glGenBuffers(1, &detail.vbo);
+
+	glBindVertexArray(detail.vao);
+	glBindBuffer(GL_ARRAY_BUFFER, detail.vbo);
+	glBufferData(GL_ARRAY_BUFFER, radii.size() * sizeof(float), radii.data(), GL_STATIC_DRAW);
+	glVertexAttribPointer(0, 1, GL_FLOAT, GL_FALSE, 0, (void*)0);
+	glEnableVertexAttribArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+
+	SetEncoding(detail, IndexBuffer::GetDefaultEncoding());
+}
+
+void OrbitalGallery::SetEncoding(DetailLevel& detail, IndexEncoding encoding)
+{
+	detail.indexBuffer = IndexBuffer::GetShared(detail.resolution, encoding);
+
+	glBindVertexArray(detail.vao);
+	detail.indexBuffer->Bind();
+	glBindVertexArray(0);
+}
+
+void OrbitalGallery::ReleaseLevels()
+{
+	for (DetailLevel& detail : levels)
+	{
+		if (detail.vao == 0)
+			continue;
+
+		glDeleteBuffers(1, &detail.vbo);
+		glDeleteVertexArrays(1, &detail.vao);
+	}
+
+	levels.clear();
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <glm/vec3.hpp>
+
+#include "GridIndices.hpp"
+
+class Shader;
+class IndexBuffer;
+class Camera;
+class MeshArchive;
+
+// Every orbital with l <= maxL side by side, one row per l and one column per m.
+// All of them have the same resolution, so their radii go into one big vertex buffer and they share an
+// index buffer. Each draw command offsets into the vertex buffer with its base vertex and picks its
+// transform from a storage buffer by its base instance.
+//
+// Every orbital is drawn at its own detail level (see LevelOfDetail). A level holds all orbitals at its
+// resolution, so the gallery takes one glMultiDrawElementsIndirect per level that's in use.
+class OrbitalGallery
+{
+public:
+	OrbitalGallery(int maxL, unsigned int resolution);
+	~OrbitalGallery();
+
+	OrbitalGallery(const OrbitalGallery&) = delete;
+	OrbitalGallery& operator=(const OrbitalGallery&) = delete;
+
+	// False while the shader is still being compiled in the background, binding it would wait for it
+	bool IsShaderReady() const;
+
+	// The camera comes from the CameraUniformBuffer
+	void BindDefaultShader(const glm::vec3& positiveColor, const glm::vec3& negativeColor);
+	void Draw();
+
+	// Picks every orbital's detail level from its size on screen. Levels picked for the first time are
+	// generated right away, they're a fraction of the size of the full one
+	void SelectLevels(Camera& camera, float viewportHeight);
+	unsigned int GetLevelCount() const { return (unsigned int)levels.size(); }
+	unsigned int GetOrbitalsAtLevel(unsigned int level) const;
+
+	// Regenerates all meshes with the current maxL and resolution (blocks until done)
+	void UpdateModels();
+
+	unsigned int GetOrbitalCount() const { return (maxL + 1) * (maxL + 1); }
+
+public:
+	int maxL;
+	unsigned int resolution;
+	float spacing;
+	bool levelOfDetail;
+
+	// Orbitals that are in here are copied out of it instead of generated
+	const MeshArchive* archive;
+
+private:
+	// All orbitals at one resolution, vao is 0 until the level is built
+	struct DetailLevel
+	{
+		unsigned int vao, vbo;
+		unsigned int resolution;
+		std::shared_ptr<IndexBuffer> indexBuffer;
+	};
+
+	// Also fills in the largest radius of every orbital if asked
+	void BuildLevel(unsigned int level, std::vector<float>* maxRadius);
+	void SetEncoding(DetailLevel& detail, IndexEncoding encoding);
+	void ReleaseLevels();
+
+private:
+	unsigned int transformSsbo, indirectBuffer;
+	unsigned int drawCount, builtMaxL;
+
+	std::vector<DetailLevel> levels;
+	std::vector<unsigned int> orbitalLevels;
+
+	// Where every orbital is, and the radius it's scaled to
+	std::vector<glm::vec3> centers;
+	float boundingRadius;
+
+	static Shader* defaultShader;
+};
@@ -0,0 +1,201 @@
+#include "OrbitalMesh.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#include "AdaptiveMesher.hpp"
+#include "ExpansionGrid.hpp"
+#include "HarmonicExpansion.hpp"
+#include "HarmonicGrid.hpp"
+#include "SphereSampling.hpp"
+#include "ThreadPool.hpp"
+
+OrbitalMesh::OrbitalMesh(int l, int m, unsigned int resolution, VertexFormat format, MeshType type) :
+	l(l), m(m), resolution(resolution), format(format), type(type)
+{
+}
+
+OrbitalMesh::OrbitalMesh(const std::shared_ptr<const HarmonicExpansion>& expansion, unsigned int resolution, VertexFormat format) :
+	l(expansion->GetMaxL()), m(0), resolution(resolution), format(format), type(MeshType::Grid), expansion(expansion)
+{
+}
+
+bool OrbitalMesh::Generate(ThreadPool* pool, const std::atomic<bool>* cancelled)
+{
+	if (type != MeshType::Grid)
+	{
+		if (type == MeshType::Adaptive)
+		{
+			AdaptiveMesher mesher(l, m, AdaptiveMesher::GetTolerance(l, resolution));
+			if (!mesher.Generate(pool, cancelled))
+				return false;
+
+			// Smooth harmonics (low l) need fine triangles everywhere, then the grid is the smaller mesh
+			if (mesher.indices.size() > 6 * (size_t)resolution * resolution)
+				return GenerateGrid(HarmonicGrid(l, m, resolution), pool, cancelled);
+
+			sampling = std::make_shared<SphereSampling>(std::move(mesher.directions), std::move(mesher.indices));
+			radii = std::move(mesher.radii);
+		}
+		else
+		{
+			sampling = SphereSampling::GetShared((type == MeshType::Healpix) ? SamplingScheme::Healpix : SamplingScheme::Icosphere, resolution);
+			radii.resize(sampling->GetVertexCount());
+			if (!sampling->Evaluate(l, m, radii.data(), pool, cancelled))
+				return false;
+		}
+
+		if (format == VertexFormat::Half)
+		{
+			halfRadii.resize(radii.size());
+			std::transform(radii.begin(), radii.end(), halfRadii.begin(), FloatToHalf);
+			radii = std::vector<float>();
+		}
+
+		return true;
+	}
+
+	if (expansion != nullptr)
+	{
+		if (basis == nullptr || basis->GetMaxL() != l || basis->GetResolution() != resolution)
+			basis = ExpansionBasis::GetShared(l, resolution);
+
+		return GenerateGrid(ExpansionGrid(*basis, *expansion), pool, cancelled);
+	}
+
+	return GenerateGrid(HarmonicGrid(l, m, resolution), pool, cancelled);
+}
+
+template<typename Grid>
+bool OrbitalMesh::GenerateGrid(const Grid& grid, ThreadPool* pool, const std::atomic<bool>* cancelled)
+{
+	unsigned int ringCount = grid.GetRingCount();
+
+	if (format == VertexFormat::Half)
+		halfRadii.resize(grid.GetVertexCount());
+	else
+		radii.resize(grid.GetVertexCount());
+
+	auto generateBand = [&](unsigned int firstRing, unsigned int lastRing)
+	{
+		if (cancelled != nullptr && *cancelled)
+			return;
+
+		size_t first = (size_t)firstRing * resolution;
+		if (format == VertexFormat::Half)
+			grid.FillValues(firstRing, lastRing, halfRadii.data() + first, [](double value) { return FloatToHalf((float)value); });
+		else
+			grid.FillValues(firstRing, lastRing, radii.data() + first, [](double value) { return (float)value; });
+	};
+
+	if (pool == nullptr)
+	{
+		generateBand(0, ringCount);
+		return (cancelled == nullptr || !*cancelled);
+	}
+
+	// A few bands per thread keeps everyone busy without making the bands tiny
+	size_t bandCount = std::min<size_t>(ringCount, 4 * ((size_t)pool->GetThreadCount() + 1));
+	unsigned int ringsPerBand = (ringCount + bandCount - 1) / bandCount;
+	bandCount = (ringCount + ringsPerBand - 1) / ringsPerBand;
+
+	pool->ParallelFor(bandCount, [&](size_t band)
+	{
+		unsigned int firstRing = band * ringsPerBand;
+		generateBand(firstRing, std::min(firstRing + ringsPerBand, ringCount));
+	});
+
+	return (cancelled == nullptr || !*cancelled);
+}
+
+size_t OrbitalMesh::GetVertexCount() const
+{
+	if (sampling != nullptr)
+		return sampling->GetVertexCount();
+
+	return (size_t)(resolution + 1) * resolution;
+}
+
+float OrbitalMesh::GetRadius(size_t index) const
+{
+	return (format == VertexFormat::Half) ? HalfToFloat(halfRadii[index]) : radii[index];
+}
+
+const void* OrbitalMesh::GetVertexData() const
+{
+	return (format == VertexFormat::Half) ? (const void*)halfRadii.data() : (const void*)radii.data();
+}
+
+size_t OrbitalMesh::GetVertexByteSize() const
+{
+	return radii.size() * sizeof(float) + halfRadii.size() * sizeof(uint16_t);
+}
+
+size_t OrbitalMesh::GetByteSize() const
+{
+	// A shared sampling counts towards every mesh that uses it, which errs on the safe side
+	return GetVertexByteSize() + ((sampling != nullptr) ? sampling->GetByteSize() : 0);
+}
+
+uint16_t OrbitalMesh::FloatToHalf(float value)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+
+	uint32_t sign = (bits >> 16) & 0x8000;
+	int exponent = (int)((bits >> 23) & 0xff) - 127 + 15;
+	uint32_t mantissa = bits & 0x7fffff;
+
+	// Too large for a half (the radii never get there)
+	if (exponent >= 31)
+		return sign | 0x7c00;
+
+	// Denormals, or too small altogether
+	if (exponent <= 0)
+	{
+		if (exponent < -10)
+			return sign;
+
+		mantissa |= 0x800000;
+		uint32_t shift = 14 - exponent;
+		uint32_t half = mantissa >> shift;
+		uint32_t rest = mantissa & ((1u << shift) - 1);
+		uint32_t halfway = 1u << (shift - 1);
+		if (rest > halfway || (rest == halfway && (half & 1)))
+			half++;
+
+		return sign | half;
+	}
+
+	// Round to nearest even, a carry out of the mantissa correctly bumps the exponent
+	uint32_t half = ((uint32_t)exponent << 10) | (mantissa >> 13);
+	uint32_t rest = mantissa & 0x1fff;
+	if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+		half++;
+
+	return sign | half;
+}
+
+float OrbitalMesh::HalfToFloat(uint16_t value)
+{
+	uint32_t sign = (uint32_t)(value & 0x8000) << 16;
+	uint32_t exponent = (value >> 10) & 0x1f;
+	uint32_t mantissa = value & 0x3ff;
+
+	uint32_t bits;
+	if (exponent == 0)
+	{
+		// Denormals are exactly representable as normal floats
+		float magnitude = mantissa / 16777216.0f;
+		std::memcpy(&bits, &magnitude, sizeof(bits));
+		bits |= sign;
+	}
+	else if (exponent == 31)
+		bits = sign | 0x7f800000 | (mantissa << 13);
+	else
+		bits = sign | ((exponent - 15 + 127) << 23) | (mantissa << 13);
+
+	float result;
+	std::memcpy(&result, &bits, sizeof(result));
+	return result;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class ThreadPool;
+class SphereSampling;
+class HarmonicExpansion;
+class ExpansionBasis;
+
+enum class VertexFormat
+{
+	Float,		// 32 bit float radius
+	Half		// 16 bit float radius
+};
+
+enum class MeshType
+{
+	Grid,		// The regular theta/phi grid
+	Adaptive,	// Refined where the surface needs it, see AdaptiveMesher
+	Healpix,	// See SphereSampling
+	Icosphere
+};
+
+// The CPU side of an orbital's mesh: one signed radius per sample of the (resolution + 1) x resolution
+// theta/phi grid. Where a vertex sits on the sphere follows from its index, so the orbital shader
+// reconstructs the position (and the sign color) from gl_VertexID. The indices only depend on the
+// resolution and are shared between orbitals, see GridIndices.
+//
+// All other types have no such structure. They keep a SphereSampling, a unit direction per vertex and a triangle
+// list, next to the radii (the "sampled" layout). HEALPix and icosphere samplings are shared by every mesh of the
+// same resolution, adaptive meshes have one of their own and the resolution only picks the tolerance. An adaptive
+// mesh that would have more triangles than the grid at its resolution is generated as that grid instead.
+//
+// Instead of a single harmonic a grid mesh can also show a whole HarmonicExpansion (l is its maxL then, m is 0).
+class OrbitalMesh
+{
+public:
+	OrbitalMesh(int l, int m, unsigned int resolution, VertexFormat format = VertexFormat::Float, MeshType type = MeshType::Grid);
+	OrbitalMesh(const std::shared_ptr<const HarmonicExpansion>& expansion, unsigned int resolution, VertexFormat format = VertexFormat::Float);
+
+	// Fills the radii. With a pool the rings are split into bands that are generated in parallel,
+	// every band writes into its own slice of the presized array so the result is bit-identical either way.
+	// Bands that haven't started yet are skipped once cancelled is set, in that case this returns false.
+	bool Generate(ThreadPool* pool = nullptr, const std::atomic<bool>* cancelled = nullptr);
+
+	size_t GetVertexCount() const;
+	float GetRadius(size_t index) const;
+
+	// Raw vertex data in the respective format
+	const void* GetVertexData() const;
+	size_t GetVertexByteSize() const;
+
+	// All of the arrays together
+	size_t GetByteSize() const;
+
+	// Adaptive meshes that came out larger than the grid are grids, so this only says something after Generate()
+	bool IsSampled() const { return sampling != nullptr; }
+
+	static uint16_t FloatToHalf(float value);
+	static float HalfToFloat(uint16_t value);
+
+public:
+	int l, m;
+	unsigned int resolution;
+	VertexFormat format;
+	MeshType type;
+
+	std::vector<float> radii;			// VertexFormat::Float
+	std::vector<uint16_t> halfRadii;	// VertexFormat::Half
+
+	// Only for sampled meshes
+	std::shared_ptr<const SphereSampling> sampling;
+
+	// Only for expansions. The basis is the one the radii were summed over, whoever
+	// wants to generate more of the same expansion cheaply can hold on to it
+	std::shared_ptr<const HarmonicExpansion> expansion;
+	std::shared_ptr<const ExpansionBasis> basis;
+
+private:
+	template<typename Grid>
+	bool GenerateGrid(const Grid& grid, ThreadPool* pool, const std::atomic<bool>* cancelled);
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+
+// The counter based random number generator Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy
+// as 1, 2, 3"). Every counter maps to 4 random words through 10 rounds of multiplications and key mixing, there
+// is no state carried from one number to the next. So sample i can always use counter i, whichever thread
+// gets to it and in whatever order, and the results don't depend on how the work was split up.
+//
+// The full 128 bit counter and 64 bit key, as in the reference implementation (and its known answers)
+inline void Philox4x32(const uint32_t counter[4], const uint32_t key[2], uint32_t out[4])
+{
+	uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+	uint32_t k0 = key[0], k1 = key[1];
+
+	for (int round = 0; round < 10; round++)
+	{
+		uint64_t product0 = (uint64_t)0xD2511F53u * c0;
+		uint64_t product1 = (uint64_t)0xCD9E8D57u * c2;
+
+		uint32_t next0 = (uint32_t)(product1 >> 32) ^ c1 ^ k0;
+		uint32_t next1 = (uint32_t)product1;
+		uint32_t next2 = (uint32_t)(product0 >> 32) ^ c3 ^ k1;
+		uint32_t next3 = (uint32_t)product0;
+
+		c0 = next0;
+		c1 = next1;
+		c2 = next2;
+		c3 = next3;
+
+		// Weyl sequence increments of the key
+		k0 += 0x9E3779B9u;
+		k1 += 0xBB67AE85u;
+	}
+
+	out[0] = c0;
+	out[1] = c1;
+	out[2] = c2;
+	out[3] = c3;
+}
+
+// The upper half of the counter stays 0, 2^64 numbers are plenty
+inline void Philox4x32(uint64_t counter, uint64_t key, uint32_t out[4])
+{
+	const uint32_t fullCounter[4] = { (uint32_t)counter, (uint32_t)(counter >> 32), 0, 0 };
+	const uint32_t fullKey[2] = { (uint32_t)key, (uint32_t)(key >> 32) };
+	Philox4x32(fullCounter, fullKey, out);
+}
+
+// The top 24 bits as a float in [0, 1)
+inline float PhiloxToUnit(uint32_t word)
+{
+	return (word >> 8) * (1.0f / 16777216.0f);
+}
@@ -0,0 +1,240 @@
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+#include <glad/glad.h>
+
+static const float noValue = std::numeric_limits<float>::quiet_NaN();
+
+Profiler::Profiler(size_t historySize) :
+	enabled(true), historySize(historySize), frame(-1), pendingQueries(historySize, 0), currentStage(0)
+{
+	FindStage("Frame");
+}
+
+Profiler::~Profiler()
+{
+	for (Stage& stage : stages)
+	{
+		for (Query& query : stage.queries)
+		{
+			if (query.id != 0)
+				glDeleteQueries(1, &query.id);
+		}
+	}
+}
+
+void Profiler::BeginFrame()
+{
+	Clock::time_point now = Clock::now();
+	if (frame >= 0)
+		stages[0].cpu[frame % historySize] = std::chrono::duration<float, std::milli>(now - frameStart).count();
+
+	frameStart = now;
+	frame++;
+
+	CollectQueries(false);
+
+	// Anything that doesn't get measured this frame stays empty
+	size_t slot = frame % historySize;
+	for (Stage& stage : stages)
+	{
+		stage.cpu[slot] = noValue;
+		stage.gpu[slot] = noValue;
+	}
+
+	stages[0].gpu[slot] = enabled ? 0.0f : noValue;
+	pendingQueries[slot] = 0;
+}
+
+void Profiler::BeginStage(const char* name)
+{
+	if (!enabled || frame < 0)
+		return;
+
+	currentStage = FindStage(name);
+	Stage& stage = stages[currentStage];
+
+	// Reuse the oldest query, unless its result hasn't even arrived yet
+	stage.activeQuery = frame % queryRingSize;
+	Query& query = stage.queries[stage.activeQuery];
+	if (query.frame >= 0)
+		stage.activeQuery = -1;
+	else
+	{
+		if (query.id == 0)
+			glGenQueries(1, &query.id);
+
+		query.frame = frame;
+		pendingQueries[frame % historySize]++;
+		glBeginQuery(GL_TIME_ELAPSED, query.id);
+	}
+
+	stageStart = Clock::now();
+}
+
+void Profiler::EndStage()
+{
+	if (!enabled || frame < 0 || currentStage == 0)
+		return;
+
+	Stage& stage = stages[currentStage];
+	stage.cpu[frame % historySize] = std::chrono::duration<float, std::milli>(Clock::now() - stageStart).count();
+
+	if (stage.activeQuery >= 0)
+		glEndQuery(GL_TIME_ELAPSED);
+
+	currentStage = 0;
+}
+
+void Profiler::GetHistory(size_t stage, bool gpu, std::vector<float>& out) const
+{
+	const std::vector<float>& values = gpu ? stages[stage].gpu : stages[stage].cpu;
+	size_t count = GetFinishedFrameCount();
+
+	out.resize(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		long long sampleFrame = frame - (long long)count + (long long)i;
+		size_t slot = sampleFrame % historySize;
+
+		out[i] = values[slot];
+		if (gpu && stage == 0 && pendingQueries[slot] > 0)
+			out[i] = noValue;
+	}
+}
+
+Profiler::Statistics Profiler::GetStatistics(size_t stage, bool gpu) const
+{
+	std::vector<float> values;
+	GetHistory(stage, gpu, values);
+	values.erase(std::remove_if(values.begin(), values.end(), [](float value) { return std::isnan(value); }), values.end());
+
+	Statistics statistics = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, values.size() };
+	if (values.empty())
+		return statistics;
+
+	std::sort(values.begin(), values.end());
+
+	double sum = 0.0;
+	for (float value : values)
+		sum += value;
+
+	auto percentile = [&](double p) { return values[std::min(values.size() - 1, (size_t)(p * values.size()))]; };
+
+	statistics.average = (float)(sum / values.size());
+	statistics.p50 = percentile(0.50);
+	statistics.p95 = percentile(0.95);
+	statistics.p99 = percentile(0.99);
+	statistics.max = values.back();
+	return statistics;
+}
+
+bool Profiler::ExportCSV(const std::string& path) const
+{
+	std::ofstream file(path);
+	if (!file)
+	{
+		std::cerr << "Failed to open " << path << " for writing" << std::endl;
+		return false;
+	}
+
+	file << "frame,stage,cpu_ms,gpu_ms\n";
+
+	std::vector<std::vector<float>> cpu(stages.size()), gpu(stages.size());
+	for (size_t stage = 0; stage < stages.size(); stage++)
+	{
+		GetHistory(stage, false, cpu[stage]);
+		GetHistory(stage, true, gpu[stage]);
+	}
+
+	size_t count = GetFinishedFrameCount();
+	for (size_t i = 0; i < count; i++)
+	{
+		for (size_t stage = 0; stage < stages.size(); stage++)
+		{
+			file << frame - (long long)count + (long long)i << "," << stages[stage].name << ",";
+			if (!std::isnan(cpu[stage][i]))
+				file << cpu[stage][i];
+			file << ",";
+			if (!std::isnan(gpu[stage][i]))
+				file << gpu[stage][i];
+			file << "\n";
+		}
+	}
+
+	return (bool)file;
+}
+
+void Profiler::SetEnabled(bool enabled)
+{
+	// Whatever is still in flight has to arrive before the queries can be used again
+	if (!enabled && this->enabled)
+		CollectQueries(true);
+
+	this->enabled = enabled;
+}
+
+size_t Profiler::FindStage(const char* name)
+{
+	for (size_t i = 0; i < stages.size(); i++)
+	{
+		if (stages[i].name == name)
+			return i;
+	}
+
+	Stage stage;
+	stage.name = name;
+	stage.cpu.assign(historySize, noValue);
+	stage.gpu.assign(historySize, noValue);
+	for (Query& query : stage.queries)
+		query = { 0, -1 };
+	stage.activeQuery = -1;
+
+	stages.push_back(stage);
+	return stages.size() - 1;
+}
+
+void Profiler::CollectQueries(bool wait)
+{
+	for (Stage& stage : stages)
+	{
+		for (Query& query : stage.queries)
+		{
+			if (query.frame < 0)
+				continue;
+
+			if (!wait)
+			{
+				GLint available = 0;
+				glGetQueryObjectiv(query.id, GL_QUERY_RESULT_AVAILABLE, &available);
+				if (!available)
+					continue;
+			}
+
+			GLuint64 nanoseconds = 0;
+			glGetQueryObjectui64v(query.id, GL_QUERY_RESULT, &nanoseconds);
+
+			// Results older than the history have nowhere to go
+			if (frame - query.frame < (long long)historySize)
+			{
+				size_t slot = query.frame % historySize;
+				stage.gpu[slot] = nanoseconds / 1e6f;
+				stages[0].gpu[slot] += nanoseconds / 1e6f;
+				pendingQueries[slot]--;
+			}
+
+			query.frame = -1;
+		}
+	}
+}
+
+size_t Profiler::GetFinishedFrameCount() const
+{
+	return (size_t)std::min<long long>(std::max<long long>(frame, 0), (long long)historySize - 1);
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Times the stages of every frame, on the CPU with a steady clock and on the GPU with GL_TIME_ELAPSED queries.
+// The last few hundred frames are kept for plotting. GPU results come in a few frames late; every stage
+// has a small ring of queries so reading them never stalls the pipeline (if the GPU falls so far behind
+// that the ring is full, that frame just goes without GPU time).
+//
+// Stages can't be nested, GL_TIME_ELAPSED queries don't allow that.
+class Profiler
+{
+public:
+	struct Statistics
+	{
+		float average, p50, p95, p99, max;
+		size_t samples;
+	};
+
+	class Scope
+	{
+	public:
+		Scope(Profiler& profiler, const char* name) : profiler(profiler) { profiler.BeginStage(name); }
+		~Scope() { profiler.EndStage(); }
+
+	private:
+		Profiler& profiler;
+	};
+
+public:
+	Profiler(size_t historySize = 300);
+	~Profiler();
+
+	Profiler(const Profiler&) = delete;
+	Profiler& operator=(const Profiler&) = delete;
+
+	// Ends the previous frame and starts the next one. Also picks up the GPU results that have arrived
+	void BeginFrame();
+
+	void BeginStage(const char* name);
+	void EndStage();
+
+	// Stage 0 is the whole frame (its GPU time is the sum of the stages)
+	size_t GetStageCount() const { return stages.size(); }
+	const std::string& GetStageName(size_t stage) const { return stages[stage].name; }
+
+	// Milliseconds of the finished frames, oldest first. NaN where there's no value (yet)
+	void GetHistory(size_t stage, bool gpu, std::vector<float>& out) const;
+	Statistics GetStatistics(size_t stage, bool gpu) const;
+
+	// One line per finished frame and stage
+	bool ExportCSV(const std::string& path) const;
+
+	bool IsEnabled() const { return enabled; }
+	void SetEnabled(bool enabled);
+
+private:
+	static const unsigned int queryRingSize = 4;
+
+	struct Query
+	{
+		unsigned int id;
+		long long frame;			// -1 while not in use
+	};
+
+	struct Stage
+	{
+		std::string name;
+		std::vector<float> cpu, gpu;		// historySize each, indexed by frame % historySize
+
+		Query queries[queryRingSize];
+		int activeQuery;					// Index into queries, -1 if this frame goes without
+	};
+
+	typedef std::chrono::steady_clock Clock;
+
+	size_t FindStage(const char* name);
+	void CollectQueries(bool wait);
+	size_t GetFinishedFrameCount() const;
+
+private:
+	bool enabled;
+	size_t historySize;
+	long long frame;
+
+	std::vector<Stage> stages;
+	std::vector<unsigned int> pendingQueries;		// Per history slot, GPU frame time is final once this is 0
+
+	size_t currentStage;
+	Clock::time_point frameStart, stageStart;
+};
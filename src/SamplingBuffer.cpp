@@ -0,0 +1,55 @@
+#include "SamplingBuffer.hpp"
+
+#include <glad/glad.h>
+
+#include "IndexBuffer.hpp"
+#include "SphereSampling.hpp"
+
+std::map<const SphereSampling*, std::pair<std::weak_ptr<const SphereSampling>, std::weak_ptr<SamplingBuffer>>> SamplingBuffer::sharedBuffers;
+
+SamplingBuffer::SamplingBuffer(const SphereSampling& sampling) :
+	vbo(0), indexBuffer(std::make_shared<IndexBuffer>(sampling.indices))
+{
+	glGenBuffers(1, &vbo);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, vbo);
+	glBufferData(GL_COPY_WRITE_BUFFER, sampling.directions.size() * sizeof(float), sampling.directions.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+SamplingBuffer::~SamplingBuffer()
+{
+	glDeleteBuffers(1, &vbo);
+}
+
+void SamplingBuffer::Bind()
+{
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+	glEnableVertexAttribArray(1);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	indexBuffer->Bind();
+}
+
+std::shared_ptr<SamplingBuffer> SamplingBuffer::GetShared(const std::shared_ptr<const SphereSampling>& sampling)
+{
+	auto& slot = sharedBuffers[sampling.get()];
+
+	std::shared_ptr<SamplingBuffer> buffer = slot.second.lock();
+	if (buffer == nullptr || slot.first.lock() != sampling)
+	{
+		buffer = std::make_shared<SamplingBuffer>(*sampling);
+		slot = { sampling, buffer };
+
+		// Adaptive meshes come with a sampling of their own every time, so old entries pile up otherwise
+		for (auto it = sharedBuffers.begin(); it != sharedBuffers.end();)
+		{
+			if (it->second.second.expired())
+				it = sharedBuffers.erase(it);
+			else
+				it++;
+		}
+	}
+
+	return buffer;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <utility>
+
+class SphereSampling;
+class IndexBuffer;
+
+// The directions and triangles of a SphereSampling on the GPU.
+// Meshes with the same sampling share one of these, see GetShared().
+class SamplingBuffer
+{
+public:
+	SamplingBuffer(const SphereSampling& sampling);
+	~SamplingBuffer();
+
+	SamplingBuffer(const SamplingBuffer&) = delete;
+	SamplingBuffer& operator=(const SamplingBuffer&) = delete;
+
+	// Sets up attribute 1 (the direction) and the element buffer of the currently bound VAO
+	void Bind();
+
+	const std::shared_ptr<IndexBuffer>& GetIndexBuffer() const { return indexBuffer; }
+
+	// Lives as long as someone uses it (the sampling may be gone by then)
+	static std::shared_ptr<SamplingBuffer> GetShared(const std::shared_ptr<const SphereSampling>& sampling);
+
+private:
+	unsigned int vbo;
+	std::shared_ptr<IndexBuffer> indexBuffer;
+
+	// The sampling is kept as a weak_ptr too, a new sampling at the address of an old one mustn't get the old buffer
+	static std::map<const SphereSampling*, std::pair<std::weak_ptr<const SphereSampling>, std::weak_ptr<SamplingBuffer>>> sharedBuffers;
+};
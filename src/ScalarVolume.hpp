@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// A scalar field sampled on size^3 points spread evenly over the cube [-extent, extent]^3, x fastest, then y, then z
+struct ScalarVolume
+{
+	unsigned int size;
+	float extent;
+	std::vector<float> values;
+
+	// Largest |value| of all samples
+	float maxAbs;
+
+	float GetSpacing() const { return 2.0f * extent / (size - 1); }
+	float GetCoordinate(unsigned int i) const { return -extent + i * GetSpacing(); }
+
+	size_t GetIndex(unsigned int x, unsigned int y, unsigned int z) const { return ((size_t)z * size + y) * size + x; }
+	float GetValue(unsigned int x, unsigned int y, unsigned int z) const { return values[GetIndex(x, y, z)]; }
+};
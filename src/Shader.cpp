@@ -1,9 +1,57 @@
 #include "Shader.hpp"
 
+#include <cstdio>
+#include <cstring>
 #include <string>
 #include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <vector>
 #include <glad/glad.h>
 
+// KHR_parallel_shader_compile, the ARB version has the same values
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+std::string Shader::binaryCacheDirectory;
+bool Shader::parallelCompile = false;
+
+// "SHPB", then the binary format, the key and the size of the binary
+struct ProgramBinaryHeader
+{
+	uint32_t magic;
+	uint32_t format;
+	uint64_t key;
+	uint64_t size;
+};
+
+static const uint32_t programBinaryMagic = 0x42504853;
+
+// FNV-1a, the strings are separated so "ab" + "c" and "a" + "bc" don't collide
+static uint64_t HashStrings(std::initializer_list<std::string_view> strings)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (std::string_view string : strings)
+	{
+		for (unsigned char c : string)
+			hash = (hash ^ c) * 1099511628211ull;
+
+		hash = (hash ^ 0xFF) * 1099511628211ull;
+	}
+
+	return hash;
+}
+
+static std::string_view GetGLString(GLenum name)
+{
+	const GLubyte* string = glGetString(name);
+	return (string != nullptr) ? std::string_view((const char*)string) : std::string_view();
+}
+
 Shader::Shader()
 {
 	const std::string vertexShaderSource = R"(
@@ -38,78 +86,312 @@ Shader::Shader(const std::string& vertexShaderSourceCode, const std::string& fra
 
 Shader::~Shader()
 {
+	// Still there if the program was never used, 0 is ignored
+	if (pending)
+	{
+		glDeleteShader(fragmentShader);
+		glDeleteShader(vertexShader);
+	}
+
 	glDeleteProgram(program);
 }
 
-void Shader::SetMatrix(const std::string& name, const float* data)
+void Shader::SetMatrix(std::string_view name, const float* data)
+{
+	glUniformMatrix4fv(GetUniformLocation(name), 1, GL_FALSE, data);
+}
+
+void Shader::SetVector3(std::string_view name, const float* data)
 {
-	unsigned int location = glGetUniformLocation(program, name.c_str());
-	glUniformMatrix4fv(location, 1, GL_FALSE, data);
+	glUniform3fv(GetUniformLocation(name), 1, data);
 }
 
-void Shader::SetVector3(const std::string& name, const float* data)
+void Shader::SetUnsignedInt(std::string_view name, unsigned int value)
 {
-	unsigned int location = glGetUniformLocation(program, name.c_str());
-	glUniform3fv(location, 1, data);
+	glUniform1ui(GetUniformLocation(name), value);
+}
+
+void Shader::SetFloat(std::string_view name, float value)
+{
+	glUniform1f(GetUniformLocation(name), value);
+}
+
+int Shader::GetUniformLocation(std::string_view name)
+{
+	Finish();
+
+	auto it = uniformLocations.find(name);
+	return (it != uniformLocations.end()) ? it->second : -1;
 }
 
 void Shader::Bind()
 {
+	Finish();
 	glUseProgram(program);
 }
 
-void Shader::CreateProgram(const std::string& vertexShaderSourceCode, const std::string& fragmentShaderSourceCode)
+bool Shader::IsReady()
 {
-	int result;
+	if (!pending || !parallelCompile)
+		return true;
 
-	unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
-	const char* vertexShaderSourceCstring = vertexShaderSourceCode.c_str();
-	glShaderSource(vertexShader, 1, &vertexShaderSourceCstring, NULL);
-	glCompileShader(vertexShader);
-	glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &result);
-	if (result == GL_FALSE)
-	{
-		char errorMessage[512];
-		glGetShaderInfoLog(vertexShader, 512, NULL, errorMessage);
+	// Covers the shaders too, and a program loaded from a binary
+	int completed = GL_FALSE;
+	glGetProgramiv(program, GL_COMPLETION_STATUS_KHR, &completed);
+	return completed == GL_TRUE;
+}
 
-		std::cerr << "Failed to compile vertex shader: " << std::endl << errorMessage << std::endl;
-		glDeleteShader(vertexShader);
-		exit(-1);
-	}
+void Shader::EnableParallelCompile(void* (*getProcAddress)(const char* name))
+{
+	const char* function = nullptr;
 
-	unsigned int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-	const char* fragmentShaderSourceCstring = fragmentShaderSourceCode.c_str();
-	glShaderSource(fragmentShader, 1, &fragmentShaderSourceCstring, NULL);
-	glCompileShader(fragmentShader);
-	glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &result);
-	if (result == GL_FALSE)
+	int extensionCount = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+	for (int i = 0; i < extensionCount; i++)
 	{
-		char errorMessage[512];
-		glGetShaderInfoLog(fragmentShader, 512, NULL, errorMessage);
+		const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+		if (std::strcmp(extension, "GL_KHR_parallel_shader_compile") == 0)
+			function = "glMaxShaderCompilerThreadsKHR";
+		else if (std::strcmp(extension, "GL_ARB_parallel_shader_compile") == 0 && function == nullptr)
+			function = "glMaxShaderCompilerThreadsARB";
+	}
 
-		std::cerr << "Failed to compile fragment shader: " << std::endl << errorMessage << std::endl;
-		glDeleteShader(fragmentShader);
-		glDeleteShader(vertexShader);
-		exit(-1);
+	if (function == nullptr)
+		return;
+
+	PFNGLMAXSHADERCOMPILERTHREADSKHRPROC maxShaderCompilerThreads = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)getProcAddress(function);
+	if (maxShaderCompilerThreads == nullptr)
+		return;
+
+	// All ones lets the driver decide how many threads to use
+	maxShaderCompilerThreads(0xFFFFFFFF);
+	parallelCompile = true;
+}
+
+void Shader::SetBinaryCacheDirectory(const std::string& directory)
+{
+	binaryCacheDirectory.clear();
+	if (directory.empty())
+		return;
+
+	// Some drivers can't hand out binaries at all
+	int formatCount = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+	if (formatCount <= 0)
+		return;
+
+	std::error_code error;
+	std::filesystem::create_directories(directory, error);
+	if (error)
+	{
+		std::cerr << "Failed to create " << directory << ": " << error.message() << std::endl;
+		return;
 	}
 
+	binaryCacheDirectory = directory;
+}
+
+void Shader::CreateProgram(const std::string& vertexShaderSourceCode, const std::string& fragmentShaderSourceCode)
+{
+	vertexSource = vertexShaderSourceCode;
+	fragmentSource = fragmentShaderSourceCode;
+	vertexShader = fragmentShader = 0;
+	pending = true;
+	fromBinary = false;
+	key = 0;
+
 	program = glCreateProgram();
+
+	if (!binaryCacheDirectory.empty())
+	{
+		key = HashStrings({ vertexSource, fragmentSource, GetGLString(GL_VENDOR), GetGLString(GL_RENDERER), GetGLString(GL_VERSION) });
+		fromBinary = LoadBinary();
+	}
+
+	// Nothing is asked about the program until it's used, so the driver is free to compile in the background
+	if (!fromBinary)
+		StartCompiling();
+}
+
+void Shader::StartCompiling()
+{
+	vertexShader = glCreateShader(GL_VERTEX_SHADER);
+	const char* vertexShaderSourceCstring = vertexSource.c_str();
+	glShaderSource(vertexShader, 1, &vertexShaderSourceCstring, NULL);
+	glCompileShader(vertexShader);
+
+	fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+	const char* fragmentShaderSourceCstring = fragmentSource.c_str();
+	glShaderSource(fragmentShader, 1, &fragmentShaderSourceCstring, NULL);
+	glCompileShader(fragmentShader);
+
 	glAttachShader(program, vertexShader);
 	glAttachShader(program, fragmentShader);
+
+	if (key != 0)
+		glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
 	glLinkProgram(program);
+}
+
+bool Shader::LoadBinary()
+{
+	char name[32];
+	std::snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+
+	std::ifstream file(binaryCacheDirectory + "/" + name, std::ios::binary);
+	if (!file)
+		return false;
+
+	ProgramBinaryHeader header;
+	if (!file.read((char*)&header, sizeof(header)) || header.magic != programBinaryMagic || header.key != key || header.size > (1u << 30))
+		return false;
+
+	std::vector<char> binary(header.size);
+	if (!file.read(binary.data(), binary.size()))
+		return false;
+
+	// Whether the driver takes it shows in the link status
+	glProgramBinary(program, header.format, binary.data(), (GLsizei)binary.size());
+	return true;
+}
+
+void Shader::SaveBinary()
+{
+	int length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return;
+
+	std::vector<char> binary(length);
+	GLenum format = 0;
+	glGetProgramBinary(program, length, &length, &format, binary.data());
+
+	ProgramBinaryHeader header = { programBinaryMagic, format, key, (uint64_t)length };
+
+	char name[32];
+	std::snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+	std::string path = binaryCacheDirectory + "/" + name;
+
+	// Written next to it and renamed, so another instance never reads half a file
+	std::string temporaryPath = path + ".tmp";
+	std::ofstream file(temporaryPath, std::ios::binary);
+	file.write((const char*)&header, sizeof(header));
+	file.write(binary.data(), length);
+	file.close();
+
+	std::error_code error;
+	if (!file.fail())
+		std::filesystem::rename(temporaryPath, path, error);
+
+	if (file.fail() || error)
+	{
+		std::cerr << "Failed to write " << path << std::endl;
+		std::filesystem::remove(temporaryPath, error);
+	}
+}
+
+void Shader::Finish()
+{
+	if (!pending)
+		return;
+
+	pending = false;
+
+	int result;
 	glGetProgramiv(program, GL_LINK_STATUS, &result);
-	if (result == GL_FALSE)
+
+	// A rejected binary is no error, the program is compiled like it wasn't cached
+	if (result == GL_FALSE && fromBinary)
+	{
+		glDeleteProgram(program);
+		program = glCreateProgram();
+		fromBinary = false;
+
+		StartCompiling();
+		glGetProgramiv(program, GL_LINK_STATUS, &result);
+	}
+
+	if (!fromBinary)
 	{
-		char errorMessage[512];
-		glGetProgramInfoLog(program, 512, NULL, errorMessage);
+		int compiled;
+		glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &compiled);
+		if (compiled == GL_FALSE)
+		{
+			char errorMessage[512];
+			glGetShaderInfoLog(vertexShader, 512, NULL, errorMessage);
+
+			std::cerr << "Failed to compile vertex shader: " << std::endl << errorMessage << std::endl;
+			glDeleteShader(fragmentShader);
+			glDeleteShader(vertexShader);
+			glDeleteProgram(program);
+			exit(-1);
+		}
+
+		glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &compiled);
+		if (compiled == GL_FALSE)
+		{
+			char errorMessage[512];
+			glGetShaderInfoLog(fragmentShader, 512, NULL, errorMessage);
+
+			std::cerr << "Failed to compile fragment shader: " << std::endl << errorMessage << std::endl;
+			glDeleteShader(fragmentShader);
+			glDeleteShader(vertexShader);
+			glDeleteProgram(program);
+			exit(-1);
+		}
 
-		std::cerr << "Failed to link shader program: " << std::endl << errorMessage << std::endl;
+		if (result == GL_FALSE)
+		{
+			char errorMessage[512];
+			glGetProgramInfoLog(program, 512, NULL, errorMessage);
+
+			std::cerr << "Failed to link shader program: " << std::endl << errorMessage << std::endl;
+			glDeleteShader(fragmentShader);
+			glDeleteShader(vertexShader);
+			glDeleteProgram(program);
+			exit(-1);
+		}
+
+		glDetachShader(program, fragmentShader);
+		glDetachShader(program, vertexShader);
 		glDeleteShader(fragmentShader);
 		glDeleteShader(vertexShader);
-		glDeleteProgram(program);
-		exit(-1);
+
+		// Only programs created while the cache was on have a key
+		if (key != 0)
+			SaveBinary();
 	}
 
-	glDeleteShader(fragmentShader);
-	glDeleteShader(vertexShader);
+	std::string().swap(vertexSource);
+	std::string().swap(fragmentSource);
+
+	FindUniformLocations();
+}
+
+void Shader::FindUniformLocations()
+{
+	int uniformCount = 0, maxNameLength = 0;
+	glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &uniformCount);
+	glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+	std::string name(maxNameLength, '\0');
+	for (int i = 0; i < uniformCount; i++)
+	{
+		int length = 0, size = 0;
+		unsigned int type = 0;
+		glGetActiveUniform(program, i, maxNameLength, &length, &size, &type, &name[0]);
+
+		// Members of uniform blocks have no location
+		std::string uniformName = name.substr(0, length);
+		int location = glGetUniformLocation(program, uniformName.c_str());
+		if (location < 0)
+			continue;
+
+		uniformLocations[uniformName] = location;
+
+		// Arrays are reported as "name[0]", make them available as just "name" as well
+		if (uniformName.size() > 3 && uniformName.compare(uniformName.size() - 3, 3, "[0]") == 0)
+			uniformLocations[uniformName.substr(0, uniformName.size() - 3)] = location;
+	}
 }
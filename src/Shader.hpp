@@ -1,7 +1,20 @@
 #pragma once
 
+#include <cstdint>
+#include <functional>
+#include <map>
 #include <string>
+#include <string_view>
 
+// A vertex + fragment shader program. Creating one only hands the sources to the driver, the program
+// is waited for (and checked) the first time it's bound or a uniform is set. Whether the driver compiles
+// in the background is up to it, unless EnableParallelCompile() finds KHR_parallel_shader_compile: then
+// the driver gets its compiler threads and IsReady() tells whether binding would still have to wait.
+//
+// With a binary cache directory set, linked programs are saved with glGetProgramBinary and loaded
+// again on the next run instead of being compiled. The files are named after a hash of the sources
+// and the driver's vendor, renderer and version strings, so a driver update simply misses the cache.
+// A binary the driver rejects anyway is compiled from the sources like there was no cache.
 class Shader
 {
 public:
@@ -9,14 +22,48 @@ public:
 	Shader(const std::string& vertexShaderSourceCode, const std::string& fragmentShaderSourceCode);
 	~Shader();
 	
-	void SetMatrix(const std::string& name, const float* data);
-	void SetVector3(const std::string& name, const float* data);
+	// Uniforms that don't exist (or were optimized away) are silently ignored, just like location -1 in GL
+	void SetMatrix(std::string_view name, const float* data);
+	void SetVector3(std::string_view name, const float* data);
+	void SetUnsignedInt(std::string_view name, unsigned int value);
+	void SetFloat(std::string_view name, float value);
+
+	int GetUniformLocation(std::string_view name);
 
 	void Bind();
 
+	// Asks without waiting. Always true without KHR_parallel_shader_compile, there's no way to ask then
+	bool IsReady();
+
+	// Needs a context, only affects shaders created afterwards. Empty turns the cache off (the default)
+	static void SetBinaryCacheDirectory(const std::string& directory);
+
+	// Needs a context, call it before creating shaders. Does nothing if the driver has neither the KHR
+	// nor the ARB extension, getProcAddress is the same loader glad was given
+	static void EnableParallelCompile(void* (*getProcAddress)(const char* name));
+
 private:
 	void CreateProgram(const std::string& vertexShaderSourceCode, const std::string& fragmentShaderSourceCode);
+	void StartCompiling();
+	bool LoadBinary();
+	void SaveBinary();
+
+	// Waits for the program, exits if it doesn't compile
+	void Finish();
+	void FindUniformLocations();
 
 private:
 	unsigned int program;
-};
\ No newline at end of file
+	unsigned int vertexShader, fragmentShader;
+	bool pending, fromBinary;
+
+	// Kept until the program is done, in case the cached binary is rejected
+	std::string vertexSource, fragmentSource;
+	uint64_t key;
+
+	static std::string binaryCacheDirectory;
+	static bool parallelCompile;
+
+	// Looked up once after linking, std::less<> allows lookups without building a std::string
+	std::map<std::string, int, std::less<>> uniformLocations;
+};
@@ -0,0 +1,382 @@
+#include "SphereSampling.hpp"
+
+#define PI           3.14159265359
+#define TWO_PI       6.28318530718
+#define GOLDEN_RATIO 1.61803398875
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+
+#include "Harmonics.hpp"
+#include "HarmonicsBatch.hpp"
+#include "ThreadPool.hpp"
+
+const double icosahedronVertices[12][3] = {
+	{ -1,  GOLDEN_RATIO,  0 }, {  1,  GOLDEN_RATIO,  0 }, { -1, -GOLDEN_RATIO,  0 }, {  1, -GOLDEN_RATIO,  0 },
+	{  0, -1,  GOLDEN_RATIO }, {  0,  1,  GOLDEN_RATIO }, {  0, -1, -GOLDEN_RATIO }, {  0,  1, -GOLDEN_RATIO },
+	{  GOLDEN_RATIO,  0, -1 }, {  GOLDEN_RATIO,  0,  1 }, { -GOLDEN_RATIO,  0, -1 }, { -GOLDEN_RATIO,  0,  1 }
+};
+
+const uint32_t icosahedronFaces[20][3] = {
+	{ 0, 11, 5 }, { 0, 5, 1 }, { 0, 1, 7 }, { 0, 7, 10 }, { 0, 10, 11 },
+	{ 1, 5, 9 }, { 5, 11, 4 }, { 11, 10, 2 }, { 10, 7, 6 }, { 7, 1, 8 },
+	{ 3, 9, 4 }, { 3, 4, 2 }, { 3, 2, 6 }, { 3, 6, 8 }, { 3, 8, 9 },
+	{ 4, 9, 5 }, { 2, 4, 11 }, { 6, 2, 10 }, { 8, 6, 7 }, { 9, 8, 1 }
+};
+
+std::map<std::pair<SamplingScheme, unsigned int>, std::weak_ptr<const SphereSampling>> SphereSampling::sharedSamplings;
+std::mutex SphereSampling::sharedMutex;
+
+SphereSampling::SphereSampling(SamplingScheme scheme, unsigned int resolution)
+{
+	if (scheme == SamplingScheme::Healpix)
+		BuildHealpix(GetHealpixSide(resolution));
+	else
+		BuildIcosphere(GetIcosphereFrequency(resolution));
+}
+
+SphereSampling::SphereSampling(std::vector<float>&& directions, std::vector<uint32_t>&& indices) :
+	directions(std::move(directions)), indices(std::move(indices))
+{
+}
+
+bool SphereSampling::Evaluate(int l, int m, float* values, ThreadPool* pool, const std::atomic<bool>* cancelled) const
+{
+	if (!rings.empty())
+	{
+		EvaluateRings(l, m, values, pool, cancelled);
+		return (cancelled == nullptr || !*cancelled);
+	}
+
+	// The kernels want one array per component, so every chunk gets split up first
+	const size_t chunkSize = 4096;
+	size_t vertexCount = GetVertexCount();
+	size_t chunkCount = (vertexCount + chunkSize - 1) / chunkSize;
+
+	auto evaluateChunk = [&](size_t chunk)
+	{
+		if (cancelled != nullptr && *cancelled)
+			return;
+
+		size_t first = chunk * chunkSize;
+		size_t count = std::min(chunkSize, vertexCount - first);
+
+		std::vector<float> x(count), y(count), z(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			x[i] = directions[3 * (first + i) + 0];
+			y[i] = directions[3 * (first + i) + 1];
+			z[i] = directions[3 * (first + i) + 2];
+		}
+
+		EvaluateRealHarmonics(l, m, x.data(), y.data(), z.data(), count, values + first, nullptr);
+	};
+
+	if (pool != nullptr && chunkCount > 1)
+		pool->ParallelFor(chunkCount, evaluateChunk);
+	else
+	{
+		for (size_t chunk = 0; chunk < chunkCount; chunk++)
+			evaluateChunk(chunk);
+	}
+
+	return (cancelled == nullptr || !*cancelled);
+}
+
+std::shared_ptr<const SphereSampling> SphereSampling::GetShared(SamplingScheme scheme, unsigned int resolution)
+{
+	std::lock_guard<std::mutex> lock(sharedMutex);
+	std::weak_ptr<const SphereSampling>& slot = sharedSamplings[{ scheme, resolution }];
+
+	std::shared_ptr<const SphereSampling> sampling = slot.lock();
+	if (sampling == nullptr)
+	{
+		sampling = std::make_shared<SphereSampling>(scheme, resolution);
+		slot = sampling;
+	}
+
+	return sampling;
+}
+
+unsigned int SphereSampling::GetHealpixSide(unsigned int resolution)
+{
+	// 12 side^2 pixels of area 4pi / (12 side^2) against the grid's 2pi^2 / resolution^2 at the equator
+	return std::max(1u, (unsigned int)std::lround(resolution / std::sqrt(6.0 * PI)));
+}
+
+unsigned int SphereSampling::GetIcosphereFrequency(unsigned int resolution)
+{
+	// 10 frequency^2 + 2 vertices, so about 4pi / (10 frequency^2) per vertex
+	return std::max(1u, (unsigned int)std::lround(resolution / std::sqrt(5.0 * PI)));
+}
+
+void SphereSampling::BuildHealpix(unsigned int side)
+{
+	// The pixel centers lie on 4 side - 1 rings: polar caps with 4 i pixels on ring i,
+	// and equatorial rings of 4 side pixels, every other of them shifted by half a pixel
+	unsigned int ringCount = 4 * side - 1;
+	rings.resize(ringCount);
+
+	double sideSquared = (double)side * side;
+	uint32_t first = 1;
+	for (unsigned int i = 1; i <= ringCount; i++)
+	{
+		Ring& ring = rings[i - 1];
+		if (i < side)
+			ring = { 1.0 - i * i / (3.0 * sideSquared), 4 * i, true, first };
+		else if (i <= 3 * side)
+			ring = { 4.0 / 3.0 - 2.0 * i / (3.0 * side), 4 * side, ((i - side + 1) % 2) != 0, first };
+		else
+		{
+			unsigned int mirrored = 4 * side - i;
+			ring = { -1.0 + mirrored * mirrored / (3.0 * sideSquared), 4 * mirrored, true, first };
+		}
+
+		first += ring.count;
+	}
+
+	// The poles themselves aren't pixel centers, but without them there would be holes
+	size_t vertexCount = (size_t)first + 1;
+	directions.resize(3 * vertexCount);
+	indices.reserve(3 * (2 * vertexCount - 4));
+
+	uint32_t northPole = 0, southPole = (uint32_t)(vertexCount - 1);
+	directions[3 * northPole + 2] = 1.0f;
+	directions[3 * southPole + 2] = -1.0f;
+	for (const Ring& ring : rings)
+	{
+		// Stepping around the ring by a rotation, the error it picks up stays far below float precision
+		double step = TWO_PI / ring.count;
+		double stepCos = std::cos(step), stepSin = std::sin(step);
+		double phiCos = ring.shifted ? std::cos(0.5 * step) : 1.0;
+		double phiSin = ring.shifted ? std::sin(0.5 * step) : 0.0;
+
+		double sinTheta = std::sqrt(std::max(0.0, 1.0 - ring.z * ring.z));
+		for (unsigned int j = 0; j < ring.count; j++)
+		{
+			uint32_t vertex = ring.first + j;
+			directions[3 * vertex + 0] = (float)(sinTheta * phiCos);
+			directions[3 * vertex + 1] = (float)(sinTheta * phiSin);
+			directions[3 * vertex + 2] = (float)ring.z;
+
+			double next = phiCos * stepCos - phiSin * stepSin;
+			phiSin = phiSin * stepCos + phiCos * stepSin;
+			phiCos = next;
+		}
+	}
+
+	const Ring& top = rings.front();
+	for (unsigned int j = 0; j < top.count; j++)
+	{
+		uint32_t triangle[3] = { northPole, top.first + j, top.first + (j + 1) % top.count };
+		indices.insert(indices.end(), triangle, triangle + 3);
+	}
+
+	// Neighbouring rings are zipped together, always stepping along the ring whose next vertex comes first in phi
+	for (unsigned int i = 0; i + 1 < ringCount; i++)
+	{
+		const Ring& a = rings[i];
+		const Ring& b = rings[i + 1];
+		double offsetA = a.shifted ? 0.5 : 0.0, offsetB = b.shifted ? 0.5 : 0.0;
+
+		unsigned int stepA = 0, stepB = 0;
+		while (stepA < a.count || stepB < b.count)
+		{
+			uint32_t vertexA = a.first + stepA % a.count;
+			uint32_t vertexB = b.first + stepB % b.count;
+
+			double nextA = (stepA + 1 + offsetA) / a.count;
+			double nextB = (stepB + 1 + offsetB) / b.count;
+			if (stepB == b.count || (stepA < a.count && nextA < nextB))
+			{
+				stepA++;
+				uint32_t triangle[3] = { vertexA, vertexB, a.first + stepA % a.count };
+				indices.insert(indices.end(), triangle, triangle + 3);
+			}
+			else
+			{
+				stepB++;
+				uint32_t triangle[3] = { vertexA, vertexB, b.first + stepB % b.count };
+				indices.insert(indices.end(), triangle, triangle + 3);
+			}
+		}
+	}
+
+	const Ring& bottom = rings.back();
+	for (unsigned int j = 0; j < bottom.count; j++)
+	{
+		uint32_t triangle[3] = { bottom.first + j, southPole, bottom.first + (j + 1) % bottom.count };
+		indices.insert(indices.end(), triangle, triangle + 3);
+	}
+}
+
+void SphereSampling::BuildIcosphere(unsigned int frequency)
+{
+	auto addVertex = [&](const double* position)
+	{
+		double length = std::sqrt(position[0] * position[0] + position[1] * position[1] + position[2] * position[2]);
+		for (int k = 0; k < 3; k++)
+			directions.push_back((float)(position[k] / length));
+
+		return (uint32_t)(directions.size() / 3 - 1);
+	};
+
+	// Somewhere on the flat face (a, b, c), before it's pushed out onto the sphere
+	auto facePoint = [&](uint32_t a, uint32_t b, uint32_t c, unsigned int i, unsigned int j, double* position)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			position[k] = icosahedronVertices[a][k] + ((double)i / frequency) * (icosahedronVertices[b][k] - icosahedronVertices[a][k]) +
+				((double)j / frequency) * (icosahedronVertices[c][k] - icosahedronVertices[a][k]);
+		}
+	};
+
+	size_t vertexCount = 10 * (size_t)frequency * frequency + 2;
+	directions.reserve(3 * vertexCount);
+	indices.reserve(3 * (2 * vertexCount - 4));
+
+	// The corners get 0 to 11, like in icosahedronVertices
+	for (const double* corner : icosahedronVertices)
+		addVertex(corner);
+
+	// The inner vertices of an edge are created by the first face that needs them, ordered from
+	// the lower corner index to the higher one
+	std::unordered_map<uint64_t, uint32_t> edges;
+	auto edgeVertex = [&](uint32_t from, uint32_t to, unsigned int step)
+	{
+		uint32_t low = std::min(from, to), high = std::max(from, to);
+		uint64_t key = ((uint64_t)low << 32) | high;
+
+		auto it = edges.find(key);
+		if (it == edges.end())
+		{
+			uint32_t first = (uint32_t)(directions.size() / 3);
+			for (unsigned int i = 1; i < frequency; i++)
+			{
+				double position[3];
+				facePoint(low, high, high, i, 0, position);
+				addVertex(position);
+			}
+
+			it = edges.emplace(key, first).first;
+		}
+
+		return it->second + ((from == low) ? step - 1 : frequency - step - 1);
+	};
+
+	// Face (a, b, c) is covered by the points a + i / f (b - a) + j / f (c - a) with i + j <= f
+	std::vector<uint32_t> grid((size_t)(frequency + 1) * (frequency + 1));
+	auto at = [&](unsigned int i, unsigned int j) -> uint32_t& { return grid[(size_t)i * (frequency + 1) + j]; };
+
+	for (const uint32_t* face : icosahedronFaces)
+	{
+		uint32_t a = face[0], b = face[1], c = face[2];
+		for (unsigned int i = 0; i <= frequency; i++)
+		{
+			for (unsigned int j = 0; i + j <= frequency; j++)
+			{
+				if (i == 0 && j == 0)
+					at(i, j) = a;
+				else if (i == frequency)
+					at(i, j) = b;
+				else if (j == frequency)
+					at(i, j) = c;
+				else if (j == 0)
+					at(i, j) = edgeVertex(a, b, i);
+				else if (i == 0)
+					at(i, j) = edgeVertex(a, c, j);
+				else if (i + j == frequency)
+					at(i, j) = edgeVertex(b, c, j);
+				else
+				{
+					double position[3];
+					facePoint(a, b, c, i, j, position);
+					at(i, j) = addVertex(position);
+				}
+			}
+		}
+
+		for (unsigned int i = 0; i < frequency; i++)
+		{
+			for (unsigned int j = 0; i + j < frequency; j++)
+			{
+				uint32_t up[3] = { at(i, j), at(i + 1, j), at(i, j + 1) };
+				indices.insert(indices.end(), up, up + 3);
+
+				if (i + j + 1 < frequency)
+				{
+					uint32_t down[3] = { at(i + 1, j), at(i + 1, j + 1), at(i, j + 1) };
+					indices.insert(indices.end(), down, down + 3);
+				}
+			}
+		}
+	}
+}
+
+void SphereSampling::EvaluateRings(int l, int m, float* values, ThreadPool* pool, const std::atomic<bool>* cancelled) const
+{
+	unsigned int absM = std::abs(m);
+
+	// e^(i m phi) around the ring by repeated rotation. The angles are reduced exactly first, in units of
+	// pi / count, so high m doesn't lose precision
+	auto fillPhases = [&](const Ring& ring, std::vector<double>& phases)
+	{
+		phases.resize(ring.count);
+
+		double step = (2ull * absM % (2ull * ring.count)) * PI / ring.count;
+		double start = ring.shifted ? (absM % (2ull * ring.count)) * PI / ring.count : 0.0;
+		double stepCos = std::cos(step), stepSin = std::sin(step);
+		double phaseCos = std::cos(start), phaseSin = std::sin(start);
+
+		for (unsigned int j = 0; j < ring.count; j++)
+		{
+			phases[j] = (m < 0) ? phaseSin : phaseCos;
+
+			double next = phaseCos * stepCos - phaseSin * stepSin;
+			phaseSin = phaseSin * stepCos + phaseCos * stepSin;
+			phaseCos = next;
+		}
+	};
+
+	// Most rings are equatorial and have the same pixels, save for the shift
+	std::vector<double> equatorialPhases[2];
+	for (const Ring& ring : rings)
+	{
+		if (ring.count == rings[rings.size() / 2].count && equatorialPhases[ring.shifted].empty())
+			fillPhases(ring, equatorialPhases[ring.shifted]);
+	}
+
+	// Only m = 0 has a value at the poles
+	values[0] = (m == 0) ? (float)NormalizedLegendre(l, 0, 1.0, 0.0) : 0.0f;
+	values[GetVertexCount() - 1] = (m == 0) ? (float)NormalizedLegendre(l, 0, -1.0, 0.0) : 0.0f;
+
+	auto evaluateRing = [&](size_t index)
+	{
+		if (cancelled != nullptr && *cancelled)
+			return;
+
+		const Ring& ring = rings[index];
+		double legendre = NormalizedLegendre(l, absM, ring.z, std::sqrt(std::max(0.0, 1.0 - ring.z * ring.z)));
+
+		std::vector<double> capPhases;
+		const std::vector<double>* phases = &equatorialPhases[ring.shifted];
+		if (ring.count != phases->size())
+		{
+			fillPhases(ring, capPhases);
+			phases = &capPhases;
+		}
+
+		float* out = values + ring.first;
+		for (unsigned int j = 0; j < ring.count; j++)
+			out[j] = (float)(legendre * (*phases)[j]);
+	};
+
+	if (pool != nullptr)
+		pool->ParallelFor(rings.size(), evaluateRing);
+	else
+	{
+		for (size_t ring = 0; ring < rings.size(); ring++)
+			evaluateRing(ring);
+	}
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+class ThreadPool;
+
+enum class SamplingScheme
+{
+	Healpix,	// Equal area pixels on iso-latitude rings
+	Icosphere	// Subdivided icosahedron
+};
+
+// The icosahedron every icosphere (and AdaptiveMesher) starts from, counter clockwise seen from outside
+extern const double icosahedronVertices[12][3];
+extern const uint32_t icosahedronFaces[20][3];
+
+// Unit directions on the sphere and the triangles between them, for meshes that don't use the theta/phi grid
+// (the "sampled" layout of OrbitalMesh). Unlike the grid these don't waste whole rings of vertices on the poles:
+// for the same largest cell size they get by with about 36% fewer vertices, i.e. harmonic evaluations.
+//
+// HEALPix and icosphere samplings only depend on the scheme and the resolution, so every orbital shares them
+// through GetShared(). The resolution is that of the grid they stand in for, see GetHealpixSide() and
+// GetIcosphereFrequency().
+class SphereSampling
+{
+public:
+	SphereSampling(SamplingScheme scheme, unsigned int resolution);
+	SphereSampling(std::vector<float>&& directions, std::vector<uint32_t>&& indices);
+
+	size_t GetVertexCount() const { return directions.size() / 3; }
+	size_t GetByteSize() const { return directions.size() * sizeof(float) + indices.size() * sizeof(uint32_t); }
+
+	// Evaluates the displayed harmonic at every direction. Returns false if it was cancelled
+	bool Evaluate(int l, int m, float* values, ThreadPool* pool = nullptr, const std::atomic<bool>* cancelled = nullptr) const;
+
+	// Created on first use and kept as long as someone uses it, safe to call from any thread
+	static std::shared_ptr<const SphereSampling> GetShared(SamplingScheme scheme, unsigned int resolution);
+
+	// Cells about as large as the largest cells of the grid at the given resolution (the ones at the equator)
+	static unsigned int GetHealpixSide(unsigned int resolution);
+	static unsigned int GetIcosphereFrequency(unsigned int resolution);
+
+public:
+	std::vector<float> directions;		// x, y, z per vertex
+	std::vector<uint32_t> indices;		// Triangle list
+
+private:
+	// HEALPix pixels lie on rings of constant z, and the vertices are stored ring by ring (with the poles first and last).
+	// That lets Evaluate() separate the harmonic the way HarmonicGrid does
+	struct Ring
+	{
+		double z;
+		unsigned int count;
+		bool shifted;			// By half a pixel in phi
+		uint32_t first;
+	};
+
+	void BuildHealpix(unsigned int side);
+	void BuildIcosphere(unsigned int frequency);
+
+	void EvaluateRings(int l, int m, float* values, ThreadPool* pool, const std::atomic<bool>* cancelled) const;
+
+private:
+	std::vector<Ring> rings;
+
+private:
+	static std::map<std::pair<SamplingScheme, unsigned int>, std::weak_ptr<const SphereSampling>> sharedSamplings;
+	static std::mutex sharedMutex;
+};
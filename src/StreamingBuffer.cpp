@@ -0,0 +1,65 @@
+#include "StreamingBuffer.hpp"
+
+#include <iostream>
+
+#include <glad/glad.h>
+
+StreamingBuffer::StreamingBuffer(size_t regionSize, unsigned int regionCount) :
+	buffer(0), regionSize(regionSize), regionCount(regionCount), region(regionCount - 1), mapping(nullptr), fences(regionCount, nullptr)
+{
+	// Regions start on a float4 boundary, whatever ends up in them
+	this->regionSize = (regionSize + 15) & ~(size_t)15;
+
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glBufferStorage(GL_ARRAY_BUFFER, this->regionSize * regionCount, nullptr, flags);
+	mapping = (char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, this->regionSize * regionCount, flags);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	if (mapping == nullptr)
+		std::cerr << "Failed to map streaming buffer" << std::endl;
+}
+
+StreamingBuffer::~StreamingBuffer()
+{
+	for (GLsync fence : fences)
+	{
+		if (fence != nullptr)
+			glDeleteSync(fence);
+	}
+
+	// Deleting a buffer unmaps it
+	glDeleteBuffers(1, &buffer);
+}
+
+void* StreamingBuffer::Map()
+{
+	if (mapping == nullptr)
+		return nullptr;
+
+	region = (region + 1) % regionCount;
+
+	GLsync& fence = fences[region];
+	if (fence != nullptr)
+	{
+		// Only the first wait has to flush, after that the fence is on its way
+		GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+		while (glClientWaitSync(fence, flags, 1000000) == GL_TIMEOUT_EXPIRED)
+			flags = 0;
+
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+
+	return mapping + region * regionSize;
+}
+
+void StreamingBuffer::Fence()
+{
+	GLsync& fence = fences[region];
+	if (fence != nullptr)
+		glDeleteSync(fence);
+
+	fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
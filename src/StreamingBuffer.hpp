@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+typedef struct __GLsync* GLsync;
+
+// A buffer that's rewritten every frame. The storage is allocated once with glBufferStorage and stays
+// persistently (and coherently) mapped, split into regionCount regions that are filled round robin:
+// while the GPU still reads the region of an earlier frame, the CPU writes the next one. Every region
+// gets a fence behind the draws that read it, so Map() only waits if the CPU is a whole ring ahead.
+class StreamingBuffer
+{
+public:
+	StreamingBuffer(size_t regionSize, unsigned int regionCount = 3);
+	~StreamingBuffer();
+
+	StreamingBuffer(const StreamingBuffer&) = delete;
+	StreamingBuffer& operator=(const StreamingBuffer&) = delete;
+
+	// Moves on to the next region, waits until the GPU is done with it, and returns it for writing.
+	// nullptr if the buffer couldn't be mapped
+	void* Map();
+
+	// Has to follow the last draw that reads the region Map() returned
+	void Fence();
+
+	unsigned int GetBuffer() const { return buffer; }
+	size_t GetRegionSize() const { return regionSize; }
+
+	// Of the region Map() returned last
+	size_t GetOffset() const { return region * regionSize; }
+
+private:
+	unsigned int buffer;
+	size_t regionSize;
+	unsigned int regionCount, region;
+
+	char* mapping;
+	std::vector<GLsync> fences;
+};
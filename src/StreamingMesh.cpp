@@ -0,0 +1,53 @@
+#include "StreamingMesh.hpp"
+
+#include <glad/glad.h>
+
+#include "IndexBuffer.hpp"
+
+StreamingMesh::StreamingMesh(unsigned int resolution) :
+	vao(0), resolution(resolution), radii(GetVertexCount() * sizeof(float))
+{
+	glGenVertexArrays(1, &vao);
+	glBindVertexArray(vao);
+
+	// The format stays, only the offset into the buffer changes from frame to frame (see Draw())
+	glEnableVertexAttribArray(0);
+	glVertexAttribFormat(0, 1, GL_FLOAT, GL_FALSE, 0);
+	glVertexAttribBinding(0, 0);
+
+	glBindVertexArray(0);
+
+	SetEncoding(IndexBuffer::GetDefaultEncoding());
+}
+
+StreamingMesh::~StreamingMesh()
+{
+	glDeleteVertexArrays(1, &vao);
+}
+
+float* StreamingMesh::Map()
+{
+	return (float*)radii.Map();
+}
+
+void StreamingMesh::Draw()
+{
+	glBindVertexArray(vao);
+	glBindVertexBuffer(0, radii.GetBuffer(), radii.GetOffset(), sizeof(float));
+	indexBuffer->Draw();
+	glBindVertexArray(0);
+
+	radii.Fence();
+}
+
+void StreamingMesh::SetEncoding(IndexEncoding encoding)
+{
+	if (indexBuffer != nullptr && indexBuffer->GetEncoding() == encoding)
+		return;
+
+	indexBuffer = IndexBuffer::GetShared(resolution, encoding);
+
+	glBindVertexArray(vao);
+	indexBuffer->Bind();
+	glBindVertexArray(0);
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <memory>
+
+#include "GridIndices.hpp"
+#include "StreamingBuffer.hpp"
+
+class IndexBuffer;
+
+// A grid mesh whose radii are written anew every frame, for animations. Only the radii stream through
+// a StreamingBuffer, the indices are the shared IndexBuffer of the resolution like for a GpuMesh.
+// Map() the radii, fill all GetVertexCount() of them, then Draw() once. Map() returns nullptr if the
+// radii couldn't be mapped, the mesh can't be drawn then.
+class StreamingMesh
+{
+public:
+	StreamingMesh(unsigned int resolution);
+	~StreamingMesh();
+
+	StreamingMesh(const StreamingMesh&) = delete;
+	StreamingMesh& operator=(const StreamingMesh&) = delete;
+
+	float* Map();
+	void Draw();
+
+	void SetEncoding(IndexEncoding encoding);
+
+	unsigned int GetResolution() const { return resolution; }
+	size_t GetVertexCount() const { return (size_t)(resolution + 1) * resolution; }
+
+private:
+	unsigned int vao;
+	unsigned int resolution;
+
+	StreamingBuffer radii;
+	std::shared_ptr<IndexBuffer> indexBuffer;
+};
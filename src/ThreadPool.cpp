@@ -0,0 +1,115 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+ThreadPool::ThreadPool(unsigned int threadCount) :
+	stopping(false)
+{
+	if (threadCount == 0)
+		threadCount = 1;
+
+	for (unsigned int i = 0; i < threadCount; i++)
+		workers.emplace_back(&ThreadPool::WorkerLoop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	jobAvailable.notify_all();
+
+	for (std::thread& worker : workers)
+		worker.join();
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& task)
+{
+	if (count == 0)
+		return;
+
+	if (count == 1)
+	{
+		task(0);
+		return;
+	}
+
+	// Workers and the caller grab indices from a shared counter until none are left.
+	// The state is shared because a worker might only pick up its job after everything is done already.
+	struct Batch
+	{
+		std::atomic<size_t> next{ 0 };
+		std::atomic<size_t> finished{ 0 };
+		size_t count;
+		const std::function<void(size_t)>* task;
+
+		std::mutex mutex;
+		std::condition_variable done;
+	};
+
+	std::shared_ptr<Batch> batch = std::make_shared<Batch>();
+	batch->count = count;
+	batch->task = &task;
+
+	auto run = [](Batch& batch)
+	{
+		size_t completed = 0;
+		for (size_t i = batch.next++; i < batch.count; i = batch.next++)
+		{
+			(*batch.task)(i);
+			completed++;
+		}
+
+		if (completed > 0 && batch.finished.fetch_add(completed) + completed == batch.count)
+		{
+			std::lock_guard<std::mutex> lock(batch.mutex);
+			batch.done.notify_all();
+		}
+	};
+
+	size_t helpers = std::min<size_t>(workers.size(), count - 1);
+	for (size_t i = 0; i < helpers; i++)
+		Enqueue([batch, run]() { run(*batch); });
+
+	run(*batch);
+
+	std::unique_lock<std::mutex> lock(batch->mutex);
+	batch->done.wait(lock, [&]() { return batch->finished == batch->count; });
+}
+
+ThreadPool& ThreadPool::GetDefault()
+{
+	static ThreadPool pool(std::thread::hardware_concurrency());
+	return pool;
+}
+
+void ThreadPool::Enqueue(std::function<void()>&& job)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.push(std::move(job));
+	}
+	jobAvailable.notify_one();
+}
+
+void ThreadPool::WorkerLoop()
+{
+	while (true)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			jobAvailable.wait(lock, [this]() { return stopping || !jobs.empty(); });
+			if (stopping && jobs.empty())
+				return;
+
+			job = std::move(jobs.front());
+			jobs.pop();
+		}
+
+		job();
+	}
+}
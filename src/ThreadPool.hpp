@@ -0,0 +1,52 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads that stay alive for the whole program, so generating
+// a mesh doesn't have to spawn threads every time
+class ThreadPool
+{
+public:
+	ThreadPool(unsigned int threadCount);
+	~ThreadPool();
+
+	unsigned int GetThreadCount() const { return (unsigned int)workers.size(); }
+
+	// Runs task(0), ..., task(count - 1) on the workers and blocks until all of them are done.
+	// The calling thread works on the tasks too, so this can safely be called from within a task.
+	void ParallelFor(size_t count, const std::function<void(size_t)>& task);
+
+	// Runs a single job on one of the workers, the future receives its result
+	template<typename Function>
+	auto Submit(Function&& function) -> std::future<decltype(function())>
+	{
+		auto job = std::make_shared<std::packaged_task<decltype(function())()>>(std::forward<Function>(function));
+		std::future<decltype(function())> result = job->get_future();
+		Enqueue([job]() { (*job)(); });
+
+		return result;
+	}
+
+	// One worker per hardware thread, created on first use
+	static ThreadPool& GetDefault();
+
+private:
+	void Enqueue(std::function<void()>&& job);
+	void WorkerLoop();
+
+private:
+	std::vector<std::thread> workers;
+	std::queue<std::function<void()>> jobs;
+
+	std::mutex mutex;
+	std::condition_variable jobAvailable;
+	bool stopping;
+};
@@ -1,5 +1,11 @@
+#include <algorithm>
 #include <iostream>
 #include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -8,9 +14,25 @@
 #include <backends/imgui_impl_opengl3.h>
 
 #include "Orbital.hpp"
+#include "BackgroundJob.hpp"
+#include "HarmonicExpansion.hpp"
+#include "HarmonicAnalysis.hpp"
+#include "MeshExporter.hpp"
+#include "ThreadPool.hpp"
+#include "OrbitalGallery.hpp"
+#include "HydrogenOrbital.hpp"
+#include "HydrogenVolume.hpp"
+#include "HydrogenCloud.hpp"
+#include "MeshCache.hpp"
+#include "MeshArchive.hpp"
+#include "IndexBuffer.hpp"
+#include "LevelOfDetail.hpp"
 #include "CoordinateSystem.hpp"
 #include "Shader.hpp"
 #include "Camera.hpp"
+#include "CameraUniformBuffer.hpp"
+#include "Headless.hpp"
+#include "Profiler.hpp"
 
 struct UserData
 {
@@ -27,12 +49,59 @@ void OnKeyPressed(GLFWwindow* window, int key, int scancode, int action, int mod
 
 void ProcessInput(GLFWwindow* window);
 
-void DrawOrbitalSettings(Orbital& orbital);
+void DrawOrbitalSettings(Orbital& orbital, MeshCache& cache, MeshArchive& archive);
+void DrawGallerySettings(OrbitalGallery& gallery, bool& showGallery);
+void DrawHydrogenSettings(HydrogenOrbital& hydrogen, HydrogenVolume& volume, HydrogenCloud& cloud, bool& showHydrogen, int& hydrogenStyle);
+
 void DrawGeneralSettings(Camera& camera);
 void DrawMathematicalSettings(CoordinateSystem& cs);
+void DrawProfilerSettings(Profiler& profiler, float firstFrameTime);
 
 int main(int argc, char** argv)
 {
+	// Batch rendering without a window: orbitals --headless <job file> [width height]
+	if (argc >= 3 && std::string(argv[1]) == "--headless")
+	{
+		std::vector<RenderJob> jobs;
+		if (!LoadRenderJobs(argv[2], jobs))
+			return -1;
+
+		int width = (argc >= 5) ? std::atoi(argv[3]) : 1200;
+		int height = (argc >= 5) ? std::atoi(argv[4]) : 800;
+		if (width <= 0 || height <= 0)
+		{
+			std::cerr << "Invalid image size" << std::endl;
+			return -1;
+		}
+
+		return RunHeadless(jobs, width, height);
+	}
+
+	// Mesh files of every orbital up to max l, no window needed: orbitals --export <max l> <resolution> <directory> [ply|glb|stl]
+	if (argc >= 5 && std::string(argv[1]) == "--export")
+	{
+		int maxL = std::atoi(argv[2]);
+		int resolution = std::atoi(argv[3]);
+		if (maxL < 0 || resolution < 2)
+		{
+			std::cerr << "Invalid max l or resolution" << std::endl;
+			return -1;
+		}
+
+		MeshFileFormat format = MeshFileFormat::Ply;
+		if (argc >= 6 && !MeshExporter::FormatFromPath(std::string(".") + argv[5], format))
+		{
+			std::cerr << "Unknown format " << argv[5] << std::endl;
+			return -1;
+		}
+
+		return MeshExporter(format).WriteAll(maxL, resolution, argv[4], &ThreadPool::GetDefault()) ? 0 : -1;
+	}
+
+	// Time to first frame counts from here, shader compilation is most of it
+	std::chrono::steady_clock::time_point launchTime = std::chrono::steady_clock::now();
+	float firstFrameTime = -1.0f;
+
 	// Initialize GLFW and let it know what OpenGL version/profile we're using
 	glfwInit();
 
@@ -66,6 +135,10 @@ int main(int argc, char** argv)
 		return -1;
 	}
 
+	// Linked shader programs are kept here between runs
+	Shader::SetBinaryCacheDirectory("shader_cache");
+	Shader::EnableParallelCompile((void* (*)(const char*))glfwGetProcAddress);
+
 	// Set up ImGui
 	IMGUI_CHECKVERSION();
 	ImGui::CreateContext();
@@ -78,15 +151,38 @@ int main(int argc, char** argv)
 
 	CoordinateSystem csystem;
 
+	// Recently generated meshes are kept around so switching back to them is instant
+	MeshCache meshCache(512 * 1024 * 1024);
+
+	// Precomputed meshes (see orbitals_archive), used before anything is generated
+	MeshArchive meshArchive;
+	if (std::filesystem::exists("orbitals.meshes"))
+		meshArchive.Open("orbitals.meshes");
+
 	// Create some orbital and set up its transformation matrix
 	// TODO: the matrix should probably be part of Model
-	Orbital orbital(2, 1);
+	Orbital orbital(2, 1, &meshCache, &meshArchive);
+
+	// Shown instead of the orbital when enabled
+	OrbitalGallery gallery(4, 50);
+	gallery.archive = &meshArchive;
+	bool showGallery = false;
+
+	// Also shown instead of the orbital, the gallery goes first
+	HydrogenOrbital hydrogen(3, 2, 0);
+	HydrogenVolume hydrogenVolume(3, 2, 0);
+	HydrogenCloud hydrogenCloud(3, 2, 0);
+	bool showHydrogen = false;
+	int hydrogenStyle = 0;
 
 	// Set up a camera 
 	// TODO: should the projection matrix be part of the camera?
 	Camera camera(110.0f, 1200.0f / 800.0f);
 	camera.SetPosition(glm::vec3(0.0f, 0.0f, 4.0f));
 
+	// The view and projection matrices every shader reads
+	CameraUniformBuffer cameraBuffer;
+
 	glm::vec3 clearColor(0.0f, 0.0f, 0.05f);
 
 	// Data that we want to be able to access from anywhere
@@ -100,7 +196,9 @@ int main(int argc, char** argv)
 	glfwSetWindowUserPointer(window, &data);
 
 	// Set up a timer to calculate frametimes
-	std::chrono::system_clock::time_point start = std::chrono::system_clock::now();
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	Profiler profiler;
 
 	// Set viewport and depth buffer
 	glViewport(0, 0, 1200, 800);
@@ -108,42 +206,115 @@ int main(int argc, char** argv)
 	while (!glfwWindowShouldClose(window))
 	{
 		// Calculate frametime
-		std::chrono::duration<float> framedelta = std::chrono::duration_cast<std::chrono::duration<float>>(std::chrono::system_clock::now() - start);
-		data.frametime = framedelta.count();
-		start = std::chrono::system_clock::now();
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		data.frametime = std::chrono::duration<float>(now - start).count();
+		start = now;
+
+		profiler.BeginFrame();
 
 		// Handle events
-		glfwPollEvents();
-		ProcessInput(window);
+		{
+			Profiler::Scope scope(profiler, "Events");
+			glfwPollEvents();
+			ProcessInput(window);
+		}
 
 		// Clear screen
 		glClearColor(clearColor.x, clearColor.y, clearColor.z, 0.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		// Start new ImGui Frame 
-		ImGui_ImplOpenGL3_NewFrame();
-		ImGui_ImplGlfw_NewFrame();
-		ImGui::NewFrame();
+		cameraBuffer.Update(camera);
+
+		{
+			Profiler::Scope scope(profiler, "Orbital");
+			orbital.Poll();
+			hydrogen.Poll();
+			hydrogenVolume.Poll();
+			hydrogenCloud.Poll();
+
+			int framebufferWidth, framebufferHeight;
+			glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+
+			// Views switched to before their shader is compiled stay empty for a few frames instead of stalling
+			if (showGallery)
+			{
+				if (gallery.IsShaderReady())
+				{
+					gallery.SelectLevels(camera, (float)framebufferHeight);
+					gallery.BindDefaultShader(orbital.positiveColor, orbital.negativeColor);
+					gallery.Draw();
+				}
+			}
+			else if (showHydrogen && hydrogenStyle == 2)
+			{
+				if (hydrogenCloud.IsShaderReady())
+				{
+					hydrogenCloud.BindDefaultShader(orbital.positiveColor, orbital.negativeColor);
+					hydrogenCloud.Draw();
+				}
+			}
+			else if (showHydrogen && hydrogenStyle == 1)
+			{
+				if (hydrogenVolume.IsShaderReady())
+				{
+					hydrogenVolume.BindDefaultShader(orbital.positiveColor, orbital.negativeColor);
+					hydrogenVolume.Draw();
+				}
+			}
+			else if (showHydrogen)
+			{
+				if (hydrogen.IsShaderReady())
+				{
+					hydrogen.BindDefaultShader(orbital.positiveColor, orbital.negativeColor);
+					hydrogen.Draw();
+				}
+			}
+			else
+			{
+				orbital.SelectLevel(camera, (float)framebufferHeight);
+				orbital.Animate(data.frametime);
+				orbital.BindDefaultShader();
+				orbital.Draw();
+			}
+		}
+
+		{
+			Profiler::Scope scope(profiler, "Coordinate System");
+			csystem.BindDefaultShader();
+			csystem.Draw();
+		}
 
-		orbital.BindDefaultShader(camera);
-		orbital.Draw();
+		{
+			Profiler::Scope scope(profiler, "ImGui");
 
-		csystem.BindDefaultShader(camera);
-		csystem.Draw();
+			// Start new ImGui Frame 
+			ImGui_ImplOpenGL3_NewFrame();
+			ImGui_ImplGlfw_NewFrame();
+			ImGui::NewFrame();
 
-		ImGui::Begin("Settings");
+			ImGui::Begin("Settings");
 
-		DrawOrbitalSettings(orbital);
-		DrawGeneralSettings(camera);
-		DrawMathematicalSettings(csystem);
+			DrawOrbitalSettings(orbital, meshCache, meshArchive);
+			DrawGallerySettings(gallery, showGallery);
+			DrawHydrogenSettings(hydrogen, hydrogenVolume, hydrogenCloud, showHydrogen, hydrogenStyle);
+			DrawGeneralSettings(camera);
+			DrawMathematicalSettings(csystem);
+			DrawProfilerSettings(profiler, firstFrameTime);
 
-		ImGui::End();
+			ImGui::End();
 
-		ImGui::Render();
-		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+			ImGui::Render();
+			ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+		}
 
 		// Update swapchain
-		glfwSwapBuffers(window);
+		{
+			Profiler::Scope scope(profiler, "Swap");
+			glfwSwapBuffers(window);
+		}
+
+		if (firstFrameTime < 0.0f)
+			firstFrameTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - launchTime).count();
 	}
 
 	// cleanup
@@ -218,28 +389,261 @@ void ProcessInput(GLFWwindow* window)
 		data->camera->MoveUp(-cameraSpeed, data->frametime);
 }
 
-void DrawOrbitalSettings(Orbital& orbital)
+void DrawOrbitalSettings(Orbital& orbital, MeshCache& cache, MeshArchive& archive)
 {
+	// Loading and analyzing a large grid takes long enough to freeze the window, so it happens in the background.
+	// Picked up here so it arrives even while the settings are collapsed
+	struct AnalysisResult
+	{
+		HarmonicExpansion expansion;
+		unsigned int resolution;
+		int maxL;
+		float milliseconds;
+	};
+
+	static BackgroundJob<std::unique_ptr<AnalysisResult>> analysisJob;
+	static std::string analysisStatus;
+
+	std::unique_ptr<AnalysisResult> analysis;
+	if (analysisJob.Poll(analysis))
+	{
+		if (analysis != nullptr)
+		{
+			analysisStatus = "Band limit " + std::to_string(analysis->maxL) + " in " + std::to_string(analysis->milliseconds) + " ms";
+			orbital.expansion = std::move(analysis->expansion);
+			orbital.superposition = true;
+			orbital.resolution = analysis->resolution;
+			orbital.RequestUpdate();
+		}
+		else
+		{
+			analysisStatus = "Failed to load the grid";
+		}
+	}
+
 	if (ImGui::CollapsingHeader("Orbital Settings"))
 	{
 
 		if (ImGui::TreeNode("Properties"))
 		{
-			ImGui::SliderInt("l", &orbital.l, 0, 8);
+			bool changed = ImGui::SliderInt("l", &orbital.l, 0, 200);
 			if (orbital.m > orbital.l)
 				orbital.m = orbital.l;
 			else if (orbital.m < -orbital.l)
 				orbital.m = -orbital.l;
 
-			ImGui::SliderInt("m", &orbital.m, -orbital.l, orbital.l);
+			changed |= ImGui::SliderInt("m", &orbital.m, -orbital.l, orbital.l);
+
+			changed |= ImGui::SliderInt("Resolution", (int*)&orbital.resolution, 10, 1000);
+
+			bool half = (orbital.vertexFormat == VertexFormat::Half);
+			changed |= ImGui::Checkbox("Half precision radii", &half);
+			orbital.vertexFormat = half ? VertexFormat::Half : VertexFormat::Float;
+
+			// The other meshes are made to look about as good as the grid at this resolution
+			int meshType = (int)orbital.meshType;
+			changed |= ImGui::RadioButton("Grid", &meshType, (int)MeshType::Grid);
+			ImGui::SameLine();
+			changed |= ImGui::RadioButton("Adaptive", &meshType, (int)MeshType::Adaptive);
+			ImGui::SameLine();
+			changed |= ImGui::RadioButton("HEALPix", &meshType, (int)MeshType::Healpix);
+			ImGui::SameLine();
+			changed |= ImGui::RadioButton("Icosphere", &meshType, (int)MeshType::Icosphere);
+			orbital.meshType = (MeshType)meshType;
 
-			ImGui::SliderInt("Resolution", (int*)&orbital.resolution, 10, 1000);
+			// Whatever is being generated right now doesn't match the settings anymore
+			if (changed)
+				orbital.CancelUpdate();
 
 			if (ImGui::Button("Generate"))
 			{
-				orbital.UpdateModel();
+				orbital.RequestUpdate();
+			}
+
+			if (orbital.IsUpdating())
+			{
+				ImGui::SameLine();
+				ImGui::Text("Generating...");
+			}
+
+			ImGui::TreePop();
+			ImGui::Separator();
+		}
+
+		if (ImGui::TreeNode("Superposition"))
+		{
+			// Only the weighted sums are redone when the coefficients change, so it's cheap enough to follow every edit
+			bool changed = ImGui::Checkbox("Show superposition", &orbital.superposition);
+
+			static int hybrid = (int)HybridOrbital::Sp3;
+			static int hybridIndex = 0;
+			const char* hybridNames[] = {
+				HarmonicExpansion::GetHybridName(HybridOrbital::Sp), HarmonicExpansion::GetHybridName(HybridOrbital::Sp2),
+				HarmonicExpansion::GetHybridName(HybridOrbital::Sp3), HarmonicExpansion::GetHybridName(HybridOrbital::D2sp3)
+			};
+			ImGui::Combo("Hybrid", &hybrid, hybridNames, IM_ARRAYSIZE(hybridNames));
+			ImGui::SliderInt("Hybrid index", &hybridIndex, 0, HarmonicExpansion::GetHybridCount((HybridOrbital)hybrid) - 1);
+			hybridIndex = std::min(hybridIndex, HarmonicExpansion::GetHybridCount((HybridOrbital)hybrid) - 1);
+
+			if (ImGui::Button("Load hybrid"))
+			{
+				orbital.expansion = HarmonicExpansion::Hybrid((HybridOrbital)hybrid, hybridIndex);
+				orbital.superposition = true;
+				changed = true;
+			}
+
+			int maxL = orbital.expansion.GetMaxL();
+			if (ImGui::SliderInt("Max l", &maxL, 0, 12))
+			{
+				orbital.expansion.SetMaxL(maxL);
+				changed = true;
+			}
+
+			// Analyzed expansions can have tens of thousands of coefficients, those aren't edited by hand
+			int editableL = (orbital.expansion.GetMaxL() <= 12) ? orbital.expansion.GetMaxL() : -1;
+			if (editableL < 0)
+				ImGui::Text("%zu coefficients", orbital.expansion.coefficients.size());
+
+			for (int l = 0; l <= editableL; l++)
+			{
+				for (int m = -l; m <= l; m++)
+				{
+					ImGui::PushID(l * (l + 1) + m);
+
+					float coefficient = (float)orbital.expansion.Get(l, m);
+					if (ImGui::DragFloat("##coefficient", &coefficient, 0.01f, -2.0f, 2.0f, "%.3f"))
+					{
+						orbital.expansion.Set(l, m, coefficient);
+						changed = true;
+					}
+
+					ImGui::SameLine();
+					ImGui::Text("c(%d, %d)", l, m);
+					ImGui::PopID();
+				}
+			}
+
+			// Plays whatever superposition is displayed, the radii are rewritten every frame
+			ImGui::Checkbox("Animate", &orbital.animate);
+			ImGui::SliderFloat("Energy scale", &orbital.energyScale, 0.0f, 2.0f);
+			ImGui::SliderFloat("Rotation speed", &orbital.rotationSpeed, -3.0f, 3.0f);
+
+			if (changed && orbital.superposition)
+				orbital.RequestUpdate();
+			else if (changed)
+				orbital.CancelUpdate();
+
+			ImGui::TreePop();
+			ImGui::Separator();
+		}
+
+		if (ImGui::TreeNode("Analysis"))
+		{
+			// Sampled grid files, see HarmonicAnalysis.hpp. The reconstruction is shown as a superposition
+			static char path[256] = "grid.shgd";
+			static int bandLimit = 32;
+
+			ImGui::InputText("Grid file", path, sizeof(path));
+			ImGui::SliderInt("Band limit", &bandLimit, 0, 500);
+
+			// Starting over drops the analysis that's still running
+			if (ImGui::Button("Analyze"))
+			{
+				analysisJob.Start([file = std::string(path), maxL = bandLimit](const std::atomic<bool>* cancelled)
+				{
+					std::unique_ptr<AnalysisResult> result = std::make_unique<AnalysisResult>();
+					std::vector<float> samples;
+					if (!LoadSampledGrid(file, result->resolution, samples))
+						return std::unique_ptr<AnalysisResult>();
+
+					auto start = std::chrono::steady_clock::now();
+					HarmonicAnalysis analysis(result->resolution, maxL);
+					result->expansion = analysis.Analyze(samples.data(), &ThreadPool::GetDefault());
+					result->maxL = analysis.GetMaxL();
+					result->milliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+					return result;
+				});
+			}
+
+			// Writes the current harmonic, mostly to have something to analyze
+			ImGui::SameLine();
+			if (ImGui::Button("Save current harmonic"))
+			{
+				OrbitalMesh mesh(orbital.l, orbital.m, orbital.resolution);
+				mesh.Generate(&ThreadPool::GetDefault());
+				analysisStatus = SaveSampledGrid(path, mesh.resolution, mesh.radii.data()) ? "Saved" : "Failed to save the grid";
 			}
 
+			if (analysisJob.IsRunning())
+				ImGui::Text("Analyzing...");
+			else if (!analysisStatus.empty())
+				ImGui::Text("%s", analysisStatus.c_str());
+
+			ImGui::TreePop();
+			ImGui::Separator();
+		}
+
+		if (ImGui::TreeNode("Export"))
+		{
+			// The format follows from the extension, .ply, .glb or .stl
+			static char path[256] = "orbital.ply";
+			static char directory[256] = "orbitals";
+			static int exportMaxL = 6;
+			static std::string status;
+
+			ImGui::InputText("File", path, sizeof(path));
+
+			// Exports what's shown, generated again at full resolution so the level of detail doesn't matter
+			if (ImGui::Button("Export current"))
+			{
+				MeshFileFormat format;
+				if (MeshExporter::FormatFromPath(path, format))
+				{
+					std::unique_ptr<OrbitalMesh> mesh;
+					if (orbital.superposition)
+						mesh = std::make_unique<OrbitalMesh>(std::make_shared<HarmonicExpansion>(orbital.expansion), orbital.resolution);
+					else
+						mesh = std::make_unique<OrbitalMesh>(orbital.l, orbital.m, orbital.resolution, VertexFormat::Float, orbital.meshType);
+					mesh->Generate(&ThreadPool::GetDefault());
+
+					MeshExporter exporter(format);
+					std::copy_n(orbital.GetPositiveColorVPtr(), 3, exporter.positiveColor);
+					std::copy_n(orbital.GetNegativeColorVPtr(), 3, exporter.negativeColor);
+					status = exporter.Write(*mesh, path) ? "Exported" : "Failed to export";
+				}
+				else
+				{
+					status = "Unknown format, use .ply, .glb or .stl";
+				}
+			}
+
+			// Every orbital up to max l at the current resolution, in the format of the file above
+			ImGui::InputText("Directory", directory, sizeof(directory));
+			ImGui::SliderInt("Max l##export", &exportMaxL, 0, 20);
+
+			if (ImGui::Button("Export all"))
+			{
+				MeshFileFormat format;
+				if (MeshExporter::FormatFromPath(path, format))
+				{
+					auto start = std::chrono::steady_clock::now();
+					MeshExporter exporter(format);
+					std::copy_n(orbital.GetPositiveColorVPtr(), 3, exporter.positiveColor);
+					std::copy_n(orbital.GetNegativeColorVPtr(), 3, exporter.negativeColor);
+					bool exported = exporter.WriteAll(exportMaxL, orbital.resolution, directory, &ThreadPool::GetDefault());
+					float milliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+					status = exported ? std::to_string((exportMaxL + 1) * (exportMaxL + 1)) + " orbitals in " + std::to_string(milliseconds) + " ms" : "Failed to export";
+				}
+				else
+				{
+					status = "Unknown format, use .ply, .glb or .stl";
+				}
+			}
+
+			if (!status.empty())
+				ImGui::Text("%s", status.c_str());
+
 			ImGui::TreePop();
 			ImGui::Separator();
 		}
@@ -252,6 +656,191 @@ void DrawOrbitalSettings(Orbital& orbital)
 			ImGui::TreePop();
 			ImGui::Separator();
 		}
+
+		if (ImGui::TreeNode("Level of Detail"))
+		{
+			// Coarser levels are drawn once the orbital gets small on screen
+			ImGui::Checkbox("Enabled", &orbital.levelOfDetail);
+			ImGui::SliderFloat("Pixels per cell", &LevelOfDetail::pixelsPerCell, 0.5f, 8.0f);
+			ImGui::SliderFloat("Hysteresis", &LevelOfDetail::hysteresis, 0.0f, 0.5f);
+
+			ImGui::Text("Level %u of %u (resolution %u)", orbital.GetLevel(), orbital.GetLevelCount(), orbital.GetLevelResolution());
+
+			ImGui::TreePop();
+			ImGui::Separator();
+		}
+
+		if (ImGui::TreeNode("Index Buffers"))
+		{
+			// Orbitals of the same resolution share their index buffer
+			int encoding = (int)IndexBuffer::GetDefaultEncoding();
+			ImGui::RadioButton("Triangle list", &encoding, (int)IndexEncoding::TriangleList);
+			ImGui::SameLine();
+			ImGui::RadioButton("Triangle strips", &encoding, (int)IndexEncoding::TriangleStrip);
+			IndexBuffer::SetDefaultEncoding((IndexEncoding)encoding);
+
+			ImGui::Text("%s indices at the current resolution", GridIndices::FitsShort(orbital.resolution) ? "16 bit" : "32 bit");
+
+			ImGui::TreePop();
+			ImGui::Separator();
+		}
+
+		if (ImGui::TreeNode("Mesh Cache"))
+		{
+			int budget = (int)(cache.GetBudget() / (1024 * 1024));
+			if (ImGui::SliderInt("Budget (MB)", &budget, 0, 4096))
+				cache.SetBudget((size_t)budget * 1024 * 1024);
+
+			ImGui::Text("%zu meshes, %.1f MB", cache.GetEntryCount(), cache.GetSize() / (1024.0f * 1024.0f));
+			ImGui::Text("Hits: %u  Misses: %u  Evictions: %u", cache.GetHits(), cache.GetMisses(), cache.GetEvictions());
+
+			if (ImGui::Button("Clear"))
+				cache.Clear();
+
+			ImGui::TreePop();
+			ImGui::Separator();
+		}
+
+		if (ImGui::TreeNode("Mesh Archive"))
+		{
+			// Only the index is read when opening, meshes are paged in once they're used
+			static char path[256] = "orbitals.meshes";
+			ImGui::InputText("Archive", path, sizeof(path));
+
+			if (ImGui::Button("Open"))
+				archive.Open(path);
+
+			ImGui::SameLine();
+			if (ImGui::Button("Close"))
+				archive.Close();
+
+			if (archive.IsOpen())
+				ImGui::Text("%zu meshes, %.1f MB", archive.GetEntryCount(), archive.GetFileSize() / (1024.0f * 1024.0f));
+			else
+				ImGui::Text("No archive open");
+
+			ImGui::TreePop();
+			ImGui::Separator();
+		}
+	}
+}
+
+void DrawGallerySettings(OrbitalGallery& gallery, bool& showGallery)
+{
+	if (ImGui::CollapsingHeader("Gallery Settings"))
+	{
+		ImGui::Checkbox("Show gallery", &showGallery);
+
+		ImGui::SliderInt("Max l", &gallery.maxL, 0, 20);
+		ImGui::SliderInt("Resolution##gallery", (int*)&gallery.resolution, 10, 200);
+		ImGui::SliderFloat("Spacing", &gallery.spacing, 1.0f, 5.0f);
+
+		if (ImGui::Button("Generate##gallery"))
+			gallery.UpdateModels();
+
+		ImGui::Text("%u orbitals", gallery.GetOrbitalCount());
+
+		ImGui::Checkbox("Level of detail##gallery", &gallery.levelOfDetail);
+		for (unsigned int level = 0; level < gallery.GetLevelCount(); level++)
+			ImGui::Text("Level %u: %u orbitals", level, gallery.GetOrbitalsAtLevel(level));
+	}
+}
+
+void DrawHydrogenSettings(HydrogenOrbital& hydrogen, HydrogenVolume& volume, HydrogenCloud& cloud, bool& showHydrogen, int& hydrogenStyle)
+{
+	if (ImGui::CollapsingHeader("Hydrogen Settings"))
+	{
+		ImGui::Checkbox("Show hydrogen", &showHydrogen);
+		ImGui::RadioButton("Isosurfaces##style", &hydrogenStyle, 0);
+		ImGui::SameLine();
+		ImGui::RadioButton("Density##style", &hydrogenStyle, 1);
+		ImGui::SameLine();
+		ImGui::RadioButton("Dots##style", &hydrogenStyle, 2);
+
+		bool changed = ImGui::SliderInt("n", &hydrogen.n, 1, 12);
+		hydrogen.l = std::clamp(hydrogen.l, 0, hydrogen.n - 1);
+		changed |= ImGui::SliderInt("l##hydrogen", &hydrogen.l, 0, hydrogen.n - 1);
+		hydrogen.m = std::clamp(hydrogen.m, -hydrogen.l, hydrogen.l);
+		changed |= ImGui::SliderInt("m##hydrogen", &hydrogen.m, -hydrogen.l, hydrogen.l);
+
+		if (ImGui::TreeNode("Isosurfaces"))
+		{
+			changed |= ImGui::SliderInt("Volume size", (int*)&hydrogen.volumeSize, 16, 384);
+			changed |= ImGui::SliderFloat("Iso value", &hydrogen.isoFraction, 0.01f, 0.9f);
+
+			// Only the surfaces are extracted again if the volume still fits
+			if (ImGui::Button("Generate##hydrogen"))
+				hydrogen.RequestUpdate();
+
+			if (hydrogen.IsUpdating())
+				ImGui::Text("Updating...");
+			else
+				ImGui::Text("%zu triangles, extent %.1f Bohr radii", hydrogen.GetTriangleCount(), hydrogen.GetExtent());
+
+			ImGui::TreePop();
+		}
+
+		if (ImGui::TreeNode("Density"))
+		{
+			changed |= ImGui::SliderInt("Cells", (int*)&volume.cells, 64, 1024);
+			changed |= ImGui::SliderFloat("Threshold", &volume.threshold, 1e-6f, 1e-2f, "%.1e");
+			changed |= ImGui::SliderInt("Budget (MB)##density", (int*)&volume.budget, 16, 2048);
+
+			// Only affect the drawing
+			ImGui::SliderFloat("Opacity", &volume.densityScale, 1.0f, 200.0f);
+			ImGui::SliderFloat("Step (cells)", &volume.stepSize, 0.25f, 2.0f);
+
+			if (ImGui::Button("Generate##density"))
+			{
+				volume.n = hydrogen.n;
+				volume.l = hydrogen.l;
+				volume.m = hydrogen.m;
+				volume.RequestUpdate();
+			}
+
+			if (volume.IsUpdating())
+				ImGui::Text("Updating...");
+
+			ImGui::Text("%zu bricks, %.1f MB (%.1f MB dense)%s", volume.GetBrickCount(), volume.GetByteSize() / 1048576.0,
+				volume.GetDenseByteSize() / 1048576.0, volume.IsTruncated() ? ", over budget" : "");
+
+			ImGui::TreePop();
+		}
+
+		if (ImGui::TreeNode("Dots"))
+		{
+			changed |= ImGui::SliderInt("Points", (int*)&cloud.count, 10000, 50000000);
+
+			// The same seed always gives the same cloud
+			int seed = (int)cloud.seed;
+			changed |= ImGui::InputInt("Seed", &seed);
+			cloud.seed = (uint64_t)seed;
+
+			ImGui::SliderFloat("Point size", &cloud.pointSize, 1.0f, 5.0f);
+
+			if (ImGui::Button("Generate##dots"))
+			{
+				cloud.n = hydrogen.n;
+				cloud.l = hydrogen.l;
+				cloud.m = hydrogen.m;
+				cloud.RequestUpdate();
+			}
+
+			if (cloud.IsUpdating())
+				ImGui::Text("Updating...");
+
+			ImGui::Text("%zu points", cloud.GetPointCount());
+
+			ImGui::TreePop();
+		}
+
+		// Whatever is being generated right now doesn't match the settings anymore
+		if (changed)
+		{
+			hydrogen.CancelUpdate();
+			volume.CancelUpdate();
+			cloud.CancelUpdate();
+		}
 	}
 }
 
@@ -278,3 +867,47 @@ void DrawMathematicalSettings(CoordinateSystem& cs)
 		}
 	}
 }
+
+void DrawProfilerSettings(Profiler& profiler, float firstFrameTime)
+{
+	if (ImGui::CollapsingHeader("Profiler"))
+	{
+		if (firstFrameTime >= 0.0f)
+			ImGui::Text("First frame after %.0f ms", firstFrameTime);
+
+		bool enabled = profiler.IsEnabled();
+		if (ImGui::Checkbox("Enabled", &enabled))
+			profiler.SetEnabled(enabled);
+
+		ImGui::SameLine();
+		if (ImGui::Button("Export CSV"))
+			profiler.ExportCSV("profile.csv");
+
+		std::vector<float> history;
+		for (size_t stage = 0; stage < profiler.GetStageCount(); stage++)
+		{
+			if (!ImGui::TreeNode(profiler.GetStageName(stage).c_str()))
+				continue;
+
+			for (bool gpu : { false, true })
+			{
+				Profiler::Statistics statistics = profiler.GetStatistics(stage, gpu);
+				ImGui::Text("%s  avg %.2f  p50 %.2f  p95 %.2f  p99 %.2f  max %.2f ms", gpu ? "GPU" : "CPU",
+					statistics.average, statistics.p50, statistics.p95, statistics.p99, statistics.max);
+
+				// Missing samples are drawn as 0, the scale is fixed so single spikes don't squash everything else
+				profiler.GetHistory(stage, gpu, history);
+				for (float& value : history)
+				{
+					if (std::isnan(value))
+						value = 0.0f;
+				}
+
+				ImGui::PlotHistogram(gpu ? "##gpu" : "##cpu", history.data(), (int)history.size(), 0, nullptr, 0.0f, 1.25f * statistics.p99, ImVec2(0.0f, 50.0f));
+			}
+
+			ImGui::TreePop();
+			ImGui::Separator();
+		}
+	}
+}